@@ -0,0 +1,71 @@
+#include "audio.h"
+
+#include <bit>
+#include <algorithm>
+
+void ps1::audio_ring_init(audio_ring_t* ring, uint32_t capacity) {
+    capacity = std::bit_ceil(std::max(capacity, 2u));
+
+    ring->samples.assign((size_t)capacity * AUDIO_CHANNEL_CNT, 0);
+    ring->frame_mask = capacity - 1;
+    ring->write_pos = 0;
+    ring->read_pos = 0;
+}
+
+void ps1::audio_ring_exit(audio_ring_t* ring) {
+    ring->samples.clear();
+    ring->samples.shrink_to_fit();
+}
+
+uint32_t ps1::audio_ring_push(audio_ring_t* ring, const int16_t* frames, uint32_t cnt) {
+    uint64_t write = ring->write_pos.load(std::memory_order_relaxed);
+    uint64_t read = ring->read_pos.load(std::memory_order_acquire);
+
+    cnt = std::min(cnt, audio_ring_capacity(ring) - (uint32_t)(write - read));
+
+    // * at most two runs, before and after wrap
+    for (uint32_t done = 0; done < cnt;) {
+        uint32_t start = (uint32_t)((write + done) & ring->frame_mask);
+        uint32_t run = std::min(cnt - done, ring->frame_mask + 1 - start);
+
+        memcpy(&ring->samples[(size_t)start * AUDIO_CHANNEL_CNT], frames + (size_t)done * AUDIO_CHANNEL_CNT, (size_t)run * AUDIO_CHANNEL_CNT * sizeof(int16_t));
+
+        done += run;
+    }
+
+    ring->write_pos.store(write + cnt, std::memory_order_release);
+
+    return cnt;
+}
+
+uint32_t ps1::audio_ring_pop(audio_ring_t* ring, int16_t* frames, uint32_t cnt) {
+    uint64_t read = ring->read_pos.load(std::memory_order_relaxed);
+    uint64_t write = ring->write_pos.load(std::memory_order_acquire);
+
+    cnt = std::min(cnt, (uint32_t)(write - read));
+
+    for (uint32_t done = 0; done < cnt;) {
+        uint32_t start = (uint32_t)((read + done) & ring->frame_mask);
+        uint32_t run = std::min(cnt - done, ring->frame_mask + 1 - start);
+
+        memcpy(frames + (size_t)done * AUDIO_CHANNEL_CNT, &ring->samples[(size_t)start * AUDIO_CHANNEL_CNT], (size_t)run * AUDIO_CHANNEL_CNT * sizeof(int16_t));
+
+        done += run;
+    }
+
+    ring->read_pos.store(read + cnt, std::memory_order_release);
+
+    return cnt;
+}
+
+uint32_t ps1::audio_ring_size(audio_ring_t* ring) {
+    return (uint32_t)(ring->write_pos.load(std::memory_order_acquire) - ring->read_pos.load(std::memory_order_acquire));
+}
+
+uint32_t ps1::audio_ring_capacity(audio_ring_t* ring) {
+    return ring->frame_mask + 1;
+}
+
+void ps1::audio_ring_clear(audio_ring_t* ring) {
+    ring->read_pos.store(ring->write_pos.load(std::memory_order_acquire), std::memory_order_release);
+}
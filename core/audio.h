@@ -0,0 +1,39 @@
+#pragma once
+
+#include "defs.h"
+
+#include <atomic>
+
+namespace ps1 {
+    constexpr uint32_t AUDIO_SAMPLE_RATE = 44100;
+    constexpr uint32_t AUDIO_CHANNEL_CNT = 2;
+
+    /*
+    * single producer single consumer ring of interleaved stereo frames
+    * emulation thread pushes, host audio thread or wav sink pops. neither side ever waits,
+    * frames that do not fit are dropped by producer
+    */
+    struct audio_ring_t {
+        dyn_arr_t<int16_t> samples;
+        uint32_t frame_mask; // * capacity is power of two frames
+
+        alignas(64) std::atomic<uint64_t> write_pos; // * frames pushed so far
+        alignas(64) std::atomic<uint64_t> read_pos; // * frames popped so far
+    };
+
+    // * capacity in frames is rounded up to power of two
+    void audio_ring_init(audio_ring_t*, uint32_t);
+    void audio_ring_exit(audio_ring_t*);
+
+    // * frames actually written
+    uint32_t audio_ring_push(audio_ring_t*, const int16_t*, uint32_t);
+    // * frames actually read
+    uint32_t audio_ring_pop(audio_ring_t*, int16_t*, uint32_t);
+
+    // * frames waiting to be popped
+    uint32_t audio_ring_size(audio_ring_t*);
+    uint32_t audio_ring_capacity(audio_ring_t*);
+
+    // * drops everything pushed so far. consumer side only
+    void audio_ring_clear(audio_ring_t*);
+}
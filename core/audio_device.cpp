@@ -0,0 +1,190 @@
+#include "audio_device.h"
+#include "logger.h"
+
+#if defined(PS1_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#elif defined(PS1_LINUX)
+#include <alsa/asoundlib.h>
+#endif
+
+namespace {
+#if defined(PS1_WINDOWS)
+    // * buffers queued on device, one is refilled while others play
+    constexpr uint32_t buffer_cnt = 3;
+
+    void play(ps1::audio_device_t* device) {
+        HWAVEOUT wave_out = (HWAVEOUT)device->handle;
+        HANDLE event = (HANDLE)device->event;
+
+        dyn_arr_t<int16_t> samples((size_t)device->period_frames * ps1::AUDIO_CHANNEL_CNT * buffer_cnt, 0);
+        WAVEHDR headers[buffer_cnt] = {};
+
+        for (uint32_t i = 0; i < buffer_cnt; i++) {
+            headers[i].lpData = (LPSTR)&samples[(size_t)device->period_frames * ps1::AUDIO_CHANNEL_CNT * i];
+            headers[i].dwBufferLength = device->period_frames * ps1::AUDIO_CHANNEL_CNT * sizeof(int16_t);
+
+            waveOutPrepareHeader(wave_out, &headers[i], sizeof(WAVEHDR));
+
+            // * marks buffer as free so first pass fills every buffer
+            headers[i].dwFlags |= WHDR_DONE;
+        }
+
+        while (!device->quit) {
+            for (auto& header : headers) {
+                if (!(header.dwFlags & WHDR_DONE)) continue;
+
+                device->callback((int16_t*)header.lpData, device->period_frames);
+
+                header.dwFlags &= ~WHDR_DONE;
+                waveOutWrite(wave_out, &header, sizeof(WAVEHDR));
+            }
+
+            // * timeout only bounds how long quit goes unnoticed
+            WaitForSingleObject(event, 100);
+        }
+
+        // * returns every queued buffer to us so headers can be released
+        waveOutReset(wave_out);
+
+        for (auto& header : headers) {
+            waveOutUnprepareHeader(wave_out, &header, sizeof(WAVEHDR));
+        }
+    }
+#elif defined(PS1_LINUX)
+    // * device buffer in periods, latency on top of audio ring
+    constexpr uint32_t buffer_periods = 3;
+
+    void play(ps1::audio_device_t* device) {
+        snd_pcm_t* pcm = (snd_pcm_t*)device->handle;
+
+        dyn_arr_t<int16_t> period((size_t)device->period_frames * ps1::AUDIO_CHANNEL_CNT, 0);
+
+        while (!device->quit) {
+            device->callback(period.data(), device->period_frames);
+
+            // * blocks until device has room, this is what ties callback to device clock
+            for (uint32_t done = 0; done < device->period_frames && !device->quit;) {
+                snd_pcm_sframes_t written = snd_pcm_writei(pcm, &period[(size_t)done * ps1::AUDIO_CHANNEL_CNT], device->period_frames - done);
+
+                if (written < 0) {
+                    // * underrun or suspend, stream is restarted and rest of period is written again
+                    if (snd_pcm_recover(pcm, (int)written, 1) < 0) {
+                        ps1::logger::push(str_t("playback failed: ") + snd_strerror((int)written), ps1::logger::type_t::error, "audio");
+
+                        return;
+                    }
+
+                    continue;
+                }
+
+                done += (uint32_t)written;
+            }
+        }
+    }
+#endif
+
+#if defined(PS1_WINDOWS) || defined(PS1_LINUX)
+    void run(ps1::audio_device_t* device) {
+        play(device);
+
+        device->running = false;
+    }
+#endif
+}
+
+bool ps1::audio_device_open(audio_device_t* device, uint32_t rate, uint32_t period_frames, audio_device_callback_t callback) {
+    device->callback = std::move(callback);
+    device->rate = rate;
+    device->period_frames = period_frames;
+    device->handle = 0;
+    device->event = 0;
+    device->quit = false;
+    device->running = false;
+
+#if defined(PS1_WINDOWS)
+    HANDLE event = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+    if (!event) return false;
+
+    WAVEFORMATEX format = {};
+    format.wFormatTag = WAVE_FORMAT_PCM;
+    format.nChannels = AUDIO_CHANNEL_CNT;
+    format.nSamplesPerSec = rate;
+    format.wBitsPerSample = 16;
+    format.nBlockAlign = AUDIO_CHANNEL_CNT * sizeof(int16_t);
+    format.nAvgBytesPerSec = rate * format.nBlockAlign;
+
+    HWAVEOUT wave_out;
+
+    if (waveOutOpen(&wave_out, WAVE_MAPPER, &format, (DWORD_PTR)event, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+        logger::push("failed to open wave out device", logger::type_t::error, "audio");
+
+        CloseHandle(event);
+
+        return false;
+    }
+
+    device->handle = (intptr_t)wave_out;
+    device->event = (intptr_t)event;
+    device->running = true;
+    device->thread = std::thread(run, device);
+
+    return true;
+#elif defined(PS1_LINUX)
+    snd_pcm_t* pcm;
+
+    int err = snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0);
+
+    if (err < 0) {
+        logger::push(str_t("failed to open pcm device: ") + snd_strerror(err), logger::type_t::error, "audio");
+
+        return false;
+    }
+
+    uint32_t latency_us = (uint32_t)((uint64_t)period_frames * buffer_periods * 1000000 / rate);
+
+    // * soft resample lets alsa convert if hardware does not run at requested rate
+    err = snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, AUDIO_CHANNEL_CNT, rate, 1, latency_us);
+
+    if (err < 0) {
+        logger::push(str_t("failed to configure pcm device: ") + snd_strerror(err), logger::type_t::error, "audio");
+
+        snd_pcm_close(pcm);
+
+        return false;
+    }
+
+    device->handle = (intptr_t)pcm;
+    device->running = true;
+    device->thread = std::thread(run, device);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ps1::audio_device_close(audio_device_t* device) {
+    // * thread is joined even if it already stopped on its own
+    if (!device->handle) return;
+
+    device->quit = true;
+    device->thread.join();
+
+#if defined(PS1_WINDOWS)
+    waveOutClose((HWAVEOUT)device->handle);
+    CloseHandle((HANDLE)device->event);
+#elif defined(PS1_LINUX)
+    snd_pcm_drop((snd_pcm_t*)device->handle);
+    snd_pcm_close((snd_pcm_t*)device->handle);
+#endif
+
+    device->handle = 0;
+    device->event = 0;
+}
+
+bool ps1::audio_device_is_open(audio_device_t* device) {
+    return device->handle && device->running;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "defs.h"
+#include "audio.h"
+
+#include <thread>
+#include <atomic>
+
+namespace ps1 {
+    // * fills given number of interleaved stereo frames, called on device thread
+    typedef func_t<void(int16_t*, uint32_t)> audio_device_callback_t;
+
+    /*
+    * host audio device playing interleaved stereo 16 bit frames at fixed rate
+    * device thread hands one period at a time to device and blocks until device has room for next one,
+    * so callback runs at device clock. alsa on linux, waveout on windows, other hosts have no device
+    */
+    struct audio_device_t {
+        audio_device_callback_t callback;
+
+        uint32_t rate;
+        uint32_t period_frames;
+
+        intptr_t handle; // * snd_pcm_t* or HWAVEOUT, 0 while closed
+        intptr_t event; // * windows only, signaled whenever device is done with a buffer
+
+        std::thread thread;
+        std::atomic<bool> quit;
+        std::atomic<bool> running; // * cleared by device thread when it exits, including on playback failure
+    };
+
+    // * rate and period in frames. false if host has no usable device, device stays closed
+    bool audio_device_open(audio_device_t*, uint32_t, uint32_t, audio_device_callback_t);
+    void audio_device_close(audio_device_t*);
+
+    // * false once device thread stopped feeding device, even if close was not called yet
+    bool audio_device_is_open(audio_device_t*);
+}
@@ -0,0 +1,86 @@
+#include "audio_output.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+    // * longest single sleep while waiting on ring, quit is checked in between
+    constexpr auto max_wait = std::chrono::milliseconds(20);
+}
+
+void ps1::audio_resampler_init(audio_resampler_t* resampler, uint32_t host_rate) {
+    resampler->nominal_step = (double)AUDIO_SAMPLE_RATE / host_rate;
+    resampler->position = 0;
+
+    memset(resampler->prev, 0, sizeof(resampler->prev));
+    memset(resampler->next, 0, sizeof(resampler->next));
+}
+
+void ps1::audio_resampler_pull(audio_resampler_t* resampler, audio_ring_t* ring, uint32_t target_fill, int16_t* frames, uint32_t cnt) {
+    // * fill is sampled once per call, step stays constant over one period
+    double error = ((double)audio_ring_size(ring) - target_fill) / std::max(target_fill, 1u);
+    double step = resampler->nominal_step * (1 + resampler->max_delta * std::clamp(error, -1.0, 1.0));
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        resampler->position += step;
+
+        while (resampler->position >= 1) {
+            resampler->position -= 1;
+
+            memcpy(resampler->prev, resampler->next, sizeof(resampler->prev));
+
+            // * next keeps its value on underrun, output holds last frame
+            audio_ring_pop(ring, resampler->next, 1);
+        }
+
+        for (uint32_t channel = 0; channel < AUDIO_CHANNEL_CNT; channel++) {
+            double prev = resampler->prev[channel];
+            double next = resampler->next[channel];
+
+            frames[i * AUDIO_CHANNEL_CNT + channel] = (int16_t)(prev + (next - prev) * resampler->position);
+        }
+    }
+}
+
+bool ps1::audio_output_start(audio_output_t* output, audio_ring_t* ring, uint32_t host_rate, uint32_t period_frames, uint32_t target_fill) {
+    output->ring = ring;
+    output->target_fill = std::min(target_fill, audio_ring_capacity(ring) / 2);
+
+    audio_resampler_init(&output->resampler, host_rate);
+
+    // * whatever was generated before output existed is stale
+    audio_ring_clear(ring);
+
+    return audio_device_open(&output->device, host_rate, period_frames, [output](int16_t* frames, uint32_t cnt) {
+        audio_output_render(output, frames, cnt);
+    });
+}
+
+void ps1::audio_output_stop(audio_output_t* output) {
+    audio_device_close(&output->device);
+}
+
+bool ps1::audio_output_is_active(audio_output_t* output) {
+    return audio_device_is_open(&output->device);
+}
+
+void ps1::audio_output_render(audio_output_t* output, int16_t* frames, uint32_t cnt) {
+    audio_resampler_pull(&output->resampler, output->ring, output->target_fill, frames, cnt);
+}
+
+void ps1::audio_output_wait(audio_output_t* output, uint32_t burst_frames, const std::atomic<bool>& quit) {
+    uint32_t threshold = output->target_fill - std::min(burst_frames / 2, output->target_fill / 2);
+
+    while (!quit) {
+        uint32_t fill = audio_ring_size(output->ring);
+
+        // * device thread stopped, nothing will drain ring any more
+        if (fill <= threshold || !audio_output_is_active(output)) return;
+
+        // * sleep for roughly how long host needs to drain excess, rounding is fine since fill is checked again
+        auto drain = std::chrono::duration<double>((double)(fill - threshold) / AUDIO_SAMPLE_RATE);
+
+        std::this_thread::sleep_for(std::min(std::chrono::duration_cast<std::chrono::steady_clock::duration>(drain), std::chrono::duration_cast<std::chrono::steady_clock::duration>(max_wait)));
+    }
+}
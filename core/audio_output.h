@@ -0,0 +1,57 @@
+#pragma once
+
+#include "defs.h"
+#include "audio.h"
+#include "audio_device.h"
+
+#include <atomic>
+
+namespace ps1 {
+    /*
+    * dynamic rate control resampler from emulated rate to host rate
+    * step between source frames is nudged by up to max_delta around nominal ratio so ring fill drifts back to target,
+    * this absorbs both clock drift between emulation and host device and frame sized bursts of production
+    */
+    struct audio_resampler_t {
+        double nominal_step; // * source frames per host frame
+        double max_delta = .005; // * relative step adjustment at empty or double target fill, small enough to not be heard as pitch shift
+        double position; // * fraction between prev and next source frame
+
+        int16_t prev[AUDIO_CHANNEL_CNT];
+        int16_t next[AUDIO_CHANNEL_CNT];
+    };
+
+    void audio_resampler_init(audio_resampler_t*, uint32_t);
+
+    // * fills host frames from ring. on underrun last frame is held instead of dropping to silence
+    void audio_resampler_pull(audio_resampler_t*, audio_ring_t*, uint32_t, int16_t*, uint32_t);
+
+    /*
+    * host side consumer of audio ring, clock of audio paced emulation
+    * host device callback renders one period at a time and emulation thread keeps ring topped up to target fill
+    */
+    struct audio_output_t {
+        audio_ring_t* ring;
+        audio_resampler_t resampler;
+
+        uint32_t target_fill; // * source frames kept in ring, latency on top of device buffer
+
+        audio_device_t device;
+    };
+
+    // * host rate, period in host frames, target fill in source frames. false if no device could be opened, nothing drains ring then
+    bool audio_output_start(audio_output_t*, audio_ring_t*, uint32_t, uint32_t, uint32_t);
+    void audio_output_stop(audio_output_t*);
+
+    // * whether device is consuming ring and can pace emulation
+    bool audio_output_is_active(audio_output_t*);
+
+    // * one device callback worth of frames, device thread only
+    void audio_output_render(audio_output_t*, int16_t*, uint32_t);
+
+    /*
+    * sleep until ring has room for next burst of source frames, device stops or quit is set. emulation thread only
+    * ring is let down to target fill minus half a burst, so fill averages out at target
+    */
+    void audio_output_wait(audio_output_t*, uint32_t, const std::atomic<bool>&);
+}
@@ -0,0 +1,667 @@
+#include "cdrom.h"
+#include "cpu.h"
+#include "irq.h"
+#include "scheduler.h"
+#include "disc.h"
+#include "logger.h"
+#include "serializer.h"
+
+#include <cstddef>
+
+namespace {
+    // * cycle counts are rough averages of real drive, games only care about order of events
+    constexpr uint64_t ack_delay = 25000;
+    constexpr uint64_t complete_delay = 50000;
+    constexpr uint64_t seek_delay = 100000;
+    constexpr uint64_t redeliver_delay = 1000;
+    constexpr uint64_t sector_delay = ps1::CPU_CLOCK / 75; // * single speed, 75 sectors per second
+
+    constexpr uint32_t prefetch_sector_cnt = 32; // * about half a second ahead at double speed
+
+    constexpr uint32_t user_data_offset = 24; // * mode 2 form 1, after sync, header and subheader
+    constexpr uint32_t user_data_size = 0x800;
+    constexpr uint32_t whole_sector_offset = 12; // * after sync
+    constexpr uint32_t whole_sector_size = 0x924;
+
+    enum struct command_t : uint8_t {
+        getstat = 0x01,
+        setloc = 0x02,
+        play = 0x03,
+        readn = 0x06,
+        motor_on = 0x07,
+        stop = 0x08,
+        pause = 0x09,
+        init = 0x0A,
+        mute = 0x0B,
+        demute = 0x0C,
+        setfilter = 0x0D,
+        setmode = 0x0E,
+        getparam = 0x0F,
+        getloc_l = 0x10,
+        getloc_p = 0x11,
+        get_tn = 0x13,
+        get_td = 0x14,
+        seek_l = 0x15,
+        seek_p = 0x16,
+        test = 0x19,
+        get_id = 0x1A,
+        reads = 0x1B,
+        read_toc = 0x1E,
+    };
+
+    // * second byte of error response
+    constexpr uint8_t error_invalid_param = 0x10;
+    constexpr uint8_t error_invalid_command = 0x40;
+    constexpr uint8_t error_no_disc = 0x80;
+
+    uint8_t bcd_to_bin(uint8_t value) {
+        return (value >> 4) * 10 + (value & 0xF);
+    }
+
+    uint8_t bin_to_bcd(uint8_t value) {
+        return ((value / 10) << 4) | (value % 10);
+    }
+
+    uint8_t param(ps1::cdrom_t* cdrom, uint32_t i) {
+        return i < cdrom->param_cnt ? cdrom->params[i] : 0;
+    }
+
+    uint64_t sector_time(ps1::cdrom_t* cdrom) {
+        return cdrom->mode & ps1::CDROM_MODE_DOUBLE_SPEED ? sector_delay / 2 : sector_delay;
+    }
+
+    void deliver(ps1::cdrom_t* cdrom, const ps1::cdrom_response_t* response) {
+        memcpy(cdrom->response, response->bytes, response->size);
+        cdrom->response_size = response->size;
+        cdrom->response_pos = 0;
+
+        cdrom->irq_flag = (uint8_t)response->type;
+
+        if (response->type == ps1::cdrom_int_t::data_ready) {
+            cdrom->last_sector = response->sector;
+        }
+
+        if (cdrom->irq_flag & cdrom->irq_enable) {
+            ps1::irq_request(cdrom->irq, ps1::irq_line_t::cdrom);
+        }
+    }
+
+    void push_response(ps1::cdrom_t* cdrom, ps1::cdrom_int_t type, std::initializer_list<uint8_t> bytes, uint32_t sector = 0) {
+        ps1::cdrom_response_t response;
+        response.type = type;
+        response.size = (uint8_t)bytes.size();
+        response.sector = sector;
+
+        std::copy(bytes.begin(), bytes.end(), response.bytes);
+
+        if (cdrom->irq_flag == 0 && cdrom->queue_cnt == 0) {
+            deliver(cdrom, &response);
+
+            return;
+        }
+
+        // * drive does not wait for game, unacknowledged sector is replaced by newer one
+        if (type == ps1::cdrom_int_t::data_ready) {
+            for (uint32_t i = 0; i < cdrom->queue_cnt; i++) {
+                if (cdrom->queue[i].type == type) {
+                    cdrom->queue[i] = response;
+
+                    return;
+                }
+            }
+        }
+
+        if (cdrom->queue_cnt == ps1::CDROM_RESPONSE_QUEUE_SIZE) {
+            DEBUG_CODE(ps1::logger::push("response queue overflow", ps1::logger::type_t::warning, "cdrom"));
+
+            return;
+        }
+
+        cdrom->queue[cdrom->queue_cnt++] = response;
+    }
+
+    void push_error(ps1::cdrom_t* cdrom, uint8_t error) {
+        push_response(cdrom, ps1::cdrom_int_t::error, { (uint8_t)(cdrom->stat | ps1::CDROM_STAT_ERROR), error });
+    }
+
+    void stop_drive(ps1::cdrom_t* cdrom) {
+        cdrom->stat &= ~(ps1::CDROM_STAT_READING | ps1::CDROM_STAT_SEEKING | ps1::CDROM_STAT_PLAYING);
+
+        ps1::scheduler_cancel(cdrom->scheduler, ps1::event_slot_t::cdrom_drive);
+    }
+
+    void complete_later(ps1::cdrom_t* cdrom, uint64_t delay) {
+        cdrom->pending_command = cdrom->command;
+
+        ps1::scheduler_schedule(cdrom->scheduler, ps1::event_slot_t::cdrom_complete, delay);
+    }
+
+    // * setloc target is consumed by first seek or read after it
+    bool consume_seek(ps1::cdrom_t* cdrom) {
+        if (!cdrom->seek_pending) return false;
+
+        cdrom->seek_pending = false;
+        cdrom->read_sector = cdrom->seek_target;
+
+        return true;
+    }
+
+    void start_reading(ps1::cdrom_t* cdrom) {
+        uint64_t delay = sector_time(cdrom);
+
+        if (consume_seek(cdrom)) delay += seek_delay;
+
+        cdrom->stat = (cdrom->stat & ~ps1::CDROM_STAT_PLAYING) | ps1::CDROM_STAT_READING;
+
+        ps1::disc_prefetch(cdrom->disc, cdrom->read_sector, prefetch_sector_cnt);
+        ps1::scheduler_schedule(cdrom->scheduler, ps1::event_slot_t::cdrom_drive, delay);
+    }
+
+    void load_data(ps1::cdrom_t* cdrom, uint32_t sector) {
+        bool whole = cdrom->mode & ps1::CDROM_MODE_WHOLE_SECTOR;
+
+        cdrom->data_sector = sector;
+        cdrom->data_offset = whole ? whole_sector_offset : user_data_offset;
+        cdrom->data_size = whole ? whole_sector_size : user_data_size;
+        cdrom->data_pos = 0;
+
+        const uint8_t* raw = ps1::disc_read_sector(cdrom->disc, sector);
+        cdrom->data = raw ? raw + cdrom->data_offset : nullptr;
+    }
+
+    void clear_data(ps1::cdrom_t* cdrom) {
+        cdrom->data = nullptr;
+        cdrom->data_size = 0;
+        cdrom->data_pos = 0;
+    }
+
+    void execute_command(ps1::cdrom_t* cdrom) {
+        using ps1::cdrom_int_t;
+
+        bool has_disc = ps1::disc_is_open(cdrom->disc);
+
+        switch ((command_t)cdrom->command) {
+            case command_t::getstat: {
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                // * shell open is latched until it is read once
+                if (has_disc) {
+                    cdrom->stat = (cdrom->stat & ~ps1::CDROM_STAT_SHELL_OPEN) | ps1::CDROM_STAT_MOTOR;
+                }
+
+                break;
+            }
+
+            case command_t::setloc: {
+                uint32_t m = bcd_to_bin(param(cdrom, 0));
+                uint32_t s = bcd_to_bin(param(cdrom, 1));
+                uint32_t f = bcd_to_bin(param(cdrom, 2));
+
+                cdrom->seek_target = ps1::disc_msf_to_sector(m, s, f);
+                cdrom->seek_pending = true;
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                break;
+            }
+
+            case command_t::play: {
+                // * no cd audio, drive only reports playing state
+                if (!has_disc) {
+                    push_error(cdrom, error_no_disc);
+
+                    break;
+                }
+
+                consume_seek(cdrom);
+                stop_drive(cdrom);
+
+                cdrom->stat |= ps1::CDROM_STAT_PLAYING;
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                break;
+            }
+
+            case command_t::readn:
+            case command_t::reads: {
+                if (!has_disc) {
+                    push_error(cdrom, error_no_disc);
+
+                    break;
+                }
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                start_reading(cdrom);
+
+                break;
+            }
+
+            case command_t::motor_on:
+            case command_t::read_toc: {
+                cdrom->stat |= ps1::CDROM_STAT_MOTOR;
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+                complete_later(cdrom, complete_delay);
+
+                break;
+            }
+
+            case command_t::stop:
+            case command_t::pause: {
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                stop_drive(cdrom);
+                complete_later(cdrom, complete_delay);
+
+                break;
+            }
+
+            case command_t::init: {
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                stop_drive(cdrom);
+                clear_data(cdrom);
+
+                cdrom->mode = ps1::CDROM_MODE_WHOLE_SECTOR;
+                cdrom->stat |= ps1::CDROM_STAT_MOTOR;
+
+                complete_later(cdrom, complete_delay);
+
+                break;
+            }
+
+            case command_t::mute:
+            case command_t::demute: {
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                break;
+            }
+
+            case command_t::setfilter: {
+                cdrom->filter_file = param(cdrom, 0);
+                cdrom->filter_channel = param(cdrom, 1);
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                break;
+            }
+
+            case command_t::setmode: {
+                cdrom->mode = param(cdrom, 0);
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+
+                break;
+            }
+
+            case command_t::getparam: {
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat, cdrom->mode, 0, cdrom->filter_file, cdrom->filter_channel });
+
+                break;
+            }
+
+            case command_t::getloc_l: {
+                const uint8_t* sector = ps1::disc_read_sector(cdrom->disc, cdrom->last_sector);
+
+                if (!sector) {
+                    push_error(cdrom, error_invalid_command);
+
+                    break;
+                }
+
+                // * header and subheader of last sector read
+                push_response(cdrom, cdrom_int_t::acknowledge, { sector[12], sector[13], sector[14], sector[15], sector[16], sector[17], sector[18], sector[19] });
+
+                break;
+            }
+
+            case command_t::getloc_p: {
+                const ps1::disc_track_t* track = ps1::disc_find_track(cdrom->disc, cdrom->last_sector);
+
+                if (!track) {
+                    push_error(cdrom, error_invalid_command);
+
+                    break;
+                }
+
+                uint8_t m, s, f, am, as, af;
+                ps1::disc_sector_to_msf(cdrom->last_sector - track->start, &m, &s, &f);
+                ps1::disc_sector_to_msf(cdrom->last_sector, &am, &as, &af);
+
+                push_response(cdrom, cdrom_int_t::acknowledge, {
+                    bin_to_bcd((uint8_t)track->number), 0x01,
+                    bin_to_bcd(m), bin_to_bcd(s), bin_to_bcd(f),
+                    bin_to_bcd(am), bin_to_bcd(as), bin_to_bcd(af)
+                });
+
+                break;
+            }
+
+            case command_t::get_tn: {
+                if (!has_disc) {
+                    push_error(cdrom, error_no_disc);
+
+                    break;
+                }
+
+                uint8_t first = (uint8_t)cdrom->disc->tracks.front().number;
+                uint8_t last = (uint8_t)cdrom->disc->tracks.back().number;
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat, bin_to_bcd(first), bin_to_bcd(last) });
+
+                break;
+            }
+
+            case command_t::get_td: {
+                uint32_t number = bcd_to_bin(param(cdrom, 0));
+
+                if (!has_disc || number > cdrom->disc->tracks.size()) {
+                    push_error(cdrom, error_invalid_param);
+
+                    break;
+                }
+
+                // * track 0 is lead out
+                uint32_t start = number == 0 ? cdrom->disc->lead_out : cdrom->disc->tracks[number - 1].start;
+
+                uint8_t m, s, f;
+                ps1::disc_sector_to_msf(start, &m, &s, &f);
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat, bin_to_bcd(m), bin_to_bcd(s) });
+
+                break;
+            }
+
+            case command_t::seek_l:
+            case command_t::seek_p: {
+                if (!has_disc) {
+                    push_error(cdrom, error_no_disc);
+
+                    break;
+                }
+
+                stop_drive(cdrom);
+                consume_seek(cdrom);
+
+                cdrom->stat |= ps1::CDROM_STAT_SEEKING;
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+                complete_later(cdrom, seek_delay);
+
+                break;
+            }
+
+            case command_t::test: {
+                // * only bios date and version query is used by games
+                if (param(cdrom, 0) != 0x20) {
+                    push_error(cdrom, error_invalid_param);
+
+                    break;
+                }
+
+                push_response(cdrom, cdrom_int_t::acknowledge, { 0x94, 0x09, 0x19, 0xC0 });
+
+                break;
+            }
+
+            case command_t::get_id: {
+                push_response(cdrom, cdrom_int_t::acknowledge, { cdrom->stat });
+                complete_later(cdrom, complete_delay);
+
+                break;
+            }
+
+            default: {
+                DEBUG_CODE(ps1::logger::push("unhandled command " + std::to_string(cdrom->command), ps1::logger::type_t::warning, "cdrom"));
+
+                push_error(cdrom, error_invalid_command);
+
+                break;
+            }
+        }
+
+        cdrom->param_cnt = 0;
+    }
+
+    void command_event(void* device) {
+        ps1::cdrom_t* cdrom = (ps1::cdrom_t*)device;
+
+        execute_command(cdrom);
+
+        cdrom->busy = false;
+    }
+
+    void complete_event(void* device) {
+        using ps1::cdrom_int_t;
+
+        ps1::cdrom_t* cdrom = (ps1::cdrom_t*)device;
+
+        switch ((command_t)cdrom->pending_command) {
+            case command_t::get_id: {
+                if (!ps1::disc_is_open(cdrom->disc)) {
+                    push_response(cdrom, cdrom_int_t::error, { 0x08, 0x40, 0, 0, 0, 0, 0, 0 });
+
+                    break;
+                }
+
+                // * licensed mode 2 disc, region is reported as america
+                push_response(cdrom, cdrom_int_t::complete, { cdrom->stat, 0x00, 0x20, 0x00, 'S', 'C', 'E', 'A' });
+
+                break;
+            }
+
+            case command_t::stop: {
+                cdrom->stat &= ~ps1::CDROM_STAT_MOTOR;
+
+                push_response(cdrom, cdrom_int_t::complete, { cdrom->stat });
+
+                break;
+            }
+
+            case command_t::seek_l:
+            case command_t::seek_p: {
+                cdrom->stat &= ~ps1::CDROM_STAT_SEEKING;
+
+                push_response(cdrom, cdrom_int_t::complete, { cdrom->stat });
+
+                break;
+            }
+
+            default: {
+                push_response(cdrom, cdrom_int_t::complete, { cdrom->stat });
+
+                break;
+            }
+        }
+    }
+
+    void drive_event(void* device) {
+        ps1::cdrom_t* cdrom = (ps1::cdrom_t*)device;
+
+        if (!(cdrom->stat & ps1::CDROM_STAT_READING)) return;
+
+        if (!ps1::disc_find_track(cdrom->disc, cdrom->read_sector)) {
+            stop_drive(cdrom);
+
+            push_response(cdrom, ps1::cdrom_int_t::data_end, { cdrom->stat });
+
+            return;
+        }
+
+        push_response(cdrom, ps1::cdrom_int_t::data_ready, { cdrom->stat }, cdrom->read_sector);
+
+        cdrom->read_sector++;
+
+        // * keep worker a window ahead so next sectors are resident by the time they are handed out
+        ps1::disc_prefetch(cdrom->disc, cdrom->read_sector, prefetch_sector_cnt);
+        ps1::scheduler_schedule(cdrom->scheduler, ps1::event_slot_t::cdrom_drive, sector_time(cdrom));
+    }
+
+    void irq_event(void* device) {
+        ps1::cdrom_t* cdrom = (ps1::cdrom_t*)device;
+
+        if (cdrom->irq_flag != 0 || cdrom->queue_cnt == 0) return;
+
+        ps1::cdrom_response_t response = cdrom->queue[0];
+
+        cdrom->queue_cnt--;
+        memmove(cdrom->queue, cdrom->queue + 1, cdrom->queue_cnt * sizeof(ps1::cdrom_response_t));
+
+        deliver(cdrom, &response);
+    }
+
+    // * everything from index up to data pointer is plain state
+    constexpr size_t state_offset = offsetof(ps1::cdrom_t, index);
+    constexpr size_t state_size = offsetof(ps1::cdrom_t, data) - state_offset;
+}
+
+void ps1::cdrom_init(cdrom_t* cdrom, scheduler_t* scheduler, irq_t* irq, disc_t* disc) {
+    cdrom->scheduler = scheduler;
+    cdrom->irq = irq;
+    cdrom->disc = disc;
+
+    memset((uint8_t*)cdrom + state_offset, 0, state_size);
+    clear_data(cdrom);
+
+    cdrom->stat = disc_is_open(disc) ? CDROM_STAT_MOTOR : CDROM_STAT_SHELL_OPEN;
+
+    scheduler_register(scheduler, event_slot_t::cdrom_command, command_event, cdrom);
+    scheduler_register(scheduler, event_slot_t::cdrom_complete, complete_event, cdrom);
+    scheduler_register(scheduler, event_slot_t::cdrom_drive, drive_event, cdrom);
+    scheduler_register(scheduler, event_slot_t::cdrom_irq, irq_event, cdrom);
+}
+
+void ps1::cdrom_exit(cdrom_t* cdrom) {}
+
+void ps1::cdrom_save_state(cdrom_t* cdrom, serializer_t* serializer) {
+    serializer_write(serializer, (uint8_t*)cdrom + state_offset, state_size);
+}
+
+void ps1::cdrom_load_state(cdrom_t* cdrom, serializer_t* serializer) {
+    serializer_read(serializer, (uint8_t*)cdrom + state_offset, state_size);
+
+    // * fifo points into disc mapping, it is gone if state was saved with other disc
+    uint32_t pos = cdrom->data_pos;
+
+    if (cdrom->data_size) {
+        load_data(cdrom, cdrom->data_sector);
+        cdrom->data_pos = pos;
+    } else {
+        clear_data(cdrom);
+    }
+}
+
+void ps1::cdrom_disc_changed(cdrom_t* cdrom) {
+    stop_drive(cdrom);
+    clear_data(cdrom);
+
+    cdrom->stat |= CDROM_STAT_SHELL_OPEN;
+}
+
+uint8_t ps1::cdrom_read8(cdrom_t* cdrom, mem_addr_t offset) {
+    switch (offset) {
+        case 0: {
+            uint8_t status = cdrom->index;
+
+            status |= (cdrom->param_cnt == 0) << 3;
+            status |= (cdrom->param_cnt < CDROM_FIFO_SIZE) << 4;
+            status |= (cdrom->response_pos < cdrom->response_size) << 5;
+            status |= (cdrom->data && cdrom->data_pos < cdrom->data_size) << 6;
+            status |= cdrom->busy << 7;
+
+            return status;
+        }
+
+        case 1: {
+            if (cdrom->response_pos >= cdrom->response_size) return 0;
+
+            return cdrom->response[cdrom->response_pos++];
+        }
+
+        case 2: {
+            return cdrom_read_data(cdrom);
+        }
+
+        case 3: {
+            // * upper bits always read as set
+            return (cdrom->index & 1 ? cdrom->irq_flag : cdrom->irq_enable) | 0xE0;
+        }
+    }
+
+    ASSERT(false, "unhandled cdrom fetch");
+
+    return 0;
+}
+
+void ps1::cdrom_write8(cdrom_t* cdrom, mem_addr_t offset, uint8_t value) {
+    // * volume registers and xa sound map are accepted and ignored, there is no cd audio
+    switch (offset) {
+        case 0: {
+            cdrom->index = value & 0x3;
+
+            break;
+        }
+
+        case 1: {
+            if (cdrom->index != 0) break;
+
+            cdrom->command = value;
+            cdrom->busy = true;
+
+            scheduler_schedule(cdrom->scheduler, event_slot_t::cdrom_command, ack_delay);
+
+            break;
+        }
+
+        case 2: {
+            if (cdrom->index == 0) {
+                if (cdrom->param_cnt < CDROM_FIFO_SIZE) {
+                    cdrom->params[cdrom->param_cnt++] = value;
+                }
+            } else if (cdrom->index == 1) {
+                cdrom->irq_enable = value & 0x1F;
+            }
+
+            break;
+        }
+
+        case 3: {
+            if (cdrom->index == 0) {
+                // * want data bit loads sector into fifo, clearing it drops fifo
+                if (!(value & 0x80)) {
+                    clear_data(cdrom);
+                } else if (!cdrom->data || cdrom->data_pos >= cdrom->data_size) {
+                    load_data(cdrom, cdrom->last_sector);
+                }
+            } else if (cdrom->index == 1) {
+                cdrom->irq_flag &= ~(value & 0x1F);
+
+                if (value & 0x40) {
+                    cdrom->param_cnt = 0;
+                }
+
+                if (cdrom->irq_flag == 0 && cdrom->queue_cnt > 0) {
+                    scheduler_schedule(cdrom->scheduler, event_slot_t::cdrom_irq, redeliver_delay);
+                }
+            }
+
+            break;
+        }
+
+        default: {
+            ASSERT(false, "unhandled cdrom store");
+        }
+    }
+}
+
+uint8_t ps1::cdrom_read_data(cdrom_t* cdrom) {
+    if (!cdrom->data || cdrom->data_pos >= cdrom->data_size) return 0;
+
+    return cdrom->data[cdrom->data_pos++];
+}
+
+uint32_t ps1::cdrom_dma_read(cdrom_t* cdrom) {
+    return fetch<cdrom_t, uint32_t>(cdrom, 2);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "defs.h"
+#include "peripheral.h"
+
+namespace ps1 {
+    constexpr uint32_t CDROM_FIFO_SIZE = 16;
+    constexpr uint32_t CDROM_RESPONSE_QUEUE_SIZE = 4;
+
+    // * stat byte returned by most commands
+    constexpr uint8_t CDROM_STAT_ERROR = 0x01;
+    constexpr uint8_t CDROM_STAT_MOTOR = 0x02;
+    constexpr uint8_t CDROM_STAT_ID_ERROR = 0x08;
+    constexpr uint8_t CDROM_STAT_SHELL_OPEN = 0x10;
+    constexpr uint8_t CDROM_STAT_READING = 0x20;
+    constexpr uint8_t CDROM_STAT_SEEKING = 0x40;
+    constexpr uint8_t CDROM_STAT_PLAYING = 0x80;
+
+    // * setmode bits
+    constexpr uint8_t CDROM_MODE_WHOLE_SECTOR = 0x20; // * data fifo gets 0x924 bytes from header on instead of 0x800 bytes of user data
+    constexpr uint8_t CDROM_MODE_DOUBLE_SPEED = 0x80;
+
+    // * interrupt types, reported in irq flag
+    enum struct cdrom_int_t : uint8_t {
+        none = 0,
+        data_ready = 1, // * INT1
+        complete = 2, // * INT2, second response
+        acknowledge = 3, // * INT3, first response
+        data_end = 4, // * INT4
+        error = 5, // * INT5
+    };
+
+    struct cdrom_response_t {
+        cdrom_int_t type;
+        uint8_t size;
+        uint8_t bytes[CDROM_FIFO_SIZE];
+        uint32_t sector; // * absolute sector that comes with data ready response
+    };
+
+    /*
+    * cd-rom controller
+    * 4 byte-wide ports, meaning of ports 1-3 depends on index written to port 0
+    *
+    * command is acknowledged after a delay, commands that take time send second response later.
+    * only one response is visible at a time, next one is delivered after game acknowledges current one
+    *
+    * data fifo is a view into mapped disc image, sectors are never copied
+    */
+    struct cdrom_t {
+        scheduler_t* scheduler;
+        irq_t* irq;
+        disc_t* disc;
+
+        uint8_t index;
+
+        uint8_t params[CDROM_FIFO_SIZE];
+        uint8_t param_cnt;
+
+        uint8_t response[CDROM_FIFO_SIZE];
+        uint8_t response_size;
+        uint8_t response_pos;
+
+        uint8_t irq_enable;
+        uint8_t irq_flag;
+
+        uint8_t command; // * command waiting for acknowledge
+        bool busy;
+
+        // * responses waiting for irq flag to be acknowledged
+        cdrom_response_t queue[CDROM_RESPONSE_QUEUE_SIZE];
+        uint32_t queue_cnt;
+
+        // * second response of command currently being processed
+        uint8_t pending_command;
+
+        uint8_t stat;
+        uint8_t mode;
+        uint8_t filter_file;
+        uint8_t filter_channel;
+
+        uint32_t seek_target; // * absolute sector from setloc
+        bool seek_pending; // * setloc not yet consumed by seek or read
+        uint32_t read_sector; // * next sector drive will deliver
+        uint32_t last_sector; // * last sector delivered with data ready
+
+        // * data fifo, loaded from last sector on request
+        uint32_t data_sector;
+        uint32_t data_offset;
+        uint32_t data_size;
+        uint32_t data_pos;
+        const uint8_t* data; // * null when fifo is empty. rebuilt from data_sector on state load
+    };
+
+    void cdrom_init(cdrom_t*, scheduler_t*, irq_t*, disc_t*);
+    void cdrom_exit(cdrom_t*);
+
+    void cdrom_save_state(cdrom_t*, serializer_t*);
+    void cdrom_load_state(cdrom_t*, serializer_t*);
+
+    // * drive reports shell open until next getstat
+    void cdrom_disc_changed(cdrom_t*);
+
+    uint8_t cdrom_read8(cdrom_t*, mem_addr_t);
+    void cdrom_write8(cdrom_t*, mem_addr_t, uint8_t);
+
+    uint8_t cdrom_read_data(cdrom_t*);
+
+    // * dma channel 3
+    uint32_t cdrom_dma_read(cdrom_t*);
+
+    FETCH_FN(cdrom_t) fetch(void* device, mem_addr_t offset) {
+        cdrom_t* cdrom = (cdrom_t*)device;
+
+        // * wider reads of data port pop several bytes at once
+        if (offset == 2) {
+            type_t value = 0;
+
+            for (uint32_t i = 0; i < sizeof(type_t); i++) {
+                value |= (type_t)cdrom_read_data(cdrom) << (i * 8);
+            }
+
+            return value;
+        }
+
+        return cdrom_read8(cdrom, offset);
+    }
+
+    STORE_FN(cdrom_t) store(void* device, mem_addr_t offset, type_t value) {
+        cdrom_write8((cdrom_t*)device, offset, (uint8_t)value);
+    }
+}
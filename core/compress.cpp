@@ -0,0 +1,195 @@
+#include "compress.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr size_t min_match = 4;
+    constexpr size_t max_offset = 0xffff;
+
+    constexpr uint32_t hash_bits = 16;
+
+    // * incompressible data is skipped faster the longer no match was found
+    constexpr uint32_t skip_shift = 6;
+
+    uint32_t load32(const uint8_t* ptr) {
+        uint32_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    uint64_t load64(const uint8_t* ptr) {
+        uint64_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - hash_bits);
+    }
+
+    void write_length(dyn_arr_t<uint8_t>* out, size_t length) {
+        while (length >= 255) {
+            out->push_back(255);
+            length -= 255;
+        }
+
+        out->push_back((uint8_t)length);
+    }
+
+    bool read_length(const uint8_t** ip, const uint8_t* end, size_t* length) {
+        uint8_t byte;
+
+        do {
+            if (*ip >= end) return false;
+
+            byte = *(*ip)++;
+            *length += byte;
+        } while (byte == 255);
+
+        return true;
+    }
+
+    // * match length is 0 for last sequence
+    void emit(dyn_arr_t<uint8_t>* out, const uint8_t* literals, size_t literal_cnt, size_t offset, size_t match_length) {
+        size_t match_code = match_length ? match_length - min_match : 0;
+
+        out->push_back((uint8_t)((std::min<size_t>(literal_cnt, 15) << 4) | std::min<size_t>(match_code, 15)));
+
+        if (literal_cnt >= 15) {
+            write_length(out, literal_cnt - 15);
+        }
+
+        out->insert(out->end(), literals, literals + literal_cnt);
+
+        if (!match_length) return;
+
+        out->push_back((uint8_t)offset);
+        out->push_back((uint8_t)(offset >> 8));
+
+        if (match_code >= 15) {
+            write_length(out, match_code - 15);
+        }
+    }
+
+    size_t match_length(const uint8_t* a, const uint8_t* b, const uint8_t* end) {
+        const uint8_t* start = b;
+
+        while (b + sizeof(uint64_t) <= end && load64(a) == load64(b)) {
+            a += sizeof(uint64_t);
+            b += sizeof(uint64_t);
+        }
+
+        while (b < end && *a == *b) {
+            a++;
+            b++;
+        }
+
+        return b - start;
+    }
+}
+
+void ps1::lz_compress(const uint8_t* src, size_t size, dyn_arr_t<uint8_t>* out) {
+    // * positions are stored plus one, zero marks empty slot
+    dyn_arr_t<uint32_t> table(1 << hash_bits, 0);
+
+    out->reserve(out->size() + size / 2);
+
+    size_t anchor = 0;
+    size_t i = 0;
+
+    while (i + min_match <= size) {
+        uint32_t sequence = load32(src + i);
+        uint32_t slot = hash(sequence);
+        size_t candidate = table[slot];
+
+        table[slot] = (uint32_t)(i + 1);
+
+        if (candidate && i - (candidate - 1) <= max_offset && load32(src + candidate - 1) == sequence) {
+            size_t match = candidate - 1;
+            size_t length = min_match + match_length(src + match + min_match, src + i + min_match, src + size);
+
+            emit(out, src + anchor, i - anchor, i - match, length);
+
+            i += length;
+            anchor = i;
+        } else {
+            i += 1 + ((i - anchor) >> skip_shift);
+        }
+    }
+
+    emit(out, src + anchor, size - anchor, 0, 0);
+}
+
+bool ps1::lz_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_size) {
+    const uint8_t* ip = src;
+    const uint8_t* end = src + size;
+
+    uint8_t* op = dst;
+    uint8_t* dst_end = dst + dst_size;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        size_t literal_cnt = token >> 4;
+
+        if (literal_cnt == 15 && !read_length(&ip, end, &literal_cnt)) return false;
+        if (literal_cnt > (size_t)(end - ip) || literal_cnt > (size_t)(dst_end - op)) return false;
+
+        memcpy(op, ip, literal_cnt);
+        ip += literal_cnt;
+        op += literal_cnt;
+
+        if (ip == end) break;
+
+        if (end - ip < 2) return false;
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        size_t length = (token & 0xf) + min_match;
+
+        if (length == 15 + min_match && !read_length(&ip, end, &length)) return false;
+        if (offset == 0 || offset > (size_t)(op - dst) || length > (size_t)(dst_end - op)) return false;
+
+        const uint8_t* match = op - offset;
+
+        // * overlapping match repeats last offset bytes, has to go byte by byte
+        if (offset >= length) {
+            memcpy(op, match, length);
+            op += length;
+        } else {
+            for (size_t j = 0; j < length; j++) {
+                *op++ = match[j];
+            }
+        }
+    }
+
+    return op == dst_end;
+}
+
+uint32_t ps1::adler32(const uint8_t* data, size_t size) {
+    constexpr uint32_t modulo = 65521;
+
+    // * largest block before 32 bit sums can overflow
+    constexpr size_t block_size = 5552;
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    while (size) {
+        size_t block = std::min(size, block_size);
+
+        for (size_t i = 0; i < block; i++) {
+            a += data[i];
+            b += a;
+        }
+
+        a %= modulo;
+        b %= modulo;
+
+        data += block;
+        size -= block;
+    }
+
+    return (b << 16) | a;
+}
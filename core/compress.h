@@ -0,0 +1,19 @@
+#pragma once
+
+#include "defs.h"
+
+namespace ps1 {
+    /*
+    * byte oriented lz77 block codec, same sequence layout as lz4 block format
+    * [token: literal count << 4 | match length - 4] [extra literal count] [literals] [16 bit offset] [extra match length]
+    * last sequence carries literals only. no entropy stage, decoding is a plain copy loop
+    */
+
+    // * appends compressed block to out
+    void lz_compress(const uint8_t*, size_t, dyn_arr_t<uint8_t>*);
+
+    // * false if block is malformed or does not decode to exactly given size
+    bool lz_decompress(const uint8_t*, size_t, uint8_t*, size_t);
+
+    uint32_t adler32(const uint8_t*, size_t);
+}
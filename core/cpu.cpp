@@ -1,7 +1,9 @@
 #include "cpu.h"
 #include "bus.h"
+#include "irq.h"
+#include "scheduler.h"
 #include "logger.h"
-#include "file.h"
+#include "serializer.h"
 
 namespace ps1 {
     constexpr cpu_reg_t register_garbage_value = 0xDEADBEEF; // * magic value for debugging
@@ -10,6 +12,13 @@ namespace ps1 {
     // * status register bits
     constexpr uint32_t SR_ISOLATE_CACHE_BIT = 1 << 16; // * redirect all subsequent R/W to cache
     constexpr uint32_t SR_BOOT_EXCEPTION_VECTORS_BIT = 1 << 22; // * BEV bit, 0=RAM/KSEG0, 1=ROM/KSEG1
+    constexpr uint32_t SR_COP2_ENABLE_BIT = 1 << 30; // * CU2 bit, gte instructions raise coprocessor unusable when clear
+    constexpr uint32_t SR_INTERRUPT_ENABLE_BIT = 1 << 0; // * IEc bit
+
+    // * cause register bits
+    constexpr uint32_t CAUSE_PENDING_MASK = 0x700; // * IP bits, [9:8] software and 10 hardware interrupt
+    constexpr uint32_t CAUSE_SOFTWARE_MASK = 0x300;
+    constexpr uint32_t CAUSE_HARDWARE_BIT = 1 << 10;
 
     uint32_t sign_extend_16(uint32_t value) {
         return (uint32_t)(int16_t)value;
@@ -34,6 +43,10 @@ namespace ps1 {
         return cpu->c0regs[12] & SR_ISOLATE_CACHE_BIT;
     }
 
+    bool is_cop2_enabled(cpu_t* cpu) {
+        return cpu->c0regs[12] & SR_COP2_ENABLE_BIT;
+    }
+
     mem_addr_t get_exception_handler_addr(cpu_t* cpu) {
         return (cpu->c0regs[12] & SR_BOOT_EXCEPTION_VECTORS_BIT) ? 0xBFC00180 : 0x80000080;
     }
@@ -54,7 +67,18 @@ namespace ps1 {
         cpu->load_delay_value = v;
     }
 
+    // * mirror interrupt controller output in cause register
+    void update_cause(cpu_t* cpu) {
+        if (irq_is_pending(cpu->irq)) {
+            cpu->c0regs[13] |= CAUSE_HARDWARE_BIT;
+        } else {
+            cpu->c0regs[13] &= ~CAUSE_HARDWARE_BIT;
+        }
+    }
+
     uint32_t get_c0reg(cpu_t* cpu, uint32_t i) {
+        if (i == 13) update_cause(cpu);
+
         return cpu->c0regs[i];
     }
 
@@ -64,12 +88,78 @@ namespace ps1 {
                 logger::push("nonzero value written to hardware breakpoint register", logger::type_t::warning, "cpu")
         );
 
+        // * only software interrupt bits of cause are writable
+        if (i == 13) {
+            v = (cpu->c0regs[13] & ~CAUSE_SOFTWARE_MASK) | (v & CAUSE_SOFTWARE_MASK);
+        }
+
         cpu->c0regs[i] = v;
     }
 }
 
+namespace ps1 {
+    // * kuseg, kseg0 and kseg1 mirror same physical address
+    mem_addr_t watch_addr(mem_addr_t addr) {
+        return addr & 0x1FFFFFFF;
+    }
+
+    bool is_watched(cpu_t* cpu, mem_addr_t addr) {
+        uint32_t page = watch_addr(addr) >> CPU_WATCH_PAGE_SHIFT;
+
+        return cpu->watch->watched_pages[page >> 6] & (1ull << (page & 63));
+    }
+
+    void set_watched(cpu_t* cpu, mem_addr_t addr, bool watched) {
+        uint32_t page = watch_addr(addr) >> CPU_WATCH_PAGE_SHIFT;
+        uint64_t bit = 1ull << (page & 63);
+
+        if (watched) cpu->watch->watched_pages[page >> 6] |= bit;
+        else cpu->watch->watched_pages[page >> 6] &= ~bit;
+    }
+
+    // * page stays watched while anything else is left in it
+    void refresh_watched(cpu_t* cpu, mem_addr_t addr) {
+        uint32_t page = watch_addr(addr) >> CPU_WATCH_PAGE_SHIFT;
+        bool watched = false;
+
+        for (auto& [hook_addr, hooks] : cpu->watch->hooks) {
+            watched = watched || (hook_addr >> CPU_WATCH_PAGE_SHIFT) == page;
+        }
+
+        for (mem_addr_t breakpoint : cpu->watch->breakpoints) {
+            watched = watched || (watch_addr(breakpoint) >> CPU_WATCH_PAGE_SHIFT) == page;
+        }
+
+        set_watched(cpu, addr, watched);
+    }
+
+    /*
+    * hooks may add or remove hooks, themselves included
+    * callback is copied before call so container can change under it
+    */
+    void run_hooks(cpu_t* cpu) {
+        mem_addr_t addr = watch_addr(cpu->pc);
+
+        for (size_t i = 0;;) {
+            auto it = cpu->watch->hooks.find(addr);
+
+            if (it == cpu->watch->hooks.end() || i >= it->second.size()) return;
+
+            cpu_hook_t hook = it->second[i];
+
+            if (hook.fn(cpu)) return;
+
+            it = cpu->watch->hooks.find(addr);
+
+            // * index already points to next hook if this one removed itself
+            if (it != cpu->watch->hooks.end() && i < it->second.size() && it->second[i].id == hook.id) i++;
+        }
+    }
+}
+
 namespace ps1 {
     enum struct exception_t : uint32_t {
+        interrupt = 0x0,
         load = 0x4,
         store = 0x5,
         syscall = 0x8,
@@ -90,7 +180,7 @@ namespace ps1 {
         status = (status & (~0x3F)) | ((status << 2) & 0x3F);
 
         cpu->c0regs[12] = status;
-        cpu->c0regs[13] = ((uint32_t)cause) << 2;
+        cpu->c0regs[13] = (cpu->c0regs[13] & CAUSE_PENDING_MASK) | (((uint32_t)cause) << 2); // * pending interrupts stay visible
         cpu->c0regs[14] = cpu->cpc;
 
         // ! might not work in case of 4 byte forward jump in branching
@@ -103,6 +193,36 @@ namespace ps1 {
         cpu->npc = cpu->pc + sizeof(cpu_instr_t);
     }
 
+    // * status is checked first, interrupts are disabled most of the time and controller does not need to be polled then
+    bool is_interrupt_pending(cpu_t* cpu) {
+        if (!(cpu->c0regs[12] & SR_INTERRUPT_ENABLE_BIT)) return false;
+
+        update_cause(cpu);
+
+        return cpu->c0regs[12] & cpu->c0regs[13] & CAUSE_PENDING_MASK;
+    }
+
+    /*
+    * interrupt is taken between instructions, epc points to instruction that did not run yet
+    * hardware runs gte command that was already in pipeline and bios handler skips it on return,
+    * so interrupt waits until that command has been executed
+    */
+    bool take_interrupt(cpu_t* cpu) {
+        if (cpu->pc % sizeof(cpu_instr_t) != 0) return false;
+
+        cpu_instr_t next = bus_fetch32(cpu->bus, cpu->pc);
+
+        if (next.c.opcode == (uint32_t)cpu_opcode_t::COP2 && (next.raw & (1 << 25))) return false;
+
+        // * same pc layout as if instruction at pc had raised it
+        cpu->cpc = cpu->pc;
+        cpu->pc = cpu->npc;
+
+        throw_exception(cpu, exception_t::interrupt);
+
+        return true;
+    }
+
     /*
     * return from exception
     */
@@ -740,16 +860,78 @@ namespace ps1 {
 
     /*
     * load word from cop2
+    * 32 bit memory aligned fetch from bus into gte data register
     */
     void op_lwc2(cpu_t* cpu, cpu_instr_t instr) {
-        DEBUG_CODE(logger::push("loading from cop2", logger::type_t::error, "cpu"));
+        if (!is_cop2_enabled(cpu)) {
+            throw_exception(cpu, exception_t::cop_absent);
+
+            return;
+        }
+
+        if (is_cache_isolated(cpu)) return;
+
+        mem_addr_t addr = get_reg(cpu, instr.b.rs) + sign_extend_16(instr.b.imm16);
+
+        if (addr % 4 == 0) {
+            gte_write_data(&cpu->gte, instr.b.rt, bus_fetch32(cpu->bus, addr));
+        } else {
+            throw_exception(cpu, exception_t::load);
+        }
     }
 
     /*
     * store word into cop2
+    * 32 bit memory aligned store of gte data register into bus
     */
     void op_swc2(cpu_t* cpu, cpu_instr_t instr) {
-        DEBUG_CODE(logger::push("storing into cop2", logger::type_t::error, "cpu"));
+        if (!is_cop2_enabled(cpu)) {
+            throw_exception(cpu, exception_t::cop_absent);
+
+            return;
+        }
+
+        if (is_cache_isolated(cpu)) return;
+
+        mem_addr_t addr = get_reg(cpu, instr.b.rs) + sign_extend_16(instr.b.imm16);
+
+        if (addr % 4 == 0) {
+            bus_store32(cpu->bus, addr, gte_read_data(&cpu->gte, instr.b.rt));
+        } else {
+            throw_exception(cpu, exception_t::store);
+        }
+    }
+
+    /*
+    * move from cop2
+    * move value from gte data reg to cpu reg
+    */
+    void op_mfc2(cpu_t* cpu, cpu_instr_t instr) {
+        set_reg_delayed(cpu, instr.a.rt, gte_read_data(&cpu->gte, instr.a.rd));
+    }
+
+    /*
+    * move control from cop2
+    * move value from gte control reg to cpu reg
+    */
+    void op_cfc2(cpu_t* cpu, cpu_instr_t instr) {
+        set_reg_delayed(cpu, instr.a.rt, gte_read_ctrl(&cpu->gte, instr.a.rd));
+    }
+
+    /*
+    * move to cop2
+    * move value from cpu reg to gte data reg
+    */
+    void op_mtc2(cpu_t* cpu, cpu_instr_t instr) {
+        gte_write_data(&cpu->gte, instr.a.rd, get_reg(cpu, instr.a.rt));
+    }
+
+    /*
+    * move control to cop2
+    * move value from cpu reg to gte control reg
+    */
+    void op_ctc2(cpu_t* cpu, cpu_instr_t instr) {
+        gte_write_ctrl(&cpu->gte, instr.a.rd, get_reg(cpu, instr.a.rt));
     }
 
     // handle invalid cpu instruction
@@ -793,9 +975,23 @@ namespace ps1 {
         throw_exception(cpu, exception_t::cop_absent);
     }
 
-    // * cop2
+    // * cop2, geometry transformation engine
     void execute_cop2(cpu_t* cpu, cpu_instr_t instr) {
-        DEBUG_CODE(execute_err(cpu, instr));
+        if (!is_cop2_enabled(cpu)) {
+            throw_exception(cpu, exception_t::cop_absent);
+        } else if (instr.a.rs & 0b10000) {
+            gte_execute(&cpu->gte, instr.raw);
+        } else if (instr.a.rs == 0b00000) {
+            op_mfc2(cpu, instr);
+        } else if (instr.a.rs == 0b00010) {
+            op_cfc2(cpu, instr);
+        } else if (instr.a.rs == 0b00100) {
+            op_mtc2(cpu, instr);
+        } else if (instr.a.rs == 0b00110) {
+            op_ctc2(cpu, instr);
+        } else {
+            DEBUG_CODE(execute_err(cpu, instr));
+        }
     }
 
     // * cop3 not implemented on ps1
@@ -905,8 +1101,11 @@ namespace ps1 {
     }
 }
 
-void ps1::cpu_init(cpu_t* cpu, bus_t* bus) {
+void ps1::cpu_init(cpu_t* cpu, cpu_watch_t* watch, bus_t* bus, irq_t* irq, scheduler_t* scheduler) {
+    cpu->watch = watch;
     cpu->bus = bus;
+    cpu->irq = irq;
+    cpu->scheduler = scheduler;
 
     // * initialize registers to garbage value
     for (int i = 1; i < 32; i++) {
@@ -929,11 +1128,27 @@ void ps1::cpu_init(cpu_t* cpu, bus_t* bus) {
     set_reg_delayed(cpu, 0, 0);
 
     cpu->c0regs[12] = 0; // * set cop0 status register to 0
+    cpu->c0regs[13] = 0; // * no interrupt pending
+
+    gte_init(&cpu->gte);
 
     cpu_set_state(cpu, cpu_state_t::sleeping);
 
+    cpu->cycle_cnt = 0;
+
     // ! debug
     cpu->instr_exec_cnt = 0;
+
+    // * hooks and breakpoints survive reset
+    memset(cpu->watch->watched_pages, 0, sizeof(cpu->watch->watched_pages));
+
+    for (auto& [addr, hooks] : cpu->watch->hooks) {
+        set_watched(cpu, addr, true);
+    }
+
+    for (mem_addr_t addr : cpu->watch->breakpoints) {
+        set_watched(cpu, addr, true);
+    }
 }
 
 void ps1::cpu_exit(cpu_t* cpu) {
@@ -941,6 +1156,14 @@ void ps1::cpu_exit(cpu_t* cpu) {
 }
 
 void ps1::cpu_tick(cpu_t* cpu) {
+    cpu->cycle_cnt += CPU_CYCLES_PER_INSTR;
+
+    if (cpu->cycle_cnt >= cpu->scheduler->next) {
+        scheduler_run(cpu->scheduler);
+    }
+
+    if (is_interrupt_pending(cpu) && take_interrupt(cpu)) return;
+
     cpu->cpc = cpu->pc; // * update current program counter
 
     if (cpu->cpc % sizeof(cpu_instr_t) != 0) {
@@ -979,8 +1202,11 @@ void ps1::cpu_tick(cpu_t* cpu) {
         // if (cpu->instr_exec_cnt == 79310) ps1::cpu_set_state(cpu, ps1::cpu_state_t::sleeping);
     }
 
-    
-    if (cpu->breakpoints.contains(cpu->pc)) {
+    if (!is_watched(cpu, cpu->pc)) return;
+
+    run_hooks(cpu);
+
+    if (cpu->watch->breakpoints.contains(cpu->pc)) {
         cpu_set_state(cpu, cpu_state_t::sleeping);
 
         return;
@@ -993,56 +1219,103 @@ void ps1::cpu_set_state(cpu_t* cpu, cpu_state_t cpu_state) {
     DEBUG_CODE(if (cpu_state == cpu_state_t::halted) logger::push("CPU HALTED", logger::type_t::error, "cpu"));
 }
 
-void ps1::cpu_save_state(cpu_t* cpu) {
-    file::write32(cpu->load_delay_target);
-    file::write32(cpu->load_delay_value);
+void ps1::cpu_jump(cpu_t* cpu, mem_addr_t addr) {
+    cpu->pc = addr;
+    cpu->cpc = addr;
+    cpu->npc = addr + sizeof(cpu_instr_t);
 
-    for (auto val : cpu->in_regs) {
-        file::write32(val);
-    }
+    set_reg(cpu, cpu->load_delay_target, cpu->load_delay_value);
+    set_reg_delayed(cpu, 0, 0);
 
-    for (auto val : cpu->out_regs) {
-        file::write32(val);
-    }
+    memcpy(cpu->in_regs, cpu->out_regs, sizeof(cpu_reg_t) * 32);
+}
+
+void ps1::cpu_set_reg(cpu_t* cpu, uint32_t i, cpu_reg_t value) {
+    if (i == 0) return;
 
-    file::write32(cpu->hi);
-    file::write32(cpu->lo);
+    cpu->in_regs[i] = value;
+    cpu->out_regs[i] = value;
+}
 
-    file::write32(cpu->cpc);
-    file::write32(cpu->pc);
-    file::write32(cpu->npc);
+uint32_t ps1::cpu_add_hook(cpu_t* cpu, mem_addr_t addr, cpu_hook_fn_t fn) {
+    uint32_t id = ++cpu->watch->next_hook_id;
 
-    for (auto val : cpu->c0regs) {
-        file::write32(val);
-    }
+    cpu->watch->hooks[watch_addr(addr)].push_back({ id, std::move(fn) });
+    set_watched(cpu, addr, true);
 
-    file::write32(cpu->instr_exec_cnt);
+    return id;
 }
 
-void ps1::cpu_load_state(cpu_t* cpu) {
-    cpu->load_delay_target = file::read32();
-    cpu->load_delay_value = file::read32();
+void ps1::cpu_remove_hook(cpu_t* cpu, uint32_t id) {
+    for (auto it = cpu->watch->hooks.begin(); it != cpu->watch->hooks.end(); it++) {
+        dyn_arr_t<cpu_hook_t>& hooks = it->second;
 
-    for (auto& val : cpu->in_regs) {
-        val = file::read32();
-    }
+        for (size_t i = 0; i < hooks.size(); i++) {
+            if (hooks[i].id != id) continue;
 
-    for (auto& val : cpu->out_regs) {
-        val = file::read32();
-    }
+            mem_addr_t addr = it->first;
 
-    cpu->hi = file::read32();
-    cpu->lo = file::read32();
+            hooks.erase(hooks.begin() + i);
 
-    cpu->cpc = file::read32();
-    cpu->pc = file::read32();
-    cpu->npc = file::read32();
+            if (hooks.empty()) {
+                cpu->watch->hooks.erase(it);
+                refresh_watched(cpu, addr);
+            }
 
-    for (auto& val : cpu->c0regs) {
-        val = file::read32();
+            return;
+        }
     }
+}
+
+void ps1::cpu_add_breakpoint(cpu_t* cpu, mem_addr_t addr) {
+    cpu->watch->breakpoints.insert(addr);
+    set_watched(cpu, addr, true);
+}
+
+void ps1::cpu_remove_breakpoint(cpu_t* cpu, mem_addr_t addr) {
+    if (cpu->watch->breakpoints.erase(addr)) refresh_watched(cpu, addr);
+}
+
+void ps1::cpu_save_state(cpu_t* cpu, serializer_t* serializer) {
+    serializer_write32(serializer, cpu->load_delay_target);
+    serializer_write32(serializer, cpu->load_delay_value);
+
+    serializer_write(serializer, cpu->in_regs, sizeof(cpu->in_regs));
+    serializer_write(serializer, cpu->out_regs, sizeof(cpu->out_regs));
+
+    serializer_write32(serializer, cpu->hi);
+    serializer_write32(serializer, cpu->lo);
+
+    serializer_write32(serializer, cpu->cpc);
+    serializer_write32(serializer, cpu->pc);
+    serializer_write32(serializer, cpu->npc);
+
+    serializer_write(serializer, cpu->c0regs, sizeof(cpu->c0regs));
+
+    gte_save_state(&cpu->gte, serializer);
+
+    serializer_write32(serializer, cpu->instr_exec_cnt);
+}
+
+void ps1::cpu_load_state(cpu_t* cpu, serializer_t* serializer) {
+    cpu->load_delay_target = serializer_read32(serializer);
+    cpu->load_delay_value = serializer_read32(serializer);
+
+    serializer_read(serializer, cpu->in_regs, sizeof(cpu->in_regs));
+    serializer_read(serializer, cpu->out_regs, sizeof(cpu->out_regs));
+
+    cpu->hi = serializer_read32(serializer);
+    cpu->lo = serializer_read32(serializer);
+
+    cpu->cpc = serializer_read32(serializer);
+    cpu->pc = serializer_read32(serializer);
+    cpu->npc = serializer_read32(serializer);
+
+    serializer_read(serializer, cpu->c0regs, sizeof(cpu->c0regs));
+
+    gte_load_state(&cpu->gte, serializer);
 
-    cpu->instr_exec_cnt = file::read32();
+    cpu->instr_exec_cnt = serializer_read32(serializer);
 
     cpu_set_state(cpu, cpu_state_t::sleeping);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defs.h"
+#include "gte.h"
 
 namespace ps1 {
 #pragma pack(push, 1) // ! it must always be 4 bytes
@@ -123,6 +124,46 @@ namespace ps1 {
         SLTU = 0b101011,
     };
 
+    constexpr uint32_t CPU_CLOCK = 33868800; // * 33.8688 MHz
+
+    /*
+    * interpreter has no pipeline or memory wait state model
+    * average R3000A throughput with cache misses and bus waits is used for every instruction
+    */
+    constexpr uint32_t CPU_CYCLES_PER_INSTR = 2;
+
+    /*
+    * guest pc watch granularity. a bit per physical page tells whether any hook or breakpoint sits in it
+    * instructions on unwatched pages pay a single bit test
+    */
+    constexpr uint32_t CPU_WATCH_PAGE_SHIFT = 12; // * 4 kb
+    constexpr uint32_t CPU_WATCH_PAGE_CNT = (1 << 29) >> CPU_WATCH_PAGE_SHIFT; // * whole 512 mb physical space
+
+    /*
+    * native callback run when cpu arrives at guest address, before instruction there is executed
+    * returns true if it redirected execution, remaining hooks at that address are skipped
+    */
+    typedef func_t<bool(cpu_t*)> cpu_hook_fn_t;
+
+    struct cpu_hook_t {
+        uint32_t id;
+        cpu_hook_fn_t fn;
+    };
+
+    /*
+    * hooks and breakpoints, lives next to cpu_t so copying cpu state does not copy callbacks
+    * not part of console state, survives reset and state loads
+    */
+    struct cpu_watch_t {
+        set_t<mem_addr_t> breakpoints; // * breakpoints, exact virtual address
+
+        // * hooks match every mirror of address, keyed by physical address
+        umap_t<mem_addr_t, dyn_arr_t<cpu_hook_t>> hooks;
+        uint32_t next_hook_id = 0;
+
+        uint64_t watched_pages[CPU_WATCH_PAGE_CNT / 64] = {};
+    };
+
     enum struct cpu_state_t {
         sleeping,
         running,
@@ -188,7 +229,7 @@ namespace ps1 {
         * reg 7 DCIC, used to enable and disable the various hardware breakpoints
         * reg 9 BDAM, it’s a bitmask applied when testing for BDA above. can trigger on a range of address instead of a single one.
         * reg 11 BPCM, same as BDAM but for BPC
-        * reg 13 cause of exception. readonly.  bits [9:8] are writable to force an exception
+        * reg 13 cause of exception. readonly.  bits [9:8] are writable to force an exception, bit 10 mirrors interrupt controller
         * 
         * reg 12 (status register):
         * bit 16 - redirects all bus r/w to cache
@@ -196,17 +237,23 @@ namespace ps1 {
         */
         cpu_reg_t c0regs[32];
 
+        gte_t gte; // * cop2
+
+        cpu_watch_t* watch;
         bus_t* bus;
+        irq_t* irq; // * drives cop0 cause bit 10
+        scheduler_t* scheduler; // * device events are fired between instructions
 
         cpu_state_t state;
 
+        uint64_t cycle_cnt; // * elapsed cpu cycles, drives frame pacing
+
         // ! debug data
         uint32_t instr_exec_cnt; // * number of instructions executed
-        set_t<mem_addr_t> breakpoints; // * breakpoints
     };
 
      // * init scpu state
-    void cpu_init(cpu_t*, bus_t*);
+    void cpu_init(cpu_t*, cpu_watch_t*, bus_t*, irq_t*, scheduler_t*);
 
      // * clear scpu state
     void cpu_exit(cpu_t*);
@@ -216,10 +263,24 @@ namespace ps1 {
 
     // * put cpu in specified state
     void cpu_set_state(cpu_t*, cpu_state_t);
+
+    // * continue execution at address. pending branch and load delay are dropped
+    void cpu_jump(cpu_t*, mem_addr_t);
+
+    // * write general purpose register outside of instruction flow
+    void cpu_set_reg(cpu_t*, uint32_t, cpu_reg_t);
+
+    // * returns id used for removal. hooks at same address run in order of registration
+    uint32_t cpu_add_hook(cpu_t*, mem_addr_t, cpu_hook_fn_t);
+    void cpu_remove_hook(cpu_t*, uint32_t);
+
+    // * cpu goes to sleep once it arrives at address
+    void cpu_add_breakpoint(cpu_t*, mem_addr_t);
+    void cpu_remove_breakpoint(cpu_t*, mem_addr_t);
     
-    // * save cpu state to file
-    void cpu_save_state(cpu_t*);
+    // * save cpu state
+    void cpu_save_state(cpu_t*, serializer_t*);
 
-    // * load cpu state from file
-    void cpu_load_state(cpu_t*);
+    // * load cpu state
+    void cpu_load_state(cpu_t*, serializer_t*);
 }
\ No newline at end of file
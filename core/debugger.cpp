@@ -30,18 +30,25 @@ namespace {
 }
 
 namespace ps1 {
-    void display_emulation_view(ps1_t* console, emulation_settings_t* settings) {
+    void display_emulation_view(emulation_t* emulation, emulation_snapshot_t* snapshot) {
         static char save_state_path[128] = "saves/state.bin";
         static char load_state_path[128] = "saves/state.bin";
+        static char exe_path[128] = "exe/main.exe";
+        static char disc_path[128] = "discs/game.cue";
 
         ImGui::Begin("Emulation");
 
             if (ImGui::Button("Soft Reset")) {
-                ps1_soft_reset(console);
+                emulation_post(emulation, [emulation](ps1_t* console, emulation_settings_t*) {
+                    ps1_soft_reset(console);
+                    emulation_rewind_clear(emulation);
+                });
             }
 
             if (ImGui::Button("Save State")) {
-                ps1_save_state(console, save_state_path);
+                emulation_post(emulation, [path = str_t(save_state_path)](ps1_t* console, emulation_settings_t*) {
+                    ps1_begin_save_state(console, path);
+                });
             }
 
             ImGui::SameLine();
@@ -50,7 +57,11 @@ namespace ps1 {
             ImGui::InputText("##save_state_path", save_state_path, sizeof(save_state_path));
 
             if (ImGui::Button("Load State")) {
-                ps1_load_state(console, load_state_path);
+                emulation_post(emulation, [emulation, path = str_t(load_state_path)](ps1_t* console, emulation_settings_t*) {
+                    if (ps1_load_state(console, path)) {
+                        emulation_rewind_clear(emulation);
+                    }
+                });
             }
 
             ImGui::SameLine();
@@ -58,14 +69,142 @@ namespace ps1 {
             ImGui::SetNextItemWidth(-1);
             ImGui::InputText("##load_state_path", load_state_path, sizeof(load_state_path));
 
+            // * exe is loaded once bios reaches shell
+            if (ImGui::Button("Load EXE")) {
+                emulation_post(emulation, [path = str_t(exe_path)](ps1_t* console, emulation_settings_t*) {
+                    ps1_sideload_exe(console, path);
+                });
+            }
+
+            ImGui::SameLine();
+
+            ImGui::SetNextItemWidth(-1);
+            ImGui::InputText("##exe_path", exe_path, sizeof(exe_path));
+
+            if (ImGui::Button("Load Disc")) {
+                emulation_post(emulation, [path = str_t(disc_path)](ps1_t* console, emulation_settings_t*) {
+                    ps1_insert_disc(console, path);
+                });
+            }
+
+            ImGui::SameLine();
+
+            ImGui::SetNextItemWidth(-1);
+            ImGui::InputText("##disc_path", disc_path, sizeof(disc_path));
+
             ImGui::Spacing();
+            bool uncapped = snapshot->settings.uncapped;
+            if (ImGui::Checkbox("Uncapped", &uncapped)) {
+                emulation_post(emulation, [uncapped](ps1_t*, emulation_settings_t* settings) {
+                    settings->uncapped = uncapped;
+                });
+            }
+
+            ImGui::SameLine();
+            bool audio_sync = snapshot->settings.audio_sync;
+            if (ImGui::Checkbox("Audio Sync", &audio_sync)) {
+                emulation_post(emulation, [audio_sync](ps1_t*, emulation_settings_t* settings) {
+                    settings->audio_sync = audio_sync;
+                });
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("pace frames by audio device instead of wall clock, only at 1x");
+            }
+
             ImGui::AlignTextToFramePadding();
-            ImGui::Text("Instructions Per Frame");
+            ImGui::Text("Speed");
+            ImGui::SameLine();
+            float speed = snapshot->settings.speed;
+            if (ImGui::SliderFloat("##speed", &speed, .25f, 4.f, "%.2fx")) {
+                emulation_post(emulation, [speed](ps1_t*, emulation_settings_t* settings) {
+                    settings->speed = speed;
+                });
+            }
+
+            // * only applied while fast forwarding
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("Frame Skip");
+            ImGui::SameLine();
+            int32_t skip[2] = { snapshot->settings.skip_frames, snapshot->settings.skip_period };
+            if (ImGui::InputInt2("##frame_skip", skip)) {
+                int32_t skip_period = std::min(std::max(skip[1], 1), 60);
+                int32_t skip_frames = std::min(std::max(skip[0], 0), skip_period - 1);
+
+                emulation_post(emulation, [skip_frames, skip_period](ps1_t*, emulation_settings_t* settings) {
+                    settings->skip_frames = skip_frames;
+                    settings->skip_period = skip_period;
+                });
+            }
+
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("frames skipped out of every period while uncapped or faster than 1x");
+            }
+
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("Run Ahead");
+            ImGui::SameLine();
+            int32_t run_ahead = snapshot->settings.run_ahead;
+            if (ImGui::SliderInt("##run_ahead", &run_ahead, 0, 4, "%d frames")) {
+                emulation_post(emulation, [run_ahead](ps1_t*, emulation_settings_t* settings) {
+                    settings->run_ahead = run_ahead;
+                });
+            }
+
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("Resolution Scale");
+            ImGui::SameLine();
+            int32_t resolution_scale = snapshot->settings.resolution_scale;
+            if (ImGui::SliderInt("##resolution_scale", &resolution_scale, 1, 8, "%dx")) {
+                emulation_post(emulation, [resolution_scale](ps1_t* console, emulation_settings_t* settings) {
+                    settings->resolution_scale = resolution_scale;
+                    vram_set_resolution_scale(&console->vram, resolution_scale);
+                });
+            }
+
+            bool hle = snapshot->settings.hle;
+            if (ImGui::Checkbox("BIOS HLE", &hle)) {
+                emulation_post(emulation, [hle](ps1_t* console, emulation_settings_t* settings) {
+                    settings->hle = hle;
+                    ps1_set_hle(console, hle);
+                });
+            }
+
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("service memcpy, strlen, printf and similar kernel calls natively");
+            }
+
+            ImGui::Spacing();
+            bool rewind = snapshot->settings.rewind;
+            if (ImGui::Checkbox("Rewind", &rewind)) {
+                emulation_post(emulation, [emulation, rewind](ps1_t*, emulation_settings_t* settings) {
+                    settings->rewind = rewind;
+
+                    if (!rewind) {
+                        emulation_rewind_clear(emulation);
+                    }
+                });
+            }
+
             ImGui::SameLine();
-            if (ImGui::InputInt("##instr_per_frame", &settings->instr_per_frame)) {
-                settings->instr_per_frame = std::min(std::max(settings->instr_per_frame, 0), 30000);
+            ImGui::SetNextItemWidth(-1);
+            int32_t rewind_interval = snapshot->settings.rewind_interval;
+            if (ImGui::SliderInt("##rewind_interval", &rewind_interval, 1, 60, "every %d frames")) {
+                emulation_post(emulation, [rewind_interval](ps1_t*, emulation_settings_t* settings) {
+                    settings->rewind_interval = rewind_interval;
+                });
             }
 
+            // * one step per ui frame while held
+            ImGui::Button("Hold To Rewind");
+            if (ImGui::IsItemActive() && snapshot->settings.rewind) {
+                emulation_post(emulation, [emulation](ps1_t*, emulation_settings_t*) {
+                    emulation_rewind(emulation);
+                });
+            }
+
+            ImGui::SameLine();
+            ImGui::Text("%u states, %.1f MB", emulation->rewind.state_cnt.load(), emulation->rewind.total_bytes.load() / (1024.f * 1024.f));
+
         ImGui::End();
     }
 
@@ -195,54 +334,53 @@ namespace ps1 {
 }
 
 namespace ps1 {
-    uint32_t bus_fetch32_debug(bus_t* bus, mem_addr_t mem_addr) {
-        ASSERT(mem_addr % 4 == 0, "Unaligned memory access");
+    void display_cpu_view(emulation_t* emulation, emulation_snapshot_t* snapshot) {
+        cpu_t* cpu = &snapshot->cpu;
 
-        mem_addr = mask_addr(mem_addr);
-
-        for (auto& device_info : bus->devices) {
-            if (device_info.mem_range.contains(mem_addr)) {
-                return device_info.fetch32(device_info.device, device_info.mem_range.offset(mem_addr));
-            }
-        }
-
-        return 0;
-    }
-
-    void display_cpu_view(cpu_t* cpu, bus_t* bus) {
         ImGui::Begin("CPU");
 
             if (cpu->state == cpu_state_t::halted) {
                 if (ImGui::Button("Revive")) {
-                    cpu_set_state(cpu, cpu_state_t::sleeping);
+                    emulation_post(emulation, [](ps1_t* console, emulation_settings_t*) {
+                        cpu_set_state(&console->cpu, cpu_state_t::sleeping);
+                    });
                 }
             } else if (cpu->state == cpu_state_t::running) {
                 if (ImGui::Button("Stop")) {
-                    cpu_set_state(cpu, cpu_state_t::sleeping);
+                    emulation_post(emulation, [](ps1_t* console, emulation_settings_t*) {
+                        cpu_set_state(&console->cpu, cpu_state_t::sleeping);
+                    });
                 }
             } else {
                 if (ImGui::Button("Run")) {
-                    cpu_set_state(cpu, cpu_state_t::running);
+                    emulation_post(emulation, [](ps1_t* console, emulation_settings_t*) {
+                        cpu_set_state(&console->cpu, cpu_state_t::running);
+                    });
                 }
 
                 ImGui::SameLine();
 
                 DEBUG_CODE(
                     if (ImGui::Button("Jump")) {
-                        cpu_set_state(cpu, cpu_state_t::running);
-                        
-                        while (true) {
-                            if (cpu->state != ps1::cpu_state_t::running) break;
+                        // * runs unpaced on emulation thread until breakpoint
+                        emulation_post(emulation, [](ps1_t* console, emulation_settings_t*) {
+                            cpu_set_state(&console->cpu, cpu_state_t::running);
                             
-                            ps1::cpu_tick(cpu);
-                        }
+                            while (true) {
+                                if (console->cpu.state != ps1::cpu_state_t::running) break;
+                                
+                                ps1::cpu_tick(&console->cpu);
+                            }
+                        });
                     }
 
                     ImGui::SameLine();
                 );
 
                 if (ImGui::Button("Step")) {
-                    cpu_tick(cpu);
+                    emulation_post(emulation, [](ps1_t* console, emulation_settings_t*) {
+                        cpu_tick(&console->cpu);
+                    });
                 }
             }
 
@@ -289,7 +427,7 @@ namespace ps1 {
                     ImGui::TableNextColumn();
                     ImGui::TextWrapped("Instruction");
 
-                    uint32_t instr = bus_fetch32_debug(bus, cpu->pc);
+                    uint32_t instr = emulation_fetch32(emulation, snapshot, cpu->pc);
                     
                     ImGui::TableNextColumn();
                     ImGui::TextWrapped("0x%08X", instr);
@@ -357,7 +495,9 @@ namespace ps1 {
         ImGui::End();
     }
 
-    void display_instr_view(cpu_t* cpu, bus_t* bus) {
+    void display_instr_view(emulation_t* emulation, emulation_snapshot_t* snapshot) {
+        cpu_t* cpu = &snapshot->cpu;
+
         static mem_addr_t addr_inp = BIOS_ENTRY;
         static mem_addr_t addr = BIOS_ENTRY;
         static bool follow_pc = true;
@@ -397,13 +537,13 @@ namespace ps1 {
                     }
                     
                     for (mem_addr_t offset = addr - instr_radius * sizeof(cpu_instr_t); offset < addr; offset += sizeof(cpu_instr_t)) {
-                        display_instr(cpu, offset, bus_fetch32_debug(bus, offset));
+                        display_instr(cpu, offset, emulation_fetch32(emulation, snapshot, offset));
                     }
 
-                    display_instr(cpu, addr, bus_fetch32_debug(bus, addr));
+                    display_instr(cpu, addr, emulation_fetch32(emulation, snapshot, addr));
                     
                     for (mem_addr_t offset = addr + sizeof(cpu_instr_t); offset <= addr + instr_radius * sizeof(cpu_instr_t); offset += sizeof(cpu_instr_t)) {
-                        display_instr(cpu, offset, bus_fetch32_debug(bus, offset));
+                        display_instr(cpu, offset, emulation_fetch32(emulation, snapshot, offset));
                     }
                     
                     ImGui::EndTable();
@@ -420,7 +560,7 @@ namespace ps1 {
         ImGui::End();
     }
 
-    void display_memory_view(bus_t* bus) {
+    void display_memory_view(emulation_t* emulation, emulation_snapshot_t* snapshot) {
         static mem_addr_t addr_inp = 0;
         static mem_addr_t addr = 0;
         bool update = false;
@@ -446,7 +586,7 @@ namespace ps1 {
                     static uint32_t radius = sizeof(cpu_instr_t) * 32;
                     
                     for (mem_addr_t offset = addr >= radius ? addr - radius : 0; offset <= std::min(addr + radius, (BIOS_KSEG1 + BIOS_SIZE - 1)); offset += sizeof(cpu_instr_t)) {
-                        display_memory(offset, bus_fetch32_debug(bus, offset), offset == addr);
+                        display_memory(offset, emulation_fetch32(emulation, snapshot, offset), offset == addr);
                     }
                     
                     ImGui::EndTable();
@@ -463,7 +603,7 @@ namespace ps1 {
         ImGui::End();
     }
 
-    void display_breakpoints_view(cpu_t* cpu) {
+    void display_breakpoints_view(emulation_t* emulation, emulation_snapshot_t* snapshot) {
         static mem_addr_t addr_inp = 0;
         static mem_addr_t erase_value = 0;
         static bool should_erase = false;
@@ -474,14 +614,16 @@ namespace ps1 {
             ImGui::InputScalar("##input_addr", ImGuiDataType_U32, &addr_inp, nullptr, nullptr, "%x", ImGuiInputTextFlags_CharsHexadecimal);
             ImGui::SameLine();
             if (ImGui::Button("Add")) {
-                cpu->breakpoints.emplace(addr_inp);
+                emulation_post(emulation, [addr = addr_inp](ps1_t* console, emulation_settings_t*) {
+                    cpu_add_breakpoint(&console->cpu, addr);
+                });
             }
             
             ImGui::Spacing();
 
             ImGui::BeginChild("breakpoints_view");
             
-            for (mem_addr_t addr : cpu->breakpoints) {
+            for (mem_addr_t addr : snapshot->breakpoints) {
                 ImGui::AlignTextToFramePadding();
                 ImGui::Text("0x%08X", addr);
                 ImGui::SameLine();
@@ -492,7 +634,9 @@ namespace ps1 {
             }
 
             if (should_erase) {
-                cpu->breakpoints.erase(erase_value);
+                emulation_post(emulation, [addr = erase_value](ps1_t* console, emulation_settings_t*) {
+                    cpu_remove_breakpoint(&console->cpu, addr);
+                });
                 should_erase = false;
             }
 
@@ -573,6 +717,62 @@ namespace ps1 {
                 ImGui::TreePop();
             }
 
+            if (ImGui::TreeNode("Frame Stats")) {
+                gpu_stats_t& stats = gpu->stats;
+                gpu_frame_stats_t& frame = stats.last;
+                ImVec2 graph_size = ImVec2(-1, 40);
+
+                ImGui::Text("frame: %u", stats.frame_cnt);
+
+                ImGui::Text("gp0 time: %.3f ms", frame.gp0_time_ns / 1e6);
+                ImGui::PlotLines("##gp0_time", stats.gp0_time_ms, GPU_STATS_HISTORY_SIZE, stats.history_index, nullptr, 0.f, FLT_MAX, graph_size);
+
+                ImGui::Text("primitives: %.0f", stats.primitive_cnt[(stats.history_index + GPU_STATS_HISTORY_SIZE - 1) % GPU_STATS_HISTORY_SIZE]);
+                ImGui::PlotLines("##primitives", stats.primitive_cnt, GPU_STATS_HISTORY_SIZE, stats.history_index, nullptr, 0.f, FLT_MAX, graph_size);
+
+                ImGui::Text("vertices: %u", frame.vertex_cnt);
+                ImGui::PlotLines("##vertices", stats.vertex_cnt, GPU_STATS_HISTORY_SIZE, stats.history_index, nullptr, 0.f, FLT_MAX, graph_size);
+
+                ImGui::Text("pixels: %llu", (unsigned long long)frame.pixel_cnt);
+                ImGui::PlotLines("##pixels", stats.pixel_cnt, GPU_STATS_HISTORY_SIZE, stats.history_index, nullptr, 0.f, FLT_MAX, graph_size);
+
+                ImGui::Text("uploaded: %.1f KB", frame.upload_bytes / 1024.f);
+                ImGui::PlotLines("##uploaded", stats.upload_kb, GPU_STATS_HISTORY_SIZE, stats.history_index, nullptr, 0.f, FLT_MAX, graph_size);
+
+                ImGui::Text("draw calls: %u", frame.draw_call_cnt);
+                ImGui::PlotLines("##draw_calls", stats.draw_call_cnt, GPU_STATS_HISTORY_SIZE, stats.history_index, nullptr, 0.f, FLT_MAX, graph_size);
+
+                ImGui::Text("flushes: %u", frame.flush_cnt);
+
+                if (ImGui::TreeNode("Commands")) {
+                    if (ImGui::BeginTable("gp0_cmd_stats", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp)) {
+                        ImGui::TableSetupColumn("Opcode", 0, 1);
+                        ImGui::TableSetupColumn("Count", 0, 1);
+                        ImGui::TableSetupColumn("Time (ms)", 0, 1);
+
+                        ImGui::TableHeadersRow();
+
+                        for (uint32_t opcode = 0; opcode < 256; opcode++) {
+                            if (frame.cmd_cnt[opcode] == 0) continue;
+
+                            ImGui::TableNextColumn();
+                            ImGui::Text("0x%02X", opcode);
+
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%u", frame.cmd_cnt[opcode]);
+
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.3f", frame.cmd_time_ns[opcode] / 1e6);
+                        }
+
+                        ImGui::EndTable();
+                    }
+
+                    ImGui::TreePop();
+                }
+
+                ImGui::TreePop();
+            }
 
         ImGui::End();
     }
@@ -627,10 +827,10 @@ namespace ps1 {
         ImGui::End();
     }
 
-    void display_vram_view(vram_t* vram) {
+    void display_vram_view(emulation_snapshot_t* snapshot) {
         ImGui::Begin("VRAM");
 
-            ImGui::Image((ImTextureID) (intptr_t) vram->tbo, ImVec2(1024, 512));
+            ImGui::Image((ImTextureID) (intptr_t) snapshot->frame_tbo, ImVec2(1024, 512));
         
         ImGui::End();
     }
@@ -668,16 +868,16 @@ namespace {
     }
 }
 
-void ps1::debugger::display(ps1_t* console, emulation_settings_t* settings) {
+void ps1::debugger::display(emulation_t* emulation, emulation_snapshot_t* snapshot) {
     display_nav_bar();
 
-    if (show_emulation_view) display_emulation_view(console, settings);
-    if (show_cpu_view) display_cpu_view(&console->cpu, &console->bus);
-    if (show_gpu_view) display_gpu_view(&console->gpu);
-    if (show_dma_view) display_dma_view(&console->dma);
-    if (show_vram_view) display_vram_view(&console->vram);
-    if (show_instr_view) display_instr_view(&console->cpu, &console->bus);
-    if (show_memory_view) display_memory_view(&console->bus);
-    if (show_breakpoints_view) display_breakpoints_view(&console->cpu);
+    if (show_emulation_view) display_emulation_view(emulation, snapshot);
+    if (show_cpu_view) display_cpu_view(emulation, snapshot);
+    if (show_gpu_view) display_gpu_view(&snapshot->gpu);
+    if (show_dma_view) display_dma_view(&snapshot->dma);
+    if (show_vram_view) display_vram_view(snapshot);
+    if (show_instr_view) display_instr_view(emulation, snapshot);
+    if (show_memory_view) display_memory_view(emulation, snapshot);
+    if (show_breakpoints_view) display_breakpoints_view(emulation, snapshot);
     if (show_log_view) logger::display();
 }
@@ -3,5 +3,5 @@
 #include "defs.h"
 
 namespace ps1::debugger {
-    void display(ps1_t*, emulation_settings_t*);
+    void display(emulation_t*, emulation_snapshot_t*);
 }
\ No newline at end of file
@@ -7,9 +7,12 @@
 #include <unordered_map>
 #include <functional>
 #include <set>
-// #include <cstdio>
+#include <cstdio>
+#include <cstring>
 
-#if defined(PS1_WINDOWS)
+#if defined(PS1_HEADLESS)
+// * no window, gl context or imgui
+#elif defined(PS1_WINDOWS)
 #include <glew/glew.h>
 #include <glfw/glfw3.h>
 #include <imgui/imgui.h>
@@ -48,6 +51,11 @@
     #define DEBUG_CODE(code) do { } while (false)
 #endif
 
+// * emulator build, git describe of source tree set by cmake
+#if !defined(PS1_VERSION)
+    #define PS1_VERSION "unknown"
+#endif
+
 
 typedef std::string str_t;
 
@@ -114,6 +122,7 @@ namespace ps1 {
     constexpr uint32_t BIOS_KSEG1 = 0xBFC00000;
     constexpr uint32_t BIOS_SIZE = 512 * 1024;
     constexpr uint32_t BIOS_ENTRY = 0xBFC00000;
+    constexpr uint32_t SHELL_ENTRY = 0x80030000; // * bios jumps here once kernel is set up, executables are loaded from here on
 
     // constexpr uint32_t ICPUCR_ADDR = 0xFFFE0000;
     constexpr uint32_t ICPUCR_KSEG2 = 0xFFFE0000;
@@ -135,7 +144,19 @@ namespace ps1 {
     struct dma_t;
     struct gpu_t;
     struct vram_t;
+    struct serializer_t;
+    struct hle_t;
+    struct irq_t;
+    struct scheduler_t;
+    struct cdrom_t;
+    struct disc_t;
+    struct mdec_t;
+    struct pool_t;
+    struct spu_t;
+    struct audio_ring_t;
 
     struct ps1_t;
     struct emulation_settings_t;
+    struct emulation_snapshot_t;
+    struct emulation_t;
 }
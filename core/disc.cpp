@@ -0,0 +1,673 @@
+#include "disc.h"
+#include "compress.h"
+#include "logger.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <future>
+
+namespace {
+    constexpr uint32_t page_size = 4096;
+
+    constexpr uint32_t cdz_magic = 'P' | ('S' << 8) | ('1' << 16) | ('D' << 24);
+    constexpr uint32_t cdz_version = 1;
+    constexpr uint32_t cdz_footer_size = 16;
+    constexpr uint32_t cdz_track_size = 24;
+    constexpr uint32_t cdz_index_entry_size = 20;
+
+    constexpr uint32_t hunk_flag_lz = 0x1;
+
+    constexpr uint32_t compress_batch_size = 64; // * hunks compressed in parallel at once
+
+    bool has_extension(const str_t& path, const char* extension) {
+        str_t actual = std::filesystem::path(path).extension().string();
+
+        for (char& c : actual) c = (char)tolower(c);
+
+        return actual == extension;
+    }
+
+    bool parse_msf(const str_t& text, uint32_t* sector) {
+        uint32_t m, s, f;
+
+        if (sscanf(text.c_str(), "%u:%u:%u", &m, &s, &f) != 3) return false;
+
+        *sector = ps1::disc_msf_to_sector(m, s, f);
+
+        return true;
+    }
+
+    bool map_file(ps1::disc_t* disc, const str_t& path) {
+        ps1::serializer_t serializer;
+
+        if (!ps1::serializer_open_mmap(&serializer, path, ps1::serializer_mode_t::read)) {
+            ps1::logger::push("failed to map " + path, ps1::logger::type_t::error, "disc");
+
+            ps1::serializer_close(&serializer);
+
+            return false;
+        }
+
+        disc->files.push_back(serializer);
+
+        return true;
+    }
+
+    uint32_t file_sector_cnt(ps1::disc_t* disc, uint32_t file) {
+        return (uint32_t)(disc->files[file].mapped_size / ps1::DISC_SECTOR_SIZE);
+    }
+
+    /*
+    * only what single and multi bin dumps use: FILE, TRACK, PREGAP and INDEX 01
+    * absolute sectors of a file follow previous file, pregap is not stored in file
+    */
+    bool parse_cue(ps1::disc_t* disc, const str_t& path) {
+        std::ifstream stream(path);
+
+        if (!stream) {
+            ps1::logger::push("failed to open " + path, ps1::logger::type_t::error, "disc");
+
+            return false;
+        }
+
+        std::filesystem::path dir = std::filesystem::path(path).parent_path();
+
+        uint32_t file_start = ps1::DISC_PREGAP; // * absolute sector of first byte of current file
+        uint32_t next_file_start = file_start;
+
+        str_t line;
+
+        while (std::getline(stream, line)) {
+            std::istringstream words(line);
+            str_t command;
+            words >> command;
+
+            if (command == "FILE") {
+                size_t open = line.find('"');
+                size_t close = line.rfind('"');
+
+                if (open == str_t::npos || close == open) {
+                    ps1::logger::push("malformed FILE in " + path, ps1::logger::type_t::error, "disc");
+
+                    return false;
+                }
+
+                if (!map_file(disc, (dir / line.substr(open + 1, close - open - 1)).string())) return false;
+
+                file_start = next_file_start;
+                next_file_start = file_start + file_sector_cnt(disc, (uint32_t)disc->files.size() - 1);
+            } else if (command == "TRACK") {
+                uint32_t number;
+                str_t type;
+                words >> number >> type;
+
+                if (disc->files.empty()) return false;
+
+                ps1::disc_track_t track {};
+                track.number = number;
+                track.audio = type == "AUDIO";
+                track.file = (uint32_t)disc->files.size() - 1;
+
+                disc->tracks.push_back(track);
+            } else if (command == "PREGAP") {
+                str_t msf;
+                words >> msf;
+
+                uint32_t length;
+                if (!parse_msf(msf, &length)) return false;
+
+                file_start += length;
+                next_file_start += length;
+            } else if (command == "INDEX") {
+                uint32_t index;
+                str_t msf;
+                words >> index >> msf;
+
+                uint32_t offset;
+                if (!parse_msf(msf, &offset) || disc->tracks.empty()) return false;
+
+                if (index != 1) continue;
+
+                ps1::disc_track_t& track = disc->tracks.back();
+                track.start = file_start + offset;
+                track.file_offset = (size_t)offset * ps1::DISC_SECTOR_SIZE;
+            }
+        }
+
+        disc->lead_out = next_file_start;
+
+        // * track runs until next one in same file or until end of its file
+        for (size_t i = 0; i < disc->tracks.size(); i++) {
+            ps1::disc_track_t& track = disc->tracks[i];
+
+            bool next_in_file = i + 1 < disc->tracks.size() && disc->tracks[i + 1].file == track.file;
+            size_t end = next_in_file ? disc->tracks[i + 1].file_offset : disc->files[track.file].mapped_size;
+
+            track.sector_cnt = (uint32_t)((end - std::min(end, track.file_offset)) / ps1::DISC_SECTOR_SIZE);
+        }
+
+        return !disc->tracks.empty();
+    }
+
+    uint32_t read32(const uint8_t* ptr) {
+        uint32_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    uint64_t read64(const uint8_t* ptr) {
+        return read32(ptr) | ((uint64_t)read32(ptr + 4) << 32);
+    }
+
+    /*
+    * footer points at hunk index, header holds track table
+    * every offset is checked against file size so hunks can be read straight from mapping later on
+    */
+    bool parse_cdz(ps1::disc_t* disc, const str_t& path) {
+        if (!map_file(disc, path)) return false;
+
+        const uint8_t* data = disc->files[0].mapped;
+        size_t size = disc->files[0].mapped_size;
+
+        if (size < 16 + cdz_footer_size || read32(data) != cdz_magic || read32(data + size - 4) != cdz_magic) {
+            ps1::logger::push(path + " is not a compressed disc image", ps1::logger::type_t::error, "disc");
+
+            return false;
+        }
+
+        if (read32(data + 4) != cdz_version) {
+            ps1::logger::push(path + " has unsupported version " + std::to_string(read32(data + 4)), ps1::logger::type_t::error, "disc");
+
+            return false;
+        }
+
+        disc->hunk_size = read32(data + 8);
+        uint32_t track_cnt = read32(data + 12);
+
+        uint64_t index_offset = read64(data + size - cdz_footer_size);
+        uint32_t hunk_cnt = read32(data + size - 8);
+
+        bool valid = disc->hunk_size != 0 && disc->hunk_size % ps1::DISC_SECTOR_SIZE == 0;
+        valid = valid && 16 + (uint64_t)track_cnt * cdz_track_size <= index_offset;
+        valid = valid && index_offset + (uint64_t)hunk_cnt * cdz_index_entry_size + cdz_footer_size == size;
+
+        if (!valid) {
+            ps1::logger::push(path + " is truncated", ps1::logger::type_t::error, "disc");
+
+            return false;
+        }
+
+        for (uint32_t i = 0; i < track_cnt; i++) {
+            const uint8_t* entry = data + 16 + i * cdz_track_size;
+
+            ps1::disc_track_t track {};
+            track.number = read32(entry);
+            track.audio = read32(entry + 4);
+            track.start = read32(entry + 8);
+            track.sector_cnt = read32(entry + 12);
+            track.file_offset = read64(entry + 16);
+
+            valid = valid && (track.file_offset + (uint64_t)track.sector_cnt * ps1::DISC_SECTOR_SIZE) <= (uint64_t)hunk_cnt * disc->hunk_size;
+
+            disc->tracks.push_back(track);
+            disc->lead_out = std::max(disc->lead_out, track.start + track.sector_cnt);
+        }
+
+        for (uint32_t i = 0; i < hunk_cnt; i++) {
+            const uint8_t* entry = data + index_offset + i * cdz_index_entry_size;
+
+            ps1::disc_hunk_t hunk;
+            hunk.offset = read64(entry);
+            hunk.stored_size = read32(entry + 8);
+            hunk.flags = read32(entry + 12);
+            hunk.checksum = read32(entry + 16);
+
+            valid = valid && hunk.offset + hunk.stored_size <= index_offset;
+            valid = valid && ((hunk.flags & hunk_flag_lz) || hunk.stored_size == disc->hunk_size);
+
+            disc->hunks.push_back(hunk);
+        }
+
+        if (!valid) {
+            ps1::logger::push(path + " has corrupt index", ps1::logger::type_t::error, "disc");
+
+            return false;
+        }
+
+        disc->compressed = true;
+
+        return !disc->tracks.empty();
+    }
+
+    // * hunk and byte offset in it of absolute sector, false outside of tracks
+    bool locate_sector(ps1::disc_t* disc, uint32_t sector, uint32_t* hunk, uint32_t* offset) {
+        const ps1::disc_track_t* track = ps1::disc_find_track(disc, sector);
+
+        if (!track) return false;
+
+        uint64_t stream_offset = track->file_offset + (uint64_t)(sector - track->start) * ps1::DISC_SECTOR_SIZE;
+
+        *hunk = (uint32_t)(stream_offset / disc->hunk_size);
+        *offset = (uint32_t)(stream_offset % disc->hunk_size);
+
+        return true;
+    }
+
+    bool decompress_hunk(ps1::disc_t* disc, uint32_t hunk, uint8_t* out) {
+        const ps1::disc_hunk_t& info = disc->hunks[hunk];
+        const uint8_t* stored = disc->files[0].mapped + info.offset;
+
+        if (info.flags & hunk_flag_lz) {
+            if (!ps1::lz_decompress(stored, info.stored_size, out, disc->hunk_size)) return false;
+        } else {
+            memcpy(out, stored, disc->hunk_size);
+        }
+
+        return ps1::adler32(out, disc->hunk_size) == info.checksum;
+    }
+
+    ps1::disc_cache_slot_t* find_slot(ps1::disc_t* disc, uint32_t hunk) {
+        for (auto& slot : disc->cache) {
+            if (slot.hunk == hunk) return &slot;
+        }
+
+        return nullptr;
+    }
+
+    // * empty slot first, then least recently used one that is neither pinned nor being decompressed
+    ps1::disc_cache_slot_t* pick_victim(ps1::disc_t* disc) {
+        ps1::disc_cache_slot_t* victim = nullptr;
+
+        for (auto& slot : disc->cache) {
+            if (slot.hunk == ps1::DISC_NO_HUNK) return &slot;
+            if (!slot.ready || slot.hunk == disc->pinned[0] || slot.hunk == disc->pinned[1]) continue;
+
+            if (!victim || slot.last_use < victim->last_use) victim = &slot;
+        }
+
+        return victim;
+    }
+
+    /*
+    * ready slot holding hunk, null if hunk is corrupt
+    * waits if other thread is decompressing it, otherwise decompresses it into victim slot with lock released
+    */
+    ps1::disc_cache_slot_t* acquire_hunk(ps1::disc_t* disc, std::unique_lock<std::mutex>& lock, uint32_t hunk) {
+        ps1::disc_cache_slot_t* slot;
+
+        while ((slot = find_slot(disc, hunk)) && !slot->ready) {
+            disc->decoded_cv.wait(lock);
+        }
+
+        if (slot) return slot;
+
+        slot = pick_victim(disc);
+
+        ASSERT(slot, "no evictable disc cache slot");
+
+        slot->hunk = hunk;
+        slot->ready = false;
+
+        lock.unlock();
+
+        slot->data.resize(disc->hunk_size);
+        bool decompressed = decompress_hunk(disc, hunk, slot->data.data());
+
+        lock.lock();
+
+        if (decompressed) {
+            slot->ready = true;
+            slot->last_use = ++disc->cache_clock;
+        } else {
+            slot->hunk = ps1::DISC_NO_HUNK;
+
+            ps1::logger::push("corrupt hunk " + std::to_string(hunk), ps1::logger::type_t::error, "disc");
+        }
+
+        disc->decoded_cv.notify_all();
+
+        return decompressed ? slot : nullptr;
+    }
+
+    // * one read per page is enough to fault it in
+    void touch_sectors(ps1::disc_t* disc, uint32_t start, uint32_t cnt) {
+        for (uint32_t i = 0; i < cnt; i++) {
+            const volatile uint8_t* sector = ps1::disc_read_sector(disc, start + i);
+
+            if (!sector) break;
+
+            for (uint32_t offset = 0; offset < ps1::DISC_SECTOR_SIZE; offset += page_size) {
+                (void)sector[offset];
+            }
+        }
+    }
+
+    // * stops early once newer request comes in
+    void decompress_sectors(ps1::disc_t* disc, uint32_t start, uint32_t cnt) {
+        uint32_t last_hunk = ps1::DISC_NO_HUNK;
+
+        for (uint32_t i = 0; i < cnt; i++) {
+            uint32_t hunk, offset;
+
+            if (!locate_sector(disc, start + i, &hunk, &offset)) break;
+            if (hunk == last_hunk) continue;
+
+            last_hunk = hunk;
+
+            std::unique_lock lock(disc->mutex);
+
+            if (disc->quit || disc->prefetch_pending) return;
+            if (find_slot(disc, hunk)) continue;
+
+            acquire_hunk(disc, lock, hunk);
+        }
+    }
+
+    void prefetch_loop(ps1::disc_t* disc) {
+        while (true) {
+            uint32_t start, cnt;
+
+            {
+                std::unique_lock lock(disc->mutex);
+                disc->cv.wait(lock, [disc] { return disc->prefetch_pending || disc->quit; });
+
+                if (disc->quit) return;
+
+                start = disc->prefetch_start;
+                cnt = disc->prefetch_cnt;
+                disc->prefetch_pending = false;
+            }
+
+            if (disc->compressed) {
+                decompress_sectors(disc, start, cnt);
+            } else {
+                touch_sectors(disc, start, cnt);
+            }
+        }
+    }
+
+    struct compress_job_t {
+        dyn_arr_t<uint8_t> raw;
+        dyn_arr_t<uint8_t> encoded;
+        uint32_t flags;
+        uint32_t checksum;
+    };
+
+    // * incompressible hunks are stored as is
+    void compress_hunk(compress_job_t* job) {
+        job->checksum = ps1::adler32(job->raw.data(), job->raw.size());
+
+        job->encoded.clear();
+        ps1::lz_compress(job->raw.data(), job->raw.size(), &job->encoded);
+
+        job->flags = job->encoded.size() < job->raw.size() ? hunk_flag_lz : 0;
+    }
+}
+
+bool ps1::disc_open(disc_t* disc, const str_t& path) {
+    disc_close(disc);
+
+    bool opened;
+
+    if (has_extension(path, ".cue")) {
+        opened = parse_cue(disc, path);
+    } else if (has_extension(path, ".cdz")) {
+        opened = parse_cdz(disc, path);
+    } else {
+        // * whole file is one data track
+        opened = map_file(disc, path);
+
+        if (opened) {
+            disc_track_t track {};
+            track.number = 1;
+            track.start = DISC_PREGAP;
+            track.sector_cnt = file_sector_cnt(disc, 0);
+
+            disc->tracks.push_back(track);
+            disc->lead_out = track.start + track.sector_cnt;
+        }
+    }
+
+    if (!opened) {
+        logger::push("failed to open disc " + path, logger::type_t::error, "disc");
+
+        disc_close(disc);
+
+        return false;
+    }
+
+    for (auto& slot : disc->cache) {
+        slot.hunk = DISC_NO_HUNK;
+        slot.ready = false;
+    }
+
+    disc->cache_clock = 0;
+    disc->pinned[0] = DISC_NO_HUNK;
+    disc->pinned[1] = DISC_NO_HUNK;
+    disc->hit_cnt = 0;
+    disc->miss_cnt = 0;
+
+    disc->prefetch_pending = false;
+    disc->quit = false;
+    disc->worker = std::thread(prefetch_loop, disc);
+
+    logger::push("inserted " + path + ", " + std::to_string(disc->tracks.size()) + " tracks", logger::type_t::info, "disc");
+
+    return true;
+}
+
+void ps1::disc_close(disc_t* disc) {
+    if (disc->worker.joinable()) {
+        {
+            std::lock_guard lock(disc->mutex);
+            disc->quit = true;
+        }
+
+        disc->cv.notify_one();
+        disc->worker.join();
+    }
+
+    for (auto& file : disc->files) {
+        serializer_close(&file);
+    }
+
+    disc->files.clear();
+    disc->tracks.clear();
+    disc->lead_out = 0;
+
+    disc->compressed = false;
+    disc->hunks.clear();
+
+    for (auto& slot : disc->cache) {
+        slot.hunk = DISC_NO_HUNK;
+        slot.data = {};
+    }
+}
+
+bool ps1::disc_is_open(disc_t* disc) {
+    return !disc->tracks.empty();
+}
+
+bool ps1::disc_compress(const str_t& in_path, const str_t& out_path) {
+    disc_t source;
+
+    if (!disc_open(&source, in_path)) return false;
+
+    serializer_t serializer;
+
+    if (!serializer_open_file(&serializer, out_path, serializer_mode_t::write)) {
+        logger::push("failed to open " + out_path + " for writing", logger::type_t::error, "disc");
+
+        serializer_close(&serializer);
+        disc_close(&source);
+
+        return false;
+    }
+
+    // * tracks follow each other in uncompressed stream, last hunk is padded with zeros
+    uint64_t stream_size = 0;
+
+    serializer_write32(&serializer, cdz_magic);
+    serializer_write32(&serializer, cdz_version);
+    serializer_write32(&serializer, DISC_HUNK_SIZE);
+    serializer_write32(&serializer, (uint32_t)source.tracks.size());
+
+    for (auto& track : source.tracks) {
+        serializer_write32(&serializer, track.number);
+        serializer_write32(&serializer, track.audio);
+        serializer_write32(&serializer, track.start);
+        serializer_write32(&serializer, track.sector_cnt);
+        serializer_write(&serializer, &stream_size, sizeof(stream_size));
+
+        stream_size += (uint64_t)track.sector_cnt * DISC_SECTOR_SIZE;
+    }
+
+    dyn_arr_t<disc_hunk_t> hunks;
+
+    size_t track = 0;
+    uint32_t track_sector = 0;
+
+    // * sectors are gathered on this thread, only compression runs in parallel
+    while (track < source.tracks.size()) {
+        compress_job_t jobs[compress_batch_size];
+        std::future<void> tasks[compress_batch_size];
+        uint32_t job_cnt = 0;
+
+        for (; job_cnt < compress_batch_size && track < source.tracks.size(); job_cnt++) {
+            dyn_arr_t<uint8_t>& raw = jobs[job_cnt].raw;
+            raw.resize(DISC_HUNK_SIZE, 0);
+
+            uint32_t offset = 0;
+
+            while (offset < DISC_HUNK_SIZE && track < source.tracks.size()) {
+                const disc_track_t& current = source.tracks[track];
+
+                if (track_sector < current.sector_cnt) {
+                    const uint8_t* sector = disc_read_sector(&source, current.start + track_sector);
+
+                    if (sector) memcpy(raw.data() + offset, sector, DISC_SECTOR_SIZE);
+
+                    offset += DISC_SECTOR_SIZE;
+                    track_sector++;
+                }
+
+                if (track_sector >= current.sector_cnt) {
+                    track++;
+                    track_sector = 0;
+                }
+            }
+
+            tasks[job_cnt] = std::async(std::launch::async, compress_hunk, &jobs[job_cnt]);
+        }
+
+        for (uint32_t i = 0; i < job_cnt; i++) {
+            tasks[i].wait();
+
+            const dyn_arr_t<uint8_t>& data = jobs[i].flags & hunk_flag_lz ? jobs[i].encoded : jobs[i].raw;
+
+            disc_hunk_t hunk;
+            hunk.offset = serializer.offset;
+            hunk.stored_size = (uint32_t)data.size();
+            hunk.flags = jobs[i].flags;
+            hunk.checksum = jobs[i].checksum;
+
+            hunks.push_back(hunk);
+
+            serializer_write(&serializer, data.data(), data.size());
+        }
+    }
+
+    uint64_t index_offset = serializer.offset;
+
+    for (auto& hunk : hunks) {
+        serializer_write(&serializer, &hunk.offset, sizeof(hunk.offset));
+        serializer_write32(&serializer, hunk.stored_size);
+        serializer_write32(&serializer, hunk.flags);
+        serializer_write32(&serializer, hunk.checksum);
+    }
+
+    serializer_write(&serializer, &index_offset, sizeof(index_offset));
+    serializer_write32(&serializer, (uint32_t)hunks.size());
+    serializer_write32(&serializer, cdz_magic);
+
+    bool written = serializer_close(&serializer);
+
+    disc_close(&source);
+
+    if (!written) {
+        logger::push("failed to write " + out_path, logger::type_t::error, "disc");
+
+        return false;
+    }
+
+    logger::push("compressed " + in_path + " into " + std::to_string(hunks.size()) + " hunks, " + std::to_string(index_offset) + " of " + std::to_string(stream_size) + " bytes", logger::type_t::info, "disc");
+
+    return true;
+}
+
+const ps1::disc_track_t* ps1::disc_find_track(disc_t* disc, uint32_t sector) {
+    for (auto& track : disc->tracks) {
+        if (sector >= track.start && sector - track.start < track.sector_cnt) return &track;
+    }
+
+    return nullptr;
+}
+
+const uint8_t* ps1::disc_read_sector(disc_t* disc, uint32_t sector) {
+    if (disc->compressed) {
+        uint32_t hunk, offset;
+
+        if (!locate_sector(disc, sector, &hunk, &offset)) return nullptr;
+
+        std::unique_lock lock(disc->mutex);
+
+        if (find_slot(disc, hunk)) {
+            disc->hit_cnt++;
+        } else {
+            disc->miss_cnt++;
+        }
+
+        disc_cache_slot_t* slot = acquire_hunk(disc, lock, hunk);
+
+        if (!slot) return nullptr;
+
+        slot->last_use = ++disc->cache_clock;
+
+        if (disc->pinned[0] != hunk) {
+            disc->pinned[1] = disc->pinned[0];
+            disc->pinned[0] = hunk;
+        }
+
+        return slot->data.data() + offset;
+    }
+
+    const disc_track_t* track = disc_find_track(disc, sector);
+
+    if (!track) return nullptr;
+
+    return disc->files[track->file].mapped + track->file_offset + (size_t)(sector - track->start) * DISC_SECTOR_SIZE;
+}
+
+void ps1::disc_prefetch(disc_t* disc, uint32_t sector, uint32_t cnt) {
+    if (!disc->worker.joinable()) return;
+
+    {
+        std::lock_guard lock(disc->mutex);
+        disc->prefetch_start = sector;
+        disc->prefetch_cnt = cnt;
+        disc->prefetch_pending = true;
+    }
+
+    disc->cv.notify_one();
+}
+
+uint32_t ps1::disc_msf_to_sector(uint32_t m, uint32_t s, uint32_t f) {
+    return (m * 60 + s) * 75 + f;
+}
+
+void ps1::disc_sector_to_msf(uint32_t sector, uint8_t* m, uint8_t* s, uint8_t* f) {
+    *m = (uint8_t)(sector / (60 * 75));
+    *s = (uint8_t)(sector / 75 % 60);
+    *f = (uint8_t)(sector % 75);
+}
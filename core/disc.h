@@ -0,0 +1,110 @@
+#pragma once
+
+#include "defs.h"
+#include "serializer.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace ps1 {
+    constexpr uint32_t DISC_SECTOR_SIZE = 2352; // * raw sector with sync, header and error correction
+    constexpr uint32_t DISC_PREGAP = 150; // * 2 seconds before first track, sector numbers count from 00:00:00
+
+    constexpr uint32_t DISC_HUNK_SECTORS = 8; // * sectors per compressed block
+    constexpr uint32_t DISC_HUNK_SIZE = DISC_HUNK_SECTORS * DISC_SECTOR_SIZE;
+    constexpr uint32_t DISC_CACHE_HUNK_CNT = 32; // * decompressed blocks kept around, 256 sectors
+
+    struct disc_track_t {
+        uint32_t number;
+        bool audio;
+
+        uint32_t start; // * absolute sector of index 01
+        uint32_t sector_cnt;
+
+        uint32_t file; // * index into mapped files
+        size_t file_offset; // * byte offset of start in file, or in uncompressed stream of compressed image
+    };
+
+    struct disc_hunk_t {
+        uint64_t offset; // * in mapped file
+        uint32_t stored_size;
+        uint32_t flags;
+        uint32_t checksum; // * adler32 of decompressed hunk
+    };
+
+    constexpr uint32_t DISC_NO_HUNK = UINT32_MAX;
+
+    // * decompressed hunk, hunk is DISC_NO_HUNK while slot is empty
+    struct disc_cache_slot_t {
+        uint32_t hunk;
+        uint64_t last_use;
+        bool ready; // * false while being decompressed
+        dyn_arr_t<uint8_t> data;
+    };
+
+    /*
+    * disc image
+    * bin files of cue sheet, or single raw bin, are mapped into memory for whole time disc is inserted
+    * sectors are handed out as pointers into mapping, page faults are taken by prefetch worker ahead of reads
+    *
+    * compressed images (.cdz) are mapped the same way but sectors come from lru cache of decompressed hunks.
+    * worker decompresses hunks ahead of drive, reads only decompress on their own after a seek.
+    * two most recently handed out hunks are never evicted, so pointer in cdrom data fifo stays valid
+    *
+    * .cdz layout, all fields 32 bit little endian
+    * [magic] [version] [hunk size] [track count] then per track [number] [audio] [start] [sector count] [stream offset lo] [stream offset hi]
+    * [hunk data]
+    * [hunk index] per hunk [offset lo] [offset hi] [stored size] [flags] [adler32]
+    * [index offset lo] [index offset hi] [hunk count] [magic]
+    */
+    struct disc_t {
+        dyn_arr_t<serializer_t> files;
+        dyn_arr_t<disc_track_t> tracks;
+
+        uint32_t lead_out = 0; // * first absolute sector past last track
+
+        bool compressed = false;
+        uint32_t hunk_size;
+        dyn_arr_t<disc_hunk_t> hunks;
+
+        // * guarded by mutex
+        disc_cache_slot_t cache[DISC_CACHE_HUNK_CNT];
+        uint64_t cache_clock;
+        uint32_t pinned[2]; // * hunks of last two reads
+        uint64_t hit_cnt;
+        uint64_t miss_cnt; // * reads that had to decompress on emulation thread
+
+        // * prefetch worker touches pages or decompresses hunks of requested range, newer request replaces older one
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::condition_variable decoded_cv; // * signalled whenever a hunk finishes decompressing
+        uint32_t prefetch_start;
+        uint32_t prefetch_cnt;
+        bool prefetch_pending;
+        bool quit;
+    };
+
+    // * .cue sheet, .cdz compressed image or raw mode 2 .bin. errors are logged
+    bool disc_open(disc_t*, const str_t&);
+    void disc_close(disc_t*);
+
+    bool disc_is_open(disc_t*);
+
+    // * writes any image disc_open accepts as .cdz. hunks are compressed in parallel
+    bool disc_compress(const str_t&, const str_t&);
+
+    // * raw sector at absolute sector number, null outside of tracks or if hunk is corrupt. compressed sectors stay valid for two more reads
+    const uint8_t* disc_read_sector(disc_t*, uint32_t);
+
+    // * track containing absolute sector, null outside of tracks
+    const disc_track_t* disc_find_track(disc_t*, uint32_t);
+
+    // * fault in or decompress given number of sectors in background
+    void disc_prefetch(disc_t*, uint32_t, uint32_t);
+
+    // * minutes, seconds, frames
+    uint32_t disc_msf_to_sector(uint32_t, uint32_t, uint32_t);
+    void disc_sector_to_msf(uint32_t, uint8_t*, uint8_t*, uint8_t*);
+}
@@ -1,11 +1,19 @@
 #include "dma.h"
+#include "irq.h"
 #include "ram.h"
 #include "gpu.h"
-#include "file.h"
+#include "cdrom.h"
+#include "mdec.h"
+#include "spu.h"
+#include "serializer.h"
 
-void ps1::dma_init(dma_t* dma, ram_t* ram, gpu_t* gpu) {
+void ps1::dma_init(dma_t* dma, irq_t* irq, ram_t* ram, gpu_t* gpu, cdrom_t* cdrom, mdec_t* mdec, spu_t* spu) {
+    dma->irq = irq;
     dma->ram = ram;
     dma->gpu = gpu;
+    dma->cdrom = cdrom;
+    dma->mdec = mdec;
+    dma->spu = spu;
 
     for (auto& channel : dma->channels) {
         channel.base = 0;
@@ -19,26 +27,19 @@ void ps1::dma_init(dma_t* dma, ram_t* ram, gpu_t* gpu) {
 
 void ps1::dma_exit(dma_t* dma) {}
 
-void ps1::dma_save_state(dma_t* dma) {
-    for (auto& channel : dma->channels) {
-        file::write32(channel.base);
-        file::write32(channel.block);
-        file::write32(channel.control.raw);
-    }
+void ps1::dma_save_state(dma_t* dma, serializer_t* serializer) {
+    // * channels are plain base, block, control triplets
+    serializer_write(serializer, dma->channels, sizeof(dma->channels));
 
-    file::write32(dma->control);
-    file::write32(dma->interrupt.get_raw());
+    serializer_write32(serializer, dma->control);
+    serializer_write32(serializer, dma->interrupt.get_raw());
 }
 
-void ps1::dma_load_state(dma_t* dma) {
-    for (auto& channel : dma->channels) {
-        channel.base = file::read32();
-        channel.block = file::read32();
-        channel.control.raw = file::read32();
-    }
+void ps1::dma_load_state(dma_t* dma, serializer_t* serializer) {
+    serializer_read(serializer, dma->channels, sizeof(dma->channels));
 
-    dma->control = file::read32();
-    dma->interrupt.set_raw(file::read32());
+    dma->control = serializer_read32(serializer);
+    dma->interrupt.set_raw(serializer_read32(serializer));
 }
 
 namespace {
@@ -58,6 +59,17 @@ void ps1::dma_process_block_copy(dma_t* dma, uint32_t port) {
     */
     mem_addr_t addr = channel.base & ignore_2_lsb_mask;
 
+    // * decoded pixels are copied in one go. channel stays armed until decoder has output, decoder then finishes it
+    if (port == (uint32_t)dma_t::port_t::mdecout) {
+        ASSERT(step > 0, "mdec output only supported with increasing address");
+
+        if (mdec_dma_read(dma->mdec, addr, size)) {
+            dma_complete(dma, port);
+        }
+
+        return;
+    }
+
     if (channel.control.direction == dma_t::channel_t::control_t::transfer_dir_t::device_to_ram) {
         while (size > 0) {
             switch(port) {
@@ -69,6 +81,18 @@ void ps1::dma_process_block_copy(dma_t* dma, uint32_t port) {
                     break;
                 }
 
+                case (uint32_t)dma_t::port_t::cdrom: {
+                    store<ram_t, uint32_t>((void*)dma->ram, addr, cdrom_dma_read(dma->cdrom));
+
+                    break;
+                }
+
+                case (uint32_t)dma_t::port_t::spu: {
+                    store<ram_t, uint32_t>((void*)dma->ram, addr, spu_dma_read(dma->spu));
+
+                    break;
+                }
+
                 default: {
                     ASSERT(false, "unimplemented port. should not happen");
                 }
@@ -86,6 +110,18 @@ void ps1::dma_process_block_copy(dma_t* dma, uint32_t port) {
                     break;
                 }
 
+                case (uint32_t)dma_t::port_t::mdecin: {
+                    mdec_write(dma->mdec, fetch<ram_t, uint32_t>((void*)dma->ram, addr));
+
+                    break;
+                }
+
+                case (uint32_t)dma_t::port_t::spu: {
+                    spu_dma_write(dma->spu, fetch<ram_t, uint32_t>((void*)dma->ram, addr));
+
+                    break;
+                }
+
                 default: {
                     ASSERT(false, "unimplemented port. should not happen");
                 }
@@ -96,7 +132,7 @@ void ps1::dma_process_block_copy(dma_t* dma, uint32_t port) {
         }
     }
 
-    channel.control.disable();
+    dma_complete(dma, port);
 }
 
 void ps1::dma_process_linked_list(dma_t* dma, uint32_t port) {
@@ -129,7 +165,7 @@ void ps1::dma_process_linked_list(dma_t* dma, uint32_t port) {
         }
     }
 
-    channel.control.disable();
+    dma_complete(dma, port);
 }
 
 void ps1::dma_process(dma_t* dma, uint32_t port)  {
@@ -138,4 +174,12 @@ void ps1::dma_process(dma_t* dma, uint32_t port)  {
     } else {
         dma_process_block_copy(dma, port);
     }
+}
+
+void ps1::dma_complete(dma_t* dma, uint32_t port) {
+    dma->channels[port].control.disable();
+
+    if (dma->interrupt.complete(port)) {
+        irq_request(dma->irq, irq_line_t::dma);
+    }
 }
\ No newline at end of file
@@ -6,8 +6,12 @@
 
 namespace ps1 {
     struct dma_t {
+        irq_t* irq;
         ram_t* ram;
         gpu_t* gpu;
+        cdrom_t* cdrom;
+        mdec_t* mdec;
+        spu_t* spu;
 
         struct channel_t { // ! members not to be rearranged
             union control_t {
@@ -80,13 +84,29 @@ namespace ps1 {
             }
             
             // * IF b15=1 OR (b23=1 AND (b16-22 AND b24-30)>0) THEN b31=1 ELSE b31=0
-            // ! needs testing (its either == 0x7f or > 0)
+            bool update_master() {
+                irq_flag_master = irq_force || (irq_master_enable && (irq_enable & irq_flag) != 0);
+
+                return irq_flag_master;
+            }
+
             uint32_t get() {
-                irq_flag_master = irq_force || (irq_master_enable && irq_enable == 0x7F && irq_flag == 0x7F);
+                update_master();
 
                 return raw;
             }
 
+            // * flag is only set for channels with irq enabled. true if master flag went up, which is what raises irq
+            bool complete(uint32_t port) {
+                bool was_raised = update_master();
+
+                if (irq_enable & (1u << port)) {
+                    irq_flag |= 1u << port;
+                }
+
+                return update_master() && !was_raised;
+            }
+
             void set_raw(uint32_t v) {
                 raw = v;
             }
@@ -127,11 +147,11 @@ namespace ps1 {
         interrupt_t interrupt; // * +0x74
     };
 
-    void dma_init(dma_t*, ram_t*, gpu_t*);
+    void dma_init(dma_t*, irq_t*, ram_t*, gpu_t*, cdrom_t*, mdec_t*, spu_t*);
     void dma_exit(dma_t*);
     
-    void dma_save_state(dma_t*);
-    void dma_load_state(dma_t*);
+    void dma_save_state(dma_t*, serializer_t*);
+    void dma_load_state(dma_t*, serializer_t*);
 
     /*
     * we copy all data in one go without chopping
@@ -141,6 +161,9 @@ namespace ps1 {
     void dma_process_linked_list(dma_t*, uint32_t);
     void dma_process(dma_t*, uint32_t);
 
+    // * ends transfer on channel, sets its interrupt flag and raises dma irq
+    void dma_complete(dma_t*, uint32_t);
+
     FETCH_FN(dma_t) fetch(void* device, mem_addr_t offset) {
         dma_t* dma = (dma_t*)device;
 
@@ -0,0 +1,434 @@
+#include "emulation.h"
+#include "ps1.h"
+#include "render.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+namespace {
+    constexpr float min_speed = .1f;
+
+    constexpr size_t rewind_max_bytes = 256 * 1024 * 1024;
+
+    const char* boot_cache_dir = "cache";
+
+    // * host device format, typical mixer rate and callback period
+    constexpr uint32_t host_sample_rate = 48000;
+    constexpr uint32_t host_period_frames = 512;
+    constexpr uint32_t audio_target_fill = ps1::AUDIO_SAMPLE_RATE / 20; // * 50 ms of latency
+
+    // * os sleep overshoots by up to a scheduler tick, last part of the wait is spun
+    constexpr auto spin_duration = std::chrono::microseconds(2000);
+
+    std::chrono::steady_clock::duration get_frame_duration(ps1::gpu_t* gpu, float speed) {
+        double frame_time = 1.0 / (ps1::gpu_frame_rate(gpu) * std::max(speed, min_speed));
+
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(frame_time));
+    }
+
+    bool is_fast_forward(const ps1::emulation_settings_t* settings) {
+        return settings->uncapped || settings->speed > 1.f;
+    }
+
+    // * audio runs at fixed rate, any other speed or missing device falls back to wall clock
+    bool is_audio_paced(ps1::emulation_t* emulation) {
+        const ps1::emulation_settings_t* settings = &emulation->settings;
+
+        return settings->audio_sync && !settings->uncapped && settings->speed == 1.f && ps1::audio_output_is_active(&emulation->audio_output);
+    }
+
+    // * first skip_frames of every period are dropped, last one is always presented
+    bool is_skipped(const ps1::emulation_settings_t* settings, uint32_t skip_index) {
+        if (!is_fast_forward(settings)) return false;
+
+        int32_t period = std::max(settings->skip_period, 1);
+        int32_t skipped = std::min(settings->skip_frames, period - 1);
+
+        return (int32_t)skip_index < skipped;
+    }
+
+    void wait_until(std::chrono::steady_clock::time_point deadline) {
+        if (deadline - std::chrono::steady_clock::now() > spin_duration) {
+            std::this_thread::sleep_until(deadline - spin_duration);
+        }
+
+        while (std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    void run_frame(ps1::ps1_t* console, double* frame_budget) {
+        *frame_budget += ps1::gpu_cycles_per_frame(&console->gpu);
+
+        uint64_t frame_start = console->cpu.cycle_cnt;
+
+        while (console->cpu.cycle_cnt - frame_start < *frame_budget && console->cpu.state == ps1::cpu_state_t::running) {
+            ps1::cpu_tick(&console->cpu);
+        }
+
+        *frame_budget -= console->cpu.cycle_cnt - frame_start;
+
+        ps1::gpu_end_frame(&console->gpu);
+    }
+
+    /*
+    * real frame runs and renders as usual, then state and vram are saved and frames ahead are emulated
+    * last frame ahead is rendered, after that real state and vram are restored
+    * restore swaps vram with its backup, returns true if backup now holds frame ahead to present
+    */
+    bool run_frame_ahead(ps1::emulation_t* emulation, double* frame_budget, bool skip) {
+        ps1::ps1_t* console = emulation->console;
+        int32_t run_ahead = emulation->settings.run_ahead;
+
+        ps1::gpu_set_render_enabled(&console->gpu, !skip);
+        run_frame(console, frame_budget);
+
+        if (console->cpu.state != ps1::cpu_state_t::running) return false;
+
+        ps1::ps1_save_state(console, &emulation->run_ahead_state);
+        ps1::vram_backup(&console->vram);
+
+        double ahead_budget = *frame_budget;
+
+        // * only real frame is heard, and only its kernel calls reach tty log and stats
+        ps1::spu_set_output_enabled(&console->spu, false);
+        ps1::hle_set_output_enabled(&console->hle, false);
+
+        for (int32_t i = 0; i < run_ahead; i++) {
+            ps1::gpu_set_render_enabled(&console->gpu, !skip && i == run_ahead - 1);
+            run_frame(console, &ahead_budget);
+        }
+
+        ps1::ps1_load_state(console, &emulation->run_ahead_state);
+        ps1::vram_restore(&console->vram);
+        ps1::spu_set_output_enabled(&console->spu, true);
+        ps1::hle_set_output_enabled(&console->hle, true);
+        ps1::cpu_set_state(&console->cpu, ps1::cpu_state_t::running); // * loading pauses cpu
+
+        return !skip;
+    }
+
+    // * state is copied here, delta against previous capture is built on rewind thread
+    void capture_rewind(ps1::emulation_t* emulation) {
+        int32_t interval = std::max(emulation->settings.rewind_interval, 1);
+
+        if (++emulation->rewind_index < (uint32_t)interval) return;
+
+        emulation->rewind_index = 0;
+
+        ps1::ps1_save_state(emulation->console, &emulation->rewind_state);
+        ps1::rewind_push(&emulation->rewind, &emulation->rewind_state);
+    }
+
+    void run_cmds(ps1::emulation_t* emulation) {
+        dyn_arr_t<ps1::emulation_cmd_t> cmds;
+
+        {
+            std::lock_guard<std::mutex> lock(emulation->cmd_mutex);
+            cmds.swap(emulation->cmds);
+        }
+
+        for (auto& cmd : cmds) {
+            cmd(emulation->console, &emulation->settings);
+        }
+    }
+
+    // * copy scaled vram, or its backup holding frame ahead, into snapshot frame texture, gpu side only
+    void copy_frame(ps1::emulation_t* emulation, ps1::emulation_snapshot_t* snapshot, bool ahead) {
+        ps1::vram_t* vram = &emulation->console->vram;
+
+        uint32_t width = ps1::VRAM_WIDTH * vram->resolution_scale;
+        uint32_t height = ps1::VRAM_HEIGHT * vram->resolution_scale;
+
+        // * ui might still be sampling this texture from last time it was front
+        if (snapshot->present_fence) {
+            glWaitSync(snapshot->present_fence, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(snapshot->present_fence);
+            snapshot->present_fence = nullptr;
+        }
+
+        if (snapshot->frame_fence) {
+            glDeleteSync(snapshot->frame_fence);
+            snapshot->frame_fence = nullptr;
+        }
+
+        if (!snapshot->frame_fbo) {
+            glGenFramebuffers(1, &snapshot->frame_fbo);
+            glGenTextures(1, &snapshot->frame_tbo);
+        }
+
+        if (snapshot->frame_width != width || snapshot->frame_height != height) {
+            ps1::render::bind_texture(snapshot->frame_tbo);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+            // * same sampling as vram texture itself, nearest unless upscaled vram is shown shrunk
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, width > ps1::VRAM_WIDTH ? GL_LINEAR : GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+
+            ps1::render::bind_framebuffer(snapshot->frame_fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, snapshot->frame_tbo, 0);
+
+            snapshot->frame_width = width;
+            snapshot->frame_height = height;
+        }
+
+        ps1::render::bind_read_framebuffer(ahead ? vram->backup_fbo : vram->fbo);
+        ps1::render::bind_draw_framebuffer(snapshot->frame_fbo);
+        ps1::render::set_scissor_test(false);
+
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+        snapshot->frame_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush(); // * fence must reach gpu before other context can wait on it
+    }
+
+    void del_frame(ps1::emulation_snapshot_t* snapshot) {
+        if (snapshot->present_fence) glDeleteSync(snapshot->present_fence);
+        if (snapshot->frame_fence) glDeleteSync(snapshot->frame_fence);
+
+        glDeleteFramebuffers(1, &snapshot->frame_fbo);
+        glDeleteTextures(1, &snapshot->frame_tbo);
+
+        ps1::render::invalidate_state();
+    }
+
+    void publish(ps1::emulation_t* emulation, uint32_t frame_cnt, bool ahead) {
+        ps1::ps1_t* console = emulation->console;
+
+        // * front is only ever changed by this thread
+        uint32_t back = 1 - emulation->front;
+        ps1::emulation_snapshot_t* snapshot = &emulation->snapshots[back];
+
+        snapshot->cpu = console->cpu;
+        snapshot->cpu.watch = nullptr; // * hooks belong to emulation thread
+
+        // * only reallocated when user edits breakpoints
+        if (snapshot->breakpoints != console->cpu_watch.breakpoints) {
+            snapshot->breakpoints = console->cpu_watch.breakpoints;
+        }
+        snapshot->gpu = console->gpu;
+        snapshot->dma = console->dma;
+        snapshot->ram.resize(ps1::RAM_SIZE);
+        memcpy(snapshot->ram.data(), console->ram.data, ps1::RAM_SIZE);
+        snapshot->settings = emulation->settings;
+        snapshot->frame_cnt = frame_cnt;
+
+        copy_frame(emulation, snapshot, ahead);
+
+        // * ui is holding front, keep filling back until it lets go
+        if (emulation->snapshot_mutex.try_lock()) {
+            emulation->front = back;
+            emulation->snapshot_mutex.unlock();
+        }
+    }
+
+    void run(ps1::emulation_t* emulation, str_t bios_path, std::promise<void> ready) {
+        ps1::ps1_t* console = emulation->console;
+
+        ps1::render::bind_context(emulation->context);
+        ps1::render::use_shader(ps1::VRAM_DRAW_SHADER);
+
+        ps1::ps1_init(console, bios_path);
+        ps1::vram_set_resolution_scale(&console->vram, emulation->settings.resolution_scale);
+        ps1::ps1_set_hle(console, emulation->settings.hle);
+
+        if (emulation->settings.boot_cache) {
+            ps1::ps1_boot_from_cache(console, boot_cache_dir);
+        }
+
+        ps1::rewind_init(&emulation->rewind, rewind_max_bytes);
+        emulation->rewind_index = 0;
+
+        if (!ps1::audio_output_start(&emulation->audio_output, &console->audio, host_sample_rate, host_period_frames, audio_target_fill)) {
+            ps1::logger::push("no audio device, running without sound", ps1::logger::type_t::warning, "audio");
+        }
+
+        uint32_t frame_cnt = 0;
+
+        publish(emulation, frame_cnt, false);
+        ready.set_value();
+
+        auto next_frame = std::chrono::steady_clock::now();
+        double frame_budget = 0; // * cycles left in current frame, negative when last instruction overshot
+
+        uint32_t skip_index = 0; // * position inside current skip period
+
+        while (!emulation->quit) {
+            run_cmds(emulation);
+
+            bool running = console->cpu.state == ps1::cpu_state_t::running;
+            bool skip = running && is_skipped(&emulation->settings, skip_index);
+
+            skip_index = running ? (skip_index + 1) % std::max(emulation->settings.skip_period, 1) : 0;
+
+            bool ahead = false; // * frame to present was drawn ahead and sits in vram backup
+
+            if (running && emulation->settings.run_ahead > 0) {
+                ahead = run_frame_ahead(emulation, &frame_budget, skip);
+            } else if (running) {
+                ps1::gpu_set_render_enabled(&console->gpu, !skip);
+                run_frame(console, &frame_budget);
+            }
+
+            ps1::gpu_set_render_enabled(&console->gpu, true); // * commands posted between frames are rendered
+
+            ps1::ps1_poll_shell_entry(console);
+
+            // * stopped mid frame, next run starts on fresh frame
+            if (console->cpu.state != ps1::cpu_state_t::running) {
+                frame_budget = 0;
+            }
+
+            frame_cnt++;
+
+            ps1::ps1_poll_save_state(console, false);
+
+            if (running && emulation->settings.rewind) {
+                capture_rewind(emulation);
+            }
+
+            if (!skip) {
+                publish(emulation, frame_cnt, ahead);
+            }
+
+            // * sleeps until host has consumed about a frame of audio, spu output keeps up with real time on its own
+            if (running && is_audio_paced(emulation)) {
+                uint32_t burst_frames = (uint32_t)(ps1::AUDIO_SAMPLE_RATE / ps1::gpu_frame_rate(&console->gpu));
+
+                ps1::audio_output_wait(&emulation->audio_output, burst_frames, emulation->quit);
+
+                next_frame = std::chrono::steady_clock::now();
+
+                continue;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+
+            if (running && emulation->settings.uncapped) {
+                next_frame = now;
+
+                continue;
+            }
+
+            next_frame += get_frame_duration(&console->gpu, emulation->settings.speed);
+
+            // * do not try to catch up after long stall
+            if (next_frame < now) {
+                next_frame = now;
+            }
+
+            wait_until(next_frame);
+        }
+
+        for (auto& snapshot : emulation->snapshots) {
+            del_frame(&snapshot);
+        }
+
+        ps1::audio_output_stop(&emulation->audio_output);
+        ps1::rewind_exit(&emulation->rewind);
+        ps1::ps1_exit(console);
+
+        ps1::render::bind_context(nullptr);
+    }
+}
+
+void ps1::emulation_start(emulation_t* emulation, ps1_t* console, const str_t& bios_path, const emulation_settings_t& settings) {
+    emulation->console = console;
+    emulation->settings = settings;
+    emulation->quit = false;
+    emulation->front = 0;
+
+    for (auto& snapshot : emulation->snapshots) {
+        snapshot.frame_fbo = 0;
+        snapshot.frame_tbo = 0;
+        snapshot.frame_width = 0;
+        snapshot.frame_height = 0;
+        snapshot.frame_fence = nullptr;
+        snapshot.present_fence = nullptr;
+    }
+
+    emulation->context = render::make_shared_context();
+
+    std::promise<void> ready;
+    std::future<void> ready_future = ready.get_future();
+
+    emulation->thread = std::thread(run, emulation, bios_path, std::move(ready));
+
+    ready_future.wait();
+
+    logger::push("emulation thread started", logger::type_t::info, "emulation");
+}
+
+void ps1::emulation_stop(emulation_t* emulation) {
+    emulation->quit = true;
+    emulation->thread.join();
+
+    render::destroy_context(emulation->context);
+}
+
+void ps1::emulation_post(emulation_t* emulation, emulation_cmd_t cmd) {
+    std::lock_guard<std::mutex> lock(emulation->cmd_mutex);
+    emulation->cmds.emplace_back(std::move(cmd));
+}
+
+bool ps1::emulation_rewind(emulation_t* emulation) {
+    if (!rewind_pop(&emulation->rewind, &emulation->rewind_state)) return false;
+
+    cpu_state_t state = emulation->console->cpu.state;
+
+    ps1_load_state(emulation->console, &emulation->rewind_state);
+    cpu_set_state(&emulation->console->cpu, state); // * loading pauses cpu
+
+    // * next capture is a full interval away, holding rewind does not record over itself
+    emulation->rewind_index = 0;
+
+    return true;
+}
+
+void ps1::emulation_rewind_clear(emulation_t* emulation) {
+    rewind_clear(&emulation->rewind);
+
+    emulation->rewind_index = 0;
+}
+
+ps1::emulation_snapshot_t* ps1::emulation_acquire(emulation_t* emulation) {
+    emulation->snapshot_mutex.lock();
+
+    emulation_snapshot_t* snapshot = &emulation->snapshots[emulation->front];
+
+    // * gpu side wait, ui thread itself does not block
+    glWaitSync(snapshot->frame_fence, 0, GL_TIMEOUT_IGNORED);
+
+    return snapshot;
+}
+
+void ps1::emulation_release(emulation_t* emulation) {
+    emulation_snapshot_t* snapshot = &emulation->snapshots[emulation->front];
+
+    if (snapshot->present_fence) {
+        glDeleteSync(snapshot->present_fence);
+    }
+
+    snapshot->present_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    emulation->snapshot_mutex.unlock();
+}
+
+uint32_t ps1::emulation_fetch32(emulation_t* emulation, emulation_snapshot_t* snapshot, mem_addr_t mem_addr) {
+    mem_addr = mask_addr(mem_addr) & ~3;
+
+    if (mem_addr >= RAM_ADDR && mem_addr < RAM_ADDR + RAM_SIZE) {
+        return *(uint32_t*)(snapshot->ram.data() + mem_addr - RAM_ADDR);
+    }
+
+    // * bios is never written after init
+    if (mem_addr >= BIOS_ADDR && mem_addr < BIOS_ADDR + BIOS_SIZE) {
+        return *(uint32_t*)(emulation->console->bios.data + mem_addr - BIOS_ADDR);
+    }
+
+    return 0;
+}
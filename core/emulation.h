@@ -1,9 +1,109 @@
 #pragma once
 
 #include "defs.h"
+#include "cpu.h"
+#include "gpu.h"
+#include "dma.h"
+#include "rewind.h"
+#include "audio_output.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 namespace ps1 {
     struct emulation_settings_t {
-        int32_t instr_per_frame;
+        bool uncapped; // * run frames back to back without waiting for wall clock
+        float speed; // * wall clock multiplier when capped
+        bool audio_sync; // * at 1x, pace frames by host audio device consumption instead of wall clock. no effect without device
+
+        // * while fast forwarding, skip_frames out of every skip_period frames are neither rasterized nor presented
+        int32_t skip_frames;
+        int32_t skip_period;
+
+        int32_t run_ahead; // * frames emulated ahead of real state, only the last one is presented
+        int32_t resolution_scale;
+
+        bool rewind; // * capture states into rewind history while running
+        int32_t rewind_interval; // * frames between two captures
+
+        bool boot_cache; // * restore or capture post bios snapshot on start
+        bool hle; // * service hot bios kernel calls natively
+    };
+
+    // * copy of console state taken by emulation thread at end of frame
+    struct emulation_snapshot_t {
+        cpu_t cpu; // * registers only, watch is null
+        set_t<mem_addr_t> breakpoints;
+        gpu_t gpu;
+        dma_t dma;
+        dyn_arr_t<uint8_t> ram;
+
+        emulation_settings_t settings;
+        uint32_t frame_cnt;
+
+        // * copy of scaled vram color target
+        uint32_t frame_fbo; // * only valid on emulation context
+        uint32_t frame_tbo;
+        uint32_t frame_width;
+        uint32_t frame_height;
+        GLsync frame_fence; // * signaled when copy into frame_tbo is done
+        GLsync present_fence; // * signaled when ui is done sampling frame_tbo
+    };
+
+    typedef func_t<void(ps1_t*, emulation_settings_t*)> emulation_cmd_t;
+
+    /*
+    * console runs on its own thread with its own shared gl context
+    * each frame runs exactly one vblank worth of cpu cycles and is then paced to wall clock,
+    * or with audio sync to host audio device draining ring back to its target fill
+    * ui thread never touches console directly. it reads front snapshot and posts commands
+    *
+    * snapshots are double buffered. emulation thread fills back one and swaps only if ui is not holding front,
+    * otherwise frame is dropped from ui. neither side waits for the other
+    */
+    struct emulation_t {
+        ps1_t* console;
+        emulation_settings_t settings; // * owned by emulation thread
+        dyn_arr_t<uint8_t> run_ahead_state; // * real console state while frames ahead are emulated
+
+        audio_output_t audio_output;
+
+        rewind_t rewind;
+        dyn_arr_t<uint8_t> rewind_state; // * capture handed to rewind worker, or state popped from it
+        uint32_t rewind_index; // * frames since last capture
+
+        std::thread thread;
+        std::atomic<bool> quit;
+        GLFWwindow* context;
+
+        std::mutex cmd_mutex;
+        dyn_arr_t<emulation_cmd_t> cmds;
+
+        std::mutex snapshot_mutex; // * held by ui while front snapshot is used
+        emulation_snapshot_t snapshots[2];
+        uint32_t front;
     };
-}
\ No newline at end of file
+
+    // * init console on new emulation thread and wait until first snapshot is published
+    void emulation_start(emulation_t*, ps1_t*, const str_t&, const emulation_settings_t&);
+
+    // * stop emulation thread and exit console
+    void emulation_stop(emulation_t*);
+
+    // * queue command to run on emulation thread before its next frame
+    void emulation_post(emulation_t*, emulation_cmd_t);
+
+    // * step console back to previous rewind capture, keeps cpu running state. emulation thread only
+    bool emulation_rewind(emulation_t*);
+
+    // * drop rewind history, for when console state jumps. emulation thread only
+    void emulation_rewind_clear(emulation_t*);
+
+    // * lock front snapshot for ui, it may be freely modified. must be paired with emulation_release after ui rendering is submitted
+    emulation_snapshot_t* emulation_acquire(emulation_t*);
+    void emulation_release(emulation_t*);
+
+    // * debug fetch from snapshot. only ram and bios are visible, other devices read as 0
+    uint32_t emulation_fetch32(emulation_t*, emulation_snapshot_t*, mem_addr_t);
+}
@@ -0,0 +1,102 @@
+#include "exe.h"
+#include "serializer.h"
+#include "logger.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint32_t header_size = 0x800;
+    constexpr char magic[] = "PS-X EXE";
+
+    uint32_t load32(const uint8_t* header, uint32_t offset) {
+        uint32_t value;
+        memcpy(&value, header + offset, sizeof(value));
+        return value;
+    }
+
+    // * physical ram offset, false if range does not fit into ram
+    bool ram_range(ps1::mem_addr_t addr, uint32_t size, uint32_t* offset) {
+        ps1::mem_addr_t physical = ps1::mask_addr(addr);
+
+        if (physical < ps1::RAM_ADDR || physical - ps1::RAM_ADDR + (uint64_t)size > ps1::RAM_SIZE) return false;
+
+        *offset = physical - ps1::RAM_ADDR;
+
+        return true;
+    }
+}
+
+bool ps1::exe_read(exe_t* exe, const str_t& path) {
+    serializer_t serializer;
+
+    if (!serializer_open_mmap(&serializer, path, serializer_mode_t::read)) {
+        logger::push("failed to open " + path, logger::type_t::error, "exe");
+
+        serializer_close(&serializer);
+
+        return false;
+    }
+
+    const uint8_t* header = serializer_read_view(&serializer, header_size);
+
+    if (!header || memcmp(header, magic, sizeof(magic) - 1) != 0) {
+        logger::push(path + " is not a ps-x exe", logger::type_t::error, "exe");
+
+        serializer_close(&serializer);
+
+        return false;
+    }
+
+    exe->pc = load32(header, 0x10);
+    exe->gp = load32(header, 0x14);
+    exe->text_addr = load32(header, 0x18);
+    exe->bss_addr = load32(header, 0x28);
+    exe->bss_size = load32(header, 0x2C);
+    exe->stack_addr = load32(header, 0x30);
+    exe->stack_size = load32(header, 0x34);
+
+    uint32_t text_size = load32(header, 0x1C);
+    uint32_t offset;
+
+    if (!ram_range(exe->text_addr, text_size, &offset) || (exe->bss_size && !ram_range(exe->bss_addr, exe->bss_size, &offset))) {
+        logger::push(path + " does not fit into ram", logger::type_t::error, "exe");
+
+        serializer_close(&serializer);
+
+        return false;
+    }
+
+    // * some linkers pad text size past end of file
+    size_t available = serializer.mapped_size - serializer.offset;
+    const uint8_t* text = serializer_read_view(&serializer, std::min<size_t>(text_size, available));
+
+    exe->text.assign(text, text + std::min<size_t>(text_size, available));
+    exe->text.resize(text_size, 0);
+
+    serializer_close(&serializer);
+
+    logger::push("read " + path + ", " + std::to_string(text_size) + " bytes of text", logger::type_t::info, "exe");
+
+    return true;
+}
+
+void ps1::exe_load(exe_t* exe, ram_t* ram, cpu_t* cpu) {
+    uint32_t offset;
+
+    if (ram_range(exe->text_addr, exe->text.size(), &offset)) {
+        memcpy(ram->data + offset, exe->text.data(), exe->text.size());
+    }
+
+    if (exe->bss_size && ram_range(exe->bss_addr, exe->bss_size, &offset)) {
+        memset(ram->data + offset, 0, exe->bss_size);
+    }
+
+    cpu_set_reg(cpu, 28, exe->gp);
+
+    if (exe->stack_addr) {
+        cpu_set_reg(cpu, 29, exe->stack_addr + exe->stack_size);
+        cpu_set_reg(cpu, 30, exe->stack_addr + exe->stack_size);
+    }
+
+    cpu_jump(cpu, exe->pc);
+}
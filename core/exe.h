@@ -0,0 +1,38 @@
+#pragma once
+
+#include "defs.h"
+#include "cpu.h"
+#include "ram.h"
+
+namespace ps1 {
+    /*
+    * ps-x exe executable
+    * 2 kb header followed by text segment. header fields are little endian words:
+    * 0x00 "PS-X EXE"
+    * 0x10 initial pc
+    * 0x14 initial $gp
+    * 0x18 text destination
+    * 0x1C text size
+    * 0x28 bss start
+    * 0x2C bss size
+    * 0x30 stack base, 0 keeps $sp of caller
+    * 0x34 stack offset
+    */
+    struct exe_t {
+        mem_addr_t pc;
+        mem_addr_t gp;
+        mem_addr_t text_addr;
+        mem_addr_t bss_addr;
+        uint32_t bss_size;
+        mem_addr_t stack_addr;
+        uint32_t stack_size;
+
+        dyn_arr_t<uint8_t> text;
+    };
+
+    // * parse and validate file. errors are logged
+    bool exe_read(exe_t*, const str_t&);
+
+    // * copy text into ram, clear bss and start cpu at entry with registers from header
+    void exe_load(exe_t*, ram_t*, cpu_t*);
+}
@@ -1,24 +1,146 @@
 #include "gpu.h"
-#include "file.h"
+#include "cpu.h"
+#include "serializer.h"
 #include "vram.h"
 
+#include <algorithm>
+#include <chrono>
+
 void ps1::gpu_init(gpu_t* gpu, vram_t* vram) {
     gpu->vram = vram;
 
     gpu->stat.raw = 0;
     gpu->stat.display_disable = 1;
 
+    gpu->drawing_area_left = 0;
+    gpu->drawing_area_top = 0;
+    gpu->drawing_area_right = 0;
+    gpu->drawing_area_bottom = 0;
+    gpu->drawing_offset_x = 0;
+    gpu->drawing_offset_y = 0;
+
+    vram_set_draw_area(gpu->vram, 0, 0, 0, 0);
+    vram_set_mask_mode(gpu->vram, false, false);
+
     gpu->gp0_fn_info.args_left = 0;
     gpu->gp0_cmd_buffer.size = 0;
     gpu->gp0_data_mode = gp0_data_mode_t::command;
+
+    gpu->gpuread_buffer.clear();
+    gpu->gpuread_index = 0;
+
+    gpu->stats = {};
+
+    gpu->render_enabled = true;
 }
 
 void ps1::gpu_exit(gpu_t* gpu) {}
 
 namespace {
+    constexpr int32_t max_primitive_width = 1023;
+    constexpr int32_t max_primitive_height = 511;
+
     uint32_t sign_extend_11(uint32_t value) {
         return ((int16_t)(value << 5)) >> 5;
     }
+
+    struct vertex_coord_t {
+        int32_t x;
+        int32_t y;
+    };
+
+    // * vertex position is a pair of signed 11 bit values relative to drawing offset
+    vertex_coord_t get_vertex_coord(ps1::gpu_t* gpu, uint32_t value) {
+        return {
+            (int32_t)sign_extend_11(value & 0x7ff) + gpu->drawing_offset_x,
+            (int32_t)sign_extend_11((value >> 16) & 0x7ff) + gpu->drawing_offset_y,
+        };
+    }
+
+    /*
+    * check if triangle can be dropped before reaching vertex stream
+    * hardware skips polygons wider than 1023 or taller than 511 pixels
+    * degenerate triangles and triangles outside of drawing area produce no pixels
+    */
+    bool is_triangle_rejected(ps1::gpu_t* gpu, vertex_coord_t v0, vertex_coord_t v1, vertex_coord_t v2) {
+        int32_t min_x = std::min({ v0.x, v1.x, v2.x });
+        int32_t max_x = std::max({ v0.x, v1.x, v2.x });
+        int32_t min_y = std::min({ v0.y, v1.y, v2.y });
+        int32_t max_y = std::max({ v0.y, v1.y, v2.y });
+
+        if (max_x - min_x > max_primitive_width || max_y - min_y > max_primitive_height) {
+            return true;
+        }
+
+        if ((v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y) == 0) {
+            return true;
+        }
+
+        return
+            max_x < (int32_t)gpu->drawing_area_left || min_x > (int32_t)gpu->drawing_area_right ||
+            max_y < (int32_t)gpu->drawing_area_top || min_y > (int32_t)gpu->drawing_area_bottom;
+    }
+
+    // * bounding box clipped by drawing area
+    uint64_t estimate_pixel_cnt(ps1::gpu_t* gpu, const vertex_coord_t* coords, uint32_t count) {
+        int32_t min_x = coords[0].x, max_x = coords[0].x;
+        int32_t min_y = coords[0].y, max_y = coords[0].y;
+
+        for (uint32_t i = 1; i < count; i++) {
+            min_x = std::min(min_x, coords[i].x);
+            max_x = std::max(max_x, coords[i].x);
+            min_y = std::min(min_y, coords[i].y);
+            max_y = std::max(max_y, coords[i].y);
+        }
+
+        min_x = std::max(min_x, (int32_t)gpu->drawing_area_left);
+        max_x = std::min(max_x, (int32_t)gpu->drawing_area_right);
+        min_y = std::max(min_y, (int32_t)gpu->drawing_area_top);
+        max_y = std::min(max_y, (int32_t)gpu->drawing_area_bottom);
+
+        if (min_x > max_x || min_y > max_y) return 0;
+
+        return (uint64_t)(max_x - min_x + 1) * (max_y - min_y + 1);
+    }
+}
+
+namespace ps1 {
+    void gpu_draw_triangle(gpu_t* gpu, vertex_coord_t (&coords)[3], const triangle_t& triangle) {
+        if (is_triangle_rejected(gpu, coords[0], coords[1], coords[2])) {
+            return;
+        }
+
+        if (gpu->render_enabled) {
+            vram_draw_triangle(gpu->vram, triangle);
+        }
+
+        gpu->stats.current.vertex_cnt += 3;
+        gpu->stats.current.pixel_cnt += estimate_pixel_cnt(gpu, coords, 3);
+    }
+
+    // * quad is rasterized as two triangles (0, 1, 2) and (1, 2, 3), each of them is tested separately
+    void gpu_draw_quad(gpu_t* gpu, vertex_coord_t (&coords)[4], const quad_t& quad) {
+        bool first_rejected = is_triangle_rejected(gpu, coords[0], coords[1], coords[2]);
+        bool second_rejected = is_triangle_rejected(gpu, coords[1], coords[2], coords[3]);
+        bool render = gpu->render_enabled;
+
+        if (!first_rejected && !second_rejected) {
+            if (render) vram_draw_quad(gpu->vram, quad);
+
+            gpu->stats.current.vertex_cnt += 6;
+            gpu->stats.current.pixel_cnt += estimate_pixel_cnt(gpu, coords, 4);
+        } else if (!first_rejected) {
+            if (render) vram_draw_triangle(gpu->vram, { quad.vertices[0], quad.vertices[1], quad.vertices[2] });
+
+            gpu->stats.current.vertex_cnt += 3;
+            gpu->stats.current.pixel_cnt += estimate_pixel_cnt(gpu, coords, 3);
+        } else if (!second_rejected) {
+            if (render) vram_draw_triangle(gpu->vram, { quad.vertices[1], quad.vertices[2], quad.vertices[3] });
+
+            gpu->stats.current.vertex_cnt += 3;
+            gpu->stats.current.pixel_cnt += estimate_pixel_cnt(gpu, coords + 1, 3);
+        }
+    }
 }
 
 namespace ps1 {
@@ -31,6 +153,13 @@ namespace ps1 {
     void gp0_quad_mono_opaque(gpu_t* gpu) {
         // logger::push("GP0: drawing quad", logger::type_t::message, "gpu");
 
+        vertex_coord_t vertice_coord[] = {
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[1]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[2]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[3]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[4]),
+        };
+
         pos_t vertice_pos[] = {
             gpu->gp0_cmd_buffer.buffer[1],
             gpu->gp0_cmd_buffer.buffer[2],
@@ -54,7 +183,7 @@ namespace ps1 {
             }
         };
 
-        vram_draw_quad(gpu->vram, quad);
+        gpu_draw_quad(gpu, vertice_coord, quad);
     }
 
     void gp0_quad_blend_opaque_textured(gpu_t* gpu) {
@@ -68,6 +197,13 @@ namespace ps1 {
         uint32_t clut_x = (clut & 0x3f) << 4;
         uint32_t clut_y = (clut >> 6) & 0x1ff;
 
+        vertex_coord_t vertice_coord[] = {
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[1]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[3]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[5]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[7]),
+        };
+
         pos_t vertice_pos[] = {
             gpu->gp0_cmd_buffer.buffer[1],
             gpu->gp0_cmd_buffer.buffer[3],
@@ -96,12 +232,18 @@ namespace ps1 {
             }
         };
 
-        vram_draw_quad(gpu->vram, quad);
+        gpu_draw_quad(gpu, vertice_coord, quad);
     }
 
     void gp0_triangle_shaded_opaque(gpu_t* gpu) {
         // logger::push("GP0: drawing shaded triangle", logger::type_t::message, "gpu");
 
+        vertex_coord_t vertice_coord[] = {
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[1]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[3]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[5]),
+        };
+
         pos_t vertice_pos[] = {
             gpu->gp0_cmd_buffer.buffer[1],
             gpu->gp0_cmd_buffer.buffer[3],
@@ -109,7 +251,7 @@ namespace ps1 {
         };
 
         pos_t offset = { gpu->drawing_offset_x, gpu->drawing_offset_y };
-        for (uint32_t i = 0; i < 4; i++) {
+        for (uint32_t i = 0; i < 3; i++) {
             vertice_pos[i] = vertice_pos[i] + offset;
         }
 
@@ -127,12 +269,19 @@ namespace ps1 {
             }
         };
 
-        vram_draw_triangle(gpu->vram, triangle);
+        gpu_draw_triangle(gpu, vertice_coord, triangle);
     }
 
     void gp0_quad_shaded_opaque(gpu_t* gpu) {
         // logger::push("GP0: drawing shaded quad", logger::type_t::message, "gpu");
 
+        vertex_coord_t vertice_coord[] = {
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[1]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[3]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[5]),
+            get_vertex_coord(gpu, gpu->gp0_cmd_buffer.buffer[7]),
+        };
+
         pos_t vertice_pos[] = {
             gpu->gp0_cmd_buffer.buffer[1],
             gpu->gp0_cmd_buffer.buffer[3],
@@ -161,7 +310,7 @@ namespace ps1 {
             }
         };
 
-        vram_draw_quad(gpu->vram, quad);
+        gpu_draw_quad(gpu, vertice_coord, quad);
     }
 
     void gp0_load_texture(gpu_t* gpu) {
@@ -201,9 +350,21 @@ namespace ps1 {
     }
 
     void gp0_store_texture(gpu_t* gpu) {
+        uint32_t xpos = gpu->gp0_cmd_buffer.buffer[1] & 0x3ff;
+        uint32_t ypos = (gpu->gp0_cmd_buffer.buffer[1] >> 16) & 0x1ff;
+
         uint32_t resolution = gpu->gp0_cmd_buffer.buffer[2];
-        uint32_t width = resolution & 0xffff;
-        uint32_t height = resolution >> 16;
+        uint32_t width = (((resolution & 0xffff) - 1) & 0x3ff) + 1;
+        uint32_t height = (((resolution >> 16) - 1) & 0x1ff) + 1;
+
+        // ! wrapping around vram edges is not handled
+        width = std::min(width, 1024 - xpos);
+        height = std::min(height, 512 - ypos);
+
+        gpu->gpuread_buffer.resize(width * height + ((width * height) & 0x1)); // * round up to be even
+        gpu->gpuread_index = 0;
+
+        vram_read_region(gpu->vram, xpos, ypos, width, height, gpu->gpuread_buffer.data());
         
         logger::push("GP0: storing image into ram", logger::type_t::message, "gpu");
     }
@@ -236,13 +397,17 @@ namespace ps1 {
 
         gpu->drawing_area_left = value & 0x3ff;
         gpu->drawing_area_top = (value >> 10) & 0x3ff;
+
+        vram_set_draw_area(gpu->vram, gpu->drawing_area_left, gpu->drawing_area_top, gpu->drawing_area_right, gpu->drawing_area_bottom);
     }
     
     void gp0_set_draw_area_bottom_right(gpu_t* gpu) {
         uint32_t value = gpu->gp0_cmd_buffer.buffer[0];
 
         gpu->drawing_area_right = value & 0x3ff;
-        gpu->drawing_area_top = (value >> 10) & 0x3ff;
+        gpu->drawing_area_bottom = (value >> 10) & 0x3ff;
+
+        vram_set_draw_area(gpu->vram, gpu->drawing_area_left, gpu->drawing_area_top, gpu->drawing_area_right, gpu->drawing_area_bottom);
     }
     
     void gp0_set_drawing_offset(gpu_t* gpu) {
@@ -257,6 +422,8 @@ namespace ps1 {
 
         gpu->stat.set_mask_bit_on_draw = (value >> 0) & 0x1;
         gpu->stat.preserve_masked_pixels = (value >> 1) & 0x1;
+
+        vram_set_mask_mode(gpu->vram, gpu->stat.set_mask_bit_on_draw, gpu->stat.preserve_masked_pixels);
     }
 }
 
@@ -303,23 +470,53 @@ void ps1::gp0(gpu_t* gpu, uint32_t value) {
 
     gpu->gp0_fn_info.args_left--;
 
+    // * clock is read only around work that reaches vram, argument and stream words are just buffered
     if (gpu->gp0_data_mode == gp0_data_mode_t::command) {
         gpu->gp0_cmd_buffer.push(value);
 
         if (gpu->gp0_fn_info.args_left == 0) {
+            uint32_t opcode = gpu->gp0_cmd_opcode;
+            auto start_time = std::chrono::steady_clock::now();
+
             gpu->gp0_fn_info.fn(gpu);
+
+            uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+            gpu->stats.current.gp0_time_ns += elapsed;
+            gpu->stats.current.cmd_cnt[opcode]++;
+            gpu->stats.current.cmd_time_ns[opcode] += elapsed;
         }
     } else if (gpu->gp0_data_mode == gp0_data_mode_t::texture) {
-        vram_send_texture_stream_data(gpu->vram, value);
+        gpu->stats.current.upload_bytes += sizeof(value);
 
         if (gpu->gp0_fn_info.args_left == 0) {
+            // * last word of block flushes whole upload to vram
+            auto start_time = std::chrono::steady_clock::now();
+
+            vram_send_texture_stream_data(gpu->vram, value);
+
+            gpu->stats.current.gp0_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+
             gpu->gp0_data_mode = gp0_data_mode_t::command;
+        } else {
+            vram_send_texture_stream_data(gpu->vram, value);
         }
     } else {
         ASSERT(false, "ILLEGAL GP0 DATA MODE");
     }
 }
 
+uint32_t ps1::gpuread(gpu_t* gpu) {
+    if (gpu->gpuread_index >= gpu->gpuread_buffer.size()) {
+        return 0;
+    }
+
+    uint32_t lo = gpu->gpuread_buffer[gpu->gpuread_index++];
+    uint32_t hi = gpu->gpuread_buffer[gpu->gpuread_index++];
+
+    return lo | (hi << 16);
+}
+
 namespace ps1 {
     void gp1_clear_fifo(gpu_t* gpu) {
         gpu->gp0_cmd_buffer.size = 0;
@@ -349,6 +546,9 @@ namespace ps1 {
         gpu->display_line_start = 0x10;
         gpu->display_line_end = 0x100;
 
+        vram_set_draw_area(gpu->vram, gpu->drawing_area_left, gpu->drawing_area_top, gpu->drawing_area_right, gpu->drawing_area_bottom);
+        vram_set_mask_mode(gpu->vram, gpu->stat.set_mask_bit_on_draw, gpu->stat.preserve_masked_pixels);
+
         // todo: clear fifo and invalidate cache
         gp1_clear_fifo(gpu);
     }
@@ -457,64 +657,140 @@ void ps1::gp1(gpu_t* gpu, uint32_t value) {
     }
 }
 
-void ps1::gpu_save_state(gpu_t* gpu) {
-    file::write32(gpu->stat.raw);
-
-    file::write32(gpu->rect_texture_x_flip);
-    file::write32(gpu->rect_texture_y_flip);
-    file::write32(gpu->texture_window_x_mask);
-    file::write32(gpu->texture_window_y_mask);
-    file::write32(gpu->texture_window_x_offset);
-    file::write32(gpu->texture_window_y_offset);
-    file::write32(gpu->drawing_area_left);
-    file::write32(gpu->drawing_area_top);
-    file::write32(gpu->drawing_area_right);
-    file::write32(gpu->drawing_area_bottom);
-    file::write32(gpu->drawing_offset_x);
-    file::write32(gpu->drawing_offset_y);
-    file::write32(gpu->display_vram_x_start);
-    file::write32(gpu->display_vram_y_start);
-    file::write32(gpu->display_horiz_start);
-    file::write32(gpu->display_horiz_end);
-    file::write32(gpu->display_line_start);
-    file::write32(gpu->display_line_end);
-
-    file::write((uint8_t*)gpu->gp0_cmd_buffer.buffer, sizeof(gpu->gp0_cmd_buffer.buffer));
-    file::write32(gpu->gp0_cmd_buffer.size);
-    file::write32(gpu->gp0_fn_info.args_left);
-    file::write32(gpu->gp0_cmd_opcode);
-    file::write32((uint32_t)gpu->gp0_data_mode);
+void ps1::gpu_save_state(gpu_t* gpu, serializer_t* serializer) {
+    serializer_write32(serializer, gpu->stat.raw);
+
+    serializer_write32(serializer, gpu->rect_texture_x_flip);
+    serializer_write32(serializer, gpu->rect_texture_y_flip);
+    serializer_write32(serializer, gpu->texture_window_x_mask);
+    serializer_write32(serializer, gpu->texture_window_y_mask);
+    serializer_write32(serializer, gpu->texture_window_x_offset);
+    serializer_write32(serializer, gpu->texture_window_y_offset);
+    serializer_write32(serializer, gpu->drawing_area_left);
+    serializer_write32(serializer, gpu->drawing_area_top);
+    serializer_write32(serializer, gpu->drawing_area_right);
+    serializer_write32(serializer, gpu->drawing_area_bottom);
+    serializer_write32(serializer, gpu->drawing_offset_x);
+    serializer_write32(serializer, gpu->drawing_offset_y);
+    serializer_write32(serializer, gpu->display_vram_x_start);
+    serializer_write32(serializer, gpu->display_vram_y_start);
+    serializer_write32(serializer, gpu->display_horiz_start);
+    serializer_write32(serializer, gpu->display_horiz_end);
+    serializer_write32(serializer, gpu->display_line_start);
+    serializer_write32(serializer, gpu->display_line_end);
+
+    serializer_write(serializer, (uint8_t*)gpu->gp0_cmd_buffer.buffer, sizeof(gpu->gp0_cmd_buffer.buffer));
+    serializer_write32(serializer, gpu->gp0_cmd_buffer.size);
+    serializer_write32(serializer, gpu->gp0_fn_info.args_left);
+    serializer_write32(serializer, gpu->gp0_cmd_opcode);
+    serializer_write32(serializer, (uint32_t)gpu->gp0_data_mode);
 }
 
-void ps1::gpu_load_state(gpu_t* gpu) {
-    gpu->stat.raw = file::read32();
+void ps1::gpu_load_state(gpu_t* gpu, serializer_t* serializer) {
+    gpu->stat.raw = serializer_read32(serializer);
     
-    gpu->rect_texture_x_flip = file::read32();
-    gpu->rect_texture_y_flip = file::read32();
-    gpu->texture_window_x_mask = file::read32();
-    gpu->texture_window_y_mask = file::read32();
-    gpu->texture_window_x_offset = file::read32();
-    gpu->texture_window_y_offset = file::read32();
-    gpu->drawing_area_left = file::read32();
-    gpu->drawing_area_top = file::read32();
-    gpu->drawing_area_right = file::read32();
-    gpu->drawing_area_bottom = file::read32();
-    gpu->drawing_offset_x = file::read32();
-    gpu->drawing_offset_y = file::read32();
-    gpu->display_vram_x_start = file::read32();
-    gpu->display_vram_y_start = file::read32();
-    gpu->display_horiz_start = file::read32();
-    gpu->display_horiz_end = file::read32();
-    gpu->display_line_start = file::read32();
-    gpu->display_line_end = file::read32();
+    gpu->rect_texture_x_flip = serializer_read32(serializer);
+    gpu->rect_texture_y_flip = serializer_read32(serializer);
+    gpu->texture_window_x_mask = serializer_read32(serializer);
+    gpu->texture_window_y_mask = serializer_read32(serializer);
+    gpu->texture_window_x_offset = serializer_read32(serializer);
+    gpu->texture_window_y_offset = serializer_read32(serializer);
+    gpu->drawing_area_left = serializer_read32(serializer);
+    gpu->drawing_area_top = serializer_read32(serializer);
+    gpu->drawing_area_right = serializer_read32(serializer);
+    gpu->drawing_area_bottom = serializer_read32(serializer);
+    gpu->drawing_offset_x = serializer_read32(serializer);
+    gpu->drawing_offset_y = serializer_read32(serializer);
+    gpu->display_vram_x_start = serializer_read32(serializer);
+    gpu->display_vram_y_start = serializer_read32(serializer);
+    gpu->display_horiz_start = serializer_read32(serializer);
+    gpu->display_horiz_end = serializer_read32(serializer);
+    gpu->display_line_start = serializer_read32(serializer);
+    gpu->display_line_end = serializer_read32(serializer);
     
-    file::read((uint8_t*)gpu->gp0_cmd_buffer.buffer, sizeof(gpu->gp0_cmd_buffer.buffer));
-    gpu->gp0_cmd_buffer.size = file::read32();
-    gpu->gp0_fn_info.args_left = file::read32();
-    gpu->gp0_cmd_opcode = file::read32();
-    gpu->gp0_data_mode = (gp0_data_mode_t)file::read32();
+    serializer_read(serializer, (uint8_t*)gpu->gp0_cmd_buffer.buffer, sizeof(gpu->gp0_cmd_buffer.buffer));
+    gpu->gp0_cmd_buffer.size = serializer_read32(serializer);
+    gpu->gp0_fn_info.args_left = serializer_read32(serializer);
+    gpu->gp0_cmd_opcode = serializer_read32(serializer);
+    gpu->gp0_data_mode = (gp0_data_mode_t)serializer_read32(serializer);
+
+    vram_set_draw_area(gpu->vram, gpu->drawing_area_left, gpu->drawing_area_top, gpu->drawing_area_right, gpu->drawing_area_bottom);
+    vram_set_mask_mode(gpu->vram, gpu->stat.set_mask_bit_on_draw, gpu->stat.preserve_masked_pixels);
 
     if (gpu->gp0_fn_info.args_left > 0) {
         gpu->gp0_fn_info.fn = get_gp0_fn_info(gpu->gp0_cmd_opcode).fn;
     }
+}
+
+namespace {
+    // * video clock, dots per scanline and scanlines per progressive frame
+    constexpr double ntsc_video_clock = 53693175;
+    constexpr double ntsc_dots_per_line = 3413;
+    constexpr double ntsc_lines_per_frame = 263;
+
+    constexpr double pal_video_clock = 53203425;
+    constexpr double pal_dots_per_line = 3406;
+    constexpr double pal_lines_per_frame = 314;
+}
+
+void ps1::gpu_set_render_enabled(gpu_t* gpu, bool enabled) {
+    gpu->render_enabled = enabled;
+}
+
+double ps1::gpu_frame_rate(gpu_t* gpu) {
+    if (gpu->stat.video_mode) {
+        return pal_video_clock / (pal_dots_per_line * pal_lines_per_frame); // * ~49.76 Hz
+    }
+
+    return ntsc_video_clock / (ntsc_dots_per_line * ntsc_lines_per_frame); // * ~59.83 Hz
+}
+
+double ps1::gpu_cycles_per_frame(gpu_t* gpu) {
+    return CPU_CLOCK / gpu_frame_rate(gpu);
+}
+
+void ps1::gpu_end_frame(gpu_t* gpu) {
+    gpu_stats_t& stats = gpu->stats;
+    gpu_frame_stats_t& frame = stats.current;
+
+    frame.draw_call_cnt = gpu->vram->draw_call_cnt;
+    frame.flush_cnt = gpu->vram->flush_cnt;
+    gpu->vram->draw_call_cnt = 0;
+    gpu->vram->flush_cnt = 0;
+
+    uint32_t primitive_cnt = 0;
+    for (uint32_t opcode = 0x20; opcode < 0x80; opcode++) { // * polygons, lines and rectangles
+        primitive_cnt += frame.cmd_cnt[opcode];
+    }
+
+    uint32_t i = stats.history_index;
+    stats.gp0_time_ms[i] = frame.gp0_time_ns / 1e6f;
+    stats.primitive_cnt[i] = primitive_cnt;
+    stats.vertex_cnt[i] = frame.vertex_cnt;
+    stats.pixel_cnt[i] = frame.pixel_cnt;
+    stats.upload_kb[i] = frame.upload_bytes / 1024.f;
+    stats.draw_call_cnt[i] = frame.draw_call_cnt;
+    stats.history_index = (i + 1) % GPU_STATS_HISTORY_SIZE;
+
+    stats.last = frame;
+    stats.current = {};
+    stats.frame_cnt++;
+}
+
+void ps1::gpu_dump_stats(gpu_t* gpu, FILE* out) {
+    gpu_frame_stats_t& frame = gpu->stats.last;
+
+    fprintf(out, "gpu frame %u\n", gpu->stats.frame_cnt);
+    fprintf(out, "  gp0 time: %.3f ms\n", frame.gp0_time_ns / 1e6);
+    fprintf(out, "  vertices: %u\n", frame.vertex_cnt);
+    fprintf(out, "  pixels: %llu\n", (unsigned long long)frame.pixel_cnt);
+    fprintf(out, "  uploaded: %u bytes\n", frame.upload_bytes);
+    fprintf(out, "  draw calls: %u\n", frame.draw_call_cnt);
+    fprintf(out, "  flushes: %u\n", frame.flush_cnt);
+
+    for (uint32_t opcode = 0; opcode < 256; opcode++) {
+        if (frame.cmd_cnt[opcode] == 0) continue;
+
+        fprintf(out, "  gp0 0x%02X: %u commands, %.3f ms\n", opcode, frame.cmd_cnt[opcode], frame.cmd_time_ns[opcode] / 1e6);
+    }
 }
\ No newline at end of file
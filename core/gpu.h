@@ -89,6 +89,36 @@ namespace ps1 {
         texture,
     };
 
+    // * counters of single emulated frame
+    struct gpu_frame_stats_t {
+        uint32_t cmd_cnt[256]; // * executed commands by gp0 opcode
+        uint64_t cmd_time_ns[256]; // * host time spent executing commands by gp0 opcode
+        uint32_t vertex_cnt; // * vertices submitted to vertex stream
+        uint64_t pixel_cnt; // * pixels touched. estimated from bounding boxes
+        uint32_t upload_bytes; // * cpu to vram transfers
+        uint32_t draw_call_cnt; // * gl draw calls
+        uint32_t flush_cnt; // * readbacks that stall until gl pipeline is drained
+        uint64_t gp0_time_ns; // * host time spent executing gp0 commands and flushing texture uploads
+    };
+
+    constexpr uint32_t GPU_STATS_HISTORY_SIZE = 120;
+
+    struct gpu_stats_t {
+        gpu_frame_stats_t current;
+        gpu_frame_stats_t last;
+
+        // * rolling history of past frames, used for graphs
+        float gp0_time_ms[GPU_STATS_HISTORY_SIZE];
+        float primitive_cnt[GPU_STATS_HISTORY_SIZE];
+        float vertex_cnt[GPU_STATS_HISTORY_SIZE];
+        float pixel_cnt[GPU_STATS_HISTORY_SIZE];
+        float upload_kb[GPU_STATS_HISTORY_SIZE];
+        float draw_call_cnt[GPU_STATS_HISTORY_SIZE];
+        uint32_t history_index; // * oldest entry
+
+        uint32_t frame_cnt;
+    };
+
     struct gpu_t {
         vram_t* vram;
 
@@ -113,26 +143,53 @@ namespace ps1 {
         uint32_t display_line_start;
         uint32_t display_line_end;
 
+        dyn_arr_t<uint16_t> gpuread_buffer; // * pixels of pending vram to cpu transfer
+        uint32_t gpuread_index;
+
         gpu_cmd_buffer_t gp0_cmd_buffer;
         gp0_fn_info_t gp0_fn_info;
         uint32_t gp0_cmd_opcode; // * used for state recovery
         gp0_data_mode_t gp0_data_mode;
+
+        gpu_stats_t stats;
+
+        /*
+        * when disabled primitives still go through command decoding, rejection and stats
+        * but are not rasterized. state commands and vram transfers are always applied
+        */
+        bool render_enabled;
     };
 
     void gpu_init(gpu_t*, vram_t*);
     void gpu_exit(gpu_t*);
     
-    void gpu_save_state(gpu_t*);
-    void gpu_load_state(gpu_t*);
+    void gpu_save_state(gpu_t*, serializer_t*);
+    void gpu_load_state(gpu_t*, serializer_t*);
+
+    // * used to skip rasterization of frames that will not be presented
+    void gpu_set_render_enabled(gpu_t*, bool);
+
+    // * vblank rate of current video mode
+    double gpu_frame_rate(gpu_t*);
+
+    // * cpu cycles between two vblanks of current video mode
+    double gpu_cycles_per_frame(gpu_t*);
+
+    // * close stats of current emulated frame
+    void gpu_end_frame(gpu_t*);
+
+    // * print stats of last finished frame
+    void gpu_dump_stats(gpu_t*, FILE*);
 
     void gp0(gpu_t*, uint32_t);
     void gp1(gpu_t*, uint32_t);
+    uint32_t gpuread(gpu_t*);
 
     FETCH_FN(gpu_t) fetch(void* device, mem_addr_t offset) {
         gpu_t* gpu = (gpu_t*)device;
 
         if (offset == 0) {
-            return 0;
+            return gpuread(gpu);
         } else if (offset == 4) {
             return gpu->stat.get();
         }
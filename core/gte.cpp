@@ -0,0 +1,838 @@
+#include "gte.h"
+#include "serializer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace {
+    // * flag register bits, index 0 is mac0/ir0
+    constexpr uint32_t flag_mac_pos[4] = { 1u << 16, 1u << 30, 1u << 29, 1u << 28 };
+    constexpr uint32_t flag_mac_neg[4] = { 1u << 15, 1u << 27, 1u << 26, 1u << 25 };
+    constexpr uint32_t flag_ir_sat[4] = { 1u << 12, 1u << 24, 1u << 23, 1u << 22 };
+    constexpr uint32_t flag_color_sat[3] = { 1u << 21, 1u << 20, 1u << 19 };
+    constexpr uint32_t flag_otz_sat = 1u << 18;
+    constexpr uint32_t flag_div_overflow = 1u << 17;
+    constexpr uint32_t flag_sx_sat = 1u << 14;
+    constexpr uint32_t flag_sy_sat = 1u << 13;
+    constexpr uint32_t flag_error = 1u << 31;
+    constexpr uint32_t flag_error_mask = 0x7F87E000; // * bits 30-23 and 18-13 raise error bit
+    constexpr uint32_t flag_writable_mask = 0x7FFFF000;
+
+    constexpr int64_t mac_max = 0x7FFFFFFFFFF; // * mac1-3 accumulate in 44 bits
+    constexpr int64_t mac_min = -0x80000000000;
+
+    constexpr uint32_t reg_flag = 31;
+
+    struct matrix_t {
+        int16_t m[3][3];
+    };
+
+    struct command_t {
+        uint32_t shift; // * sf bit, 0 or 12
+        bool lm; // * saturate ir1-3 to 0 instead of -8000h
+        uint32_t mx; // * mvmva matrix, 0 = RT, 1 = LLM, 2 = LCM, 3 = garbage
+        uint32_t vx; // * mvmva vector, 0-2 = V0-V2, 3 = IR
+        uint32_t tx; // * mvmva translation, 0 = TR, 1 = BK, 2 = FC, 3 = none
+    };
+
+    int16_t lo16(uint32_t value) {
+        return (int16_t)value;
+    }
+
+    int16_t hi16(uint32_t value) {
+        return (int16_t)(value >> 16);
+    }
+
+    void raise(ps1::gte_t* gte, uint32_t bits) {
+        gte->ctrl[reg_flag] |= bits;
+    }
+}
+
+namespace {
+    // * register unpacking
+
+    int16_t get_ir(ps1::gte_t* gte, uint32_t i) {
+        return lo16(gte->data[8 + i]);
+    }
+
+    int32_t get_mac(ps1::gte_t* gte, uint32_t i) {
+        return (int32_t)gte->data[24 + i];
+    }
+
+    uint16_t get_sz(ps1::gte_t* gte, uint32_t i) {
+        return (uint16_t)gte->data[16 + i];
+    }
+
+    uint8_t get_rgbc(ps1::gte_t* gte, uint32_t i) {
+        return (uint8_t)(gte->data[6] >> (i * 8));
+    }
+
+    // * V0, V1, V2 or IR when index is 3
+    void get_vector(ps1::gte_t* gte, uint32_t index, int16_t v[3]) {
+        if (index == 3) {
+            v[0] = get_ir(gte, 1);
+            v[1] = get_ir(gte, 2);
+            v[2] = get_ir(gte, 3);
+
+            return;
+        }
+
+        v[0] = lo16(gte->data[index * 2]);
+        v[1] = hi16(gte->data[index * 2]);
+        v[2] = lo16(gte->data[index * 2 + 1]);
+    }
+
+    // * five registers starting at base, elements packed as 16 bit pairs row by row
+    matrix_t get_matrix(ps1::gte_t* gte, uint32_t base) {
+        matrix_t matrix;
+
+        for (uint32_t k = 0; k < 9; k++) {
+            uint32_t word = gte->ctrl[base + k / 2];
+
+            matrix.m[k / 3][k % 3] = (k & 1) ? hi16(word) : lo16(word);
+        }
+
+        return matrix;
+    }
+
+    matrix_t get_rt(ps1::gte_t* gte) {
+        return get_matrix(gte, 0);
+    }
+
+    matrix_t get_llm(ps1::gte_t* gte) {
+        return get_matrix(gte, 8);
+    }
+
+    matrix_t get_lcm(ps1::gte_t* gte) {
+        return get_matrix(gte, 16);
+    }
+
+    // * TR at 5, BK at 13, FC at 21
+    void get_translation(ps1::gte_t* gte, uint32_t base, int32_t t[3]) {
+        t[0] = (int32_t)gte->ctrl[base];
+        t[1] = (int32_t)gte->ctrl[base + 1];
+        t[2] = (int32_t)gte->ctrl[base + 2];
+    }
+}
+
+namespace {
+    // * saturation and flag handling, shared by every command
+
+    // * overflow is flagged, value wraps to 44 bits as intermediate sums do on hardware
+    int64_t check_mac(ps1::gte_t* gte, uint32_t i, int64_t value) {
+        if (value > mac_max) raise(gte, flag_mac_pos[i]);
+        else if (value < mac_min) raise(gte, flag_mac_neg[i]);
+
+        return (value << 20) >> 20;
+    }
+
+    void check_mac0(ps1::gte_t* gte, int64_t value) {
+        if (value > INT32_MAX) raise(gte, flag_mac_pos[0]);
+        else if (value < INT32_MIN) raise(gte, flag_mac_neg[0]);
+    }
+
+    void set_mac(ps1::gte_t* gte, uint32_t i, int64_t value, uint32_t shift) {
+        if (i == 0) check_mac0(gte, value);
+        else check_mac(gte, i, value);
+
+        gte->data[24 + i] = (uint32_t)(value >> shift);
+    }
+
+    void set_ir(ps1::gte_t* gte, uint32_t i, int32_t value, bool lm) {
+        int32_t min = lm ? 0 : INT16_MIN;
+
+        if (value < min || value > INT16_MAX) {
+            raise(gte, flag_ir_sat[i]);
+
+            value = std::clamp<int32_t>(value, min, INT16_MAX);
+        }
+
+        gte->data[8 + i] = (uint32_t)value;
+    }
+
+    void set_ir0(ps1::gte_t* gte, int32_t value) {
+        if (value < 0 || value > 0x1000) {
+            raise(gte, flag_ir_sat[0]);
+
+            value = std::clamp<int32_t>(value, 0, 0x1000);
+        }
+
+        gte->data[8] = (uint32_t)value;
+    }
+
+    void set_mac_ir(ps1::gte_t* gte, uint32_t i, int64_t value, uint32_t shift, bool lm) {
+        set_mac(gte, i, value, shift);
+        set_ir(gte, i, get_mac(gte, i), lm);
+    }
+
+    void set_otz(ps1::gte_t* gte, int32_t value) {
+        if (value < 0 || value > 0xFFFF) {
+            raise(gte, flag_otz_sat);
+
+            value = std::clamp<int32_t>(value, 0, 0xFFFF);
+        }
+
+        gte->data[7] = (uint32_t)value;
+    }
+
+    void push_sz(ps1::gte_t* gte, int32_t value) {
+        if (value < 0 || value > 0xFFFF) {
+            raise(gte, flag_otz_sat);
+
+            value = std::clamp<int32_t>(value, 0, 0xFFFF);
+        }
+
+        gte->data[16] = gte->data[17];
+        gte->data[17] = gte->data[18];
+        gte->data[18] = gte->data[19];
+        gte->data[19] = (uint32_t)value;
+    }
+
+    void push_sxy(ps1::gte_t* gte, int32_t x, int32_t y) {
+        if (x < -0x400 || x > 0x3FF) {
+            raise(gte, flag_sx_sat);
+
+            x = std::clamp<int32_t>(x, -0x400, 0x3FF);
+        }
+
+        if (y < -0x400 || y > 0x3FF) {
+            raise(gte, flag_sy_sat);
+
+            y = std::clamp<int32_t>(y, -0x400, 0x3FF);
+        }
+
+        gte->data[12] = gte->data[13];
+        gte->data[13] = gte->data[14];
+        gte->data[14] = (uint16_t)x | ((uint32_t)(uint16_t)y << 16);
+    }
+
+    // * color fifo takes MAC SAR 4, code byte comes from RGBC
+    void push_rgb(ps1::gte_t* gte) {
+        uint32_t color = gte->data[6] & 0xFF000000;
+
+        for (uint32_t i = 0; i < 3; i++) {
+            int32_t value = get_mac(gte, i + 1) >> 4;
+
+            if (value < 0 || value > 0xFF) {
+                raise(gte, flag_color_sat[i]);
+
+                value = std::clamp<int32_t>(value, 0, 0xFF);
+            }
+
+            color |= (uint32_t)value << (i * 8);
+        }
+
+        gte->data[20] = gte->data[21];
+        gte->data[21] = gte->data[22];
+        gte->data[22] = color;
+    }
+
+    // * unr seed, reciprocal of 1.0 to 2.0 in 256 steps, stored minus 101h
+    constexpr std::array<uint8_t, 257> unr_table = [] {
+        std::array<uint8_t, 257> table {};
+
+        for (int32_t i = 0; i < 257; i++) {
+            table[i] = (uint8_t)std::max(0, (0x40000 / (i + 0x100) + 1) / 2 - 0x101);
+        }
+
+        return table;
+    }();
+
+    /*
+    * (h * 20000h / sz3 + 1) / 2 clamped to 1FFFFh, as hardware computes it
+    * divisor is normalized to 8000h..FFFFh, seed from table is refined by one newton-raphson step
+    * result differs from exact division in low bits, games rely on that
+    */
+    uint32_t divide(ps1::gte_t* gte, uint32_t h, uint32_t sz3) {
+        bool overflow = h >= sz3 * 2;
+
+        if (overflow) raise(gte, flag_div_overflow);
+
+        // * overflow path still runs on a valid divisor, result is discarded
+        uint32_t shift = std::countl_zero((uint16_t)(sz3 | 0x1)) & 0xF;
+
+        uint32_t n = h << shift;
+        uint32_t d = std::max<uint32_t>(sz3 << shift, 0x8000);
+        uint32_t u = unr_table[(d - 0x7FC0) >> 7] + 0x101;
+
+        d = (0x2000080 - d * u) >> 8;
+        d = (0x0000080 + d * u) >> 8;
+
+        uint32_t result = (uint32_t)std::min<uint64_t>(0x1FFFF, ((uint64_t)n * d + 0x8000) >> 16);
+
+        return overflow ? 0x1FFFF : result;
+    }
+}
+
+namespace {
+    // * arithmetic building blocks
+
+    /*
+    * M * V + T SHL 12
+    * rows are independent lanes, every partial sum wraps to 44 bits with its own overflow flags
+    * returns unshifted sums for callers that treat the result specially
+    */
+    void transform(ps1::gte_t* gte, const matrix_t& matrix, const int16_t v[3], const int32_t t[3], int64_t out[3]) {
+        int64_t acc[3];
+
+        for (uint32_t i = 0; i < 3; i++) {
+            acc[i] = ((int64_t)t[i] << 12) + (int64_t)matrix.m[i][0] * v[0];
+        }
+
+        for (uint32_t i = 0; i < 3; i++) {
+            acc[i] = check_mac(gte, i + 1, acc[i]) + (int64_t)matrix.m[i][1] * v[1];
+        }
+
+        for (uint32_t i = 0; i < 3; i++) {
+            out[i] = check_mac(gte, i + 1, acc[i]) + (int64_t)matrix.m[i][2] * v[2];
+        }
+    }
+
+    // * [MAC1-3] = [IR1-3] = (M * V + T SHL 12) SAR sf
+    void mul_mat_vec(ps1::gte_t* gte, const command_t& cmd, const matrix_t& matrix, const int16_t v[3], const int32_t t[3]) {
+        int64_t out[3];
+
+        transform(gte, matrix, v, t, out);
+
+        for (uint32_t i = 0; i < 3; i++) {
+            set_mac_ir(gte, i + 1, out[i], cmd.shift, cmd.lm);
+        }
+    }
+
+    /*
+    * mvmva with far color translation is broken on hardware
+    * first column with translation only updates flags, result is product of last two columns
+    */
+    void mul_mat_vec_fc(ps1::gte_t* gte, const command_t& cmd, const matrix_t& matrix, const int16_t v[3], const int32_t t[3]) {
+        for (uint32_t i = 0; i < 3; i++) {
+            int64_t first = check_mac(gte, i + 1, ((int64_t)t[i] << 12) + (int64_t)matrix.m[i][0] * v[0]);
+
+            set_ir(gte, i + 1, (int32_t)(first >> cmd.shift), false);
+
+            int64_t rest = check_mac(gte, i + 1, (int64_t)matrix.m[i][1] * v[1]) + (int64_t)matrix.m[i][2] * v[2];
+
+            set_mac_ir(gte, i + 1, rest, cmd.shift, cmd.lm);
+        }
+    }
+
+    /*
+    * [MAC1-3] = MAC + (FC - MAC) * IR0
+    * in values are MAC before interpolation, unshifted
+    */
+    void interpolate(ps1::gte_t* gte, const command_t& cmd, const int64_t in[3]) {
+        int32_t fc[3];
+        get_translation(gte, 21, fc);
+
+        for (uint32_t i = 0; i < 3; i++) {
+            set_mac_ir(gte, i + 1, ((int64_t)fc[i] << 12) - in[i], cmd.shift, false);
+        }
+
+        int16_t ir0 = get_ir(gte, 0);
+
+        for (uint32_t i = 0; i < 3; i++) {
+            set_mac_ir(gte, i + 1, (int64_t)get_ir(gte, i + 1) * ir0 + in[i], cmd.shift, cmd.lm);
+        }
+    }
+
+    // * [MAC1-3] = [R * IR1, G * IR2, B * IR3] SHL 4
+    void color_product(ps1::gte_t* gte, int64_t out[3]) {
+        for (uint32_t i = 0; i < 3; i++) {
+            out[i] = ((int64_t)get_rgbc(gte, i) * get_ir(gte, i + 1)) << 4;
+        }
+    }
+
+    // * [IR1-3] = (LLM * V) SAR sf, then (BK SHL 12 + LCM * IR) SAR sf
+    void light(ps1::gte_t* gte, const command_t& cmd, uint32_t vertex) {
+        const int32_t zero[3] = {};
+
+        int16_t v[3];
+        get_vector(gte, vertex, v);
+
+        mul_mat_vec(gte, cmd, get_llm(gte), v, zero);
+
+        int32_t bk[3];
+        get_translation(gte, 13, bk);
+        get_vector(gte, 3, v);
+
+        mul_mat_vec(gte, cmd, get_lcm(gte), v, bk);
+    }
+
+    // * [MAC1-3] = [IR1-3] = ([R * IR1, G * IR2, B * IR3] SHL 4) SAR sf
+    void apply_color(ps1::gte_t* gte, const command_t& cmd) {
+        int64_t product[3];
+        color_product(gte, product);
+
+        for (uint32_t i = 0; i < 3; i++) {
+            set_mac(gte, i + 1, product[i], 0);
+        }
+
+        for (uint32_t i = 0; i < 3; i++) {
+            set_mac_ir(gte, i + 1, get_mac(gte, i + 1), cmd.shift, cmd.lm);
+        }
+    }
+
+    /*
+    * perspective projection of transformed vertex
+    * SZ3 = MAC3 SAR ((1 - sf) * 12), SXY2 = (H / SZ3) * IR1-2 + OF, depth cue only for last vertex of command
+    */
+    void project(ps1::gte_t* gte, const command_t& cmd, const int64_t sums[3], bool last) {
+        for (uint32_t i = 0; i < 3; i++) {
+            set_mac(gte, i + 1, sums[i], cmd.shift);
+        }
+
+        set_ir(gte, 1, get_mac(gte, 1), cmd.lm);
+        set_ir(gte, 2, get_mac(gte, 2), cmd.lm);
+
+        // * with sf = 0 ir3 is saturated from MAC3 but flag is raised from MAC3 SAR 12
+        if (cmd.shift == 0) {
+            int32_t shifted = (int32_t)(sums[2] >> 12);
+
+            if (shifted < INT16_MIN || shifted > INT16_MAX) raise(gte, flag_ir_sat[3]);
+
+            gte->data[11] = (uint32_t)std::clamp<int32_t>(get_mac(gte, 3), cmd.lm ? 0 : INT16_MIN, INT16_MAX);
+        } else {
+            set_ir(gte, 3, get_mac(gte, 3), cmd.lm);
+        }
+
+        push_sz(gte, (int32_t)(sums[2] >> 12));
+
+        int64_t n = divide(gte, (uint16_t)gte->ctrl[26], get_sz(gte, 3));
+
+        int64_t x = n * get_ir(gte, 1) + (int32_t)gte->ctrl[24];
+        int64_t y = n * get_ir(gte, 2) + (int32_t)gte->ctrl[25];
+
+        check_mac0(gte, x);
+        check_mac0(gte, y);
+
+        push_sxy(gte, (int32_t)(x >> 16), (int32_t)(y >> 16));
+
+        if (!last) return;
+
+        int64_t depth = n * lo16(gte->ctrl[27]) + (int32_t)gte->ctrl[28];
+
+        set_mac(gte, 0, depth, 0);
+        set_ir0(gte, (int32_t)(depth >> 12));
+    }
+
+    /*
+    * transforms are done for every vertex first, they only share flags
+    * then projected in order so fifos are pushed same as on hardware
+    */
+    void rtp(ps1::gte_t* gte, const command_t& cmd, uint32_t first, uint32_t cnt) {
+        matrix_t rt = get_rt(gte);
+
+        int32_t tr[3];
+        get_translation(gte, 5, tr);
+
+        int64_t sums[3][3];
+
+        for (uint32_t i = 0; i < cnt; i++) {
+            int16_t v[3];
+            get_vector(gte, first + i, v);
+
+            transform(gte, rt, v, tr, sums[i]);
+        }
+
+        for (uint32_t i = 0; i < cnt; i++) {
+            project(gte, cmd, sums[i], i == cnt - 1);
+        }
+    }
+}
+
+namespace {
+    // * commands
+
+    typedef void (*op_fn_t)(ps1::gte_t*, const command_t&);
+
+    // * unused opcodes do nothing apart from clearing flag
+    void op_none(ps1::gte_t* gte, const command_t& cmd) {}
+
+    // * perspective transform single
+    void op_rtps(ps1::gte_t* gte, const command_t& cmd) {
+        rtp(gte, cmd, 0, 1);
+    }
+
+    // * perspective transform triple
+    void op_rtpt(ps1::gte_t* gte, const command_t& cmd) {
+        rtp(gte, cmd, 0, 3);
+    }
+
+    // * normal clipping, MAC0 = winding of screen triangle
+    void op_nclip(ps1::gte_t* gte, const command_t& cmd) {
+        int64_t sx0 = lo16(gte->data[12]), sy0 = hi16(gte->data[12]);
+        int64_t sx1 = lo16(gte->data[13]), sy1 = hi16(gte->data[13]);
+        int64_t sx2 = lo16(gte->data[14]), sy2 = hi16(gte->data[14]);
+
+        set_mac(gte, 0, sx0 * sy1 + sx1 * sy2 + sx2 * sy0 - sx0 * sy2 - sx1 * sy0 - sx2 * sy1, 0);
+    }
+
+    // * average of three z values for ordering table
+    void op_avsz3(ps1::gte_t* gte, const command_t& cmd) {
+        int64_t value = (int64_t)lo16(gte->ctrl[29]) * (int32_t)(get_sz(gte, 1) + get_sz(gte, 2) + get_sz(gte, 3));
+
+        set_mac(gte, 0, value, 0);
+        set_otz(gte, (int32_t)(value >> 12));
+    }
+
+    // * average of four z values for ordering table
+    void op_avsz4(ps1::gte_t* gte, const command_t& cmd) {
+        int64_t value = (int64_t)lo16(gte->ctrl[30]) * (int32_t)(get_sz(gte, 0) + get_sz(gte, 1) + get_sz(gte, 2) + get_sz(gte, 3));
+
+        set_mac(gte, 0, value, 0);
+        set_otz(gte, (int32_t)(value >> 12));
+    }
+
+    // * multiply matrix by vector and add translation, operands picked by command bits
+    void op_mvmva(ps1::gte_t* gte, const command_t& cmd) {
+        matrix_t matrix;
+
+        switch (cmd.mx) {
+            case 0: matrix = get_rt(gte); break;
+            case 1: matrix = get_llm(gte); break;
+            case 2: matrix = get_lcm(gte); break;
+            default: {
+                // * reserved matrix reads garbage from neighbouring registers
+                int16_t r = (int16_t)(get_rgbc(gte, 0) << 4);
+                matrix_t rt = get_rt(gte);
+
+                matrix.m[0][0] = -r;
+                matrix.m[0][1] = r;
+                matrix.m[0][2] = get_ir(gte, 0);
+                matrix.m[1][0] = matrix.m[1][1] = matrix.m[1][2] = rt.m[0][2];
+                matrix.m[2][0] = matrix.m[2][1] = matrix.m[2][2] = rt.m[1][1];
+            } break;
+        }
+
+        int16_t v[3];
+        get_vector(gte, cmd.vx, v);
+
+        int32_t t[3] = {};
+
+        switch (cmd.tx) {
+            case 0: get_translation(gte, 5, t); break;
+            case 1: get_translation(gte, 13, t); break;
+            case 2: {
+                get_translation(gte, 21, t);
+                mul_mat_vec_fc(gte, cmd, matrix, v, t);
+            } return;
+            default: break;
+        }
+
+        mul_mat_vec(gte, cmd, matrix, v, t);
+    }
+
+    // * square of ir vector
+    void op_sqr(ps1::gte_t* gte, const command_t& cmd) {
+        for (uint32_t i = 1; i < 4; i++) {
+            int64_t ir = get_ir(gte, i);
+
+            set_mac_ir(gte, i, ir * ir, cmd.shift, cmd.lm);
+        }
+    }
+
+    // * outer product of ir vector and rotation matrix diagonal
+    void op_op(ps1::gte_t* gte, const command_t& cmd) {
+        matrix_t rt = get_rt(gte);
+
+        int64_t d1 = rt.m[0][0], d2 = rt.m[1][1], d3 = rt.m[2][2];
+        int64_t ir1 = get_ir(gte, 1), ir2 = get_ir(gte, 2), ir3 = get_ir(gte, 3);
+
+        set_mac(gte, 1, ir3 * d2 - ir2 * d3, cmd.shift);
+        set_mac(gte, 2, ir1 * d3 - ir3 * d1, cmd.shift);
+        set_mac(gte, 3, ir2 * d1 - ir1 * d2, cmd.shift);
+
+        for (uint32_t i = 1; i < 4; i++) {
+            set_ir(gte, i, get_mac(gte, i), cmd.lm);
+        }
+    }
+
+    // * general purpose interpolation, MAC = IR * IR0
+    void op_gpf(ps1::gte_t* gte, const command_t& cmd) {
+        int64_t ir0 = get_ir(gte, 0);
+
+        for (uint32_t i = 1; i < 4; i++) {
+            set_mac_ir(gte, i, get_ir(gte, i) * ir0, cmd.shift, cmd.lm);
+        }
+
+        push_rgb(gte);
+    }
+
+    // * general purpose interpolation with base, MAC = MAC + IR * IR0
+    void op_gpl(ps1::gte_t* gte, const command_t& cmd) {
+        int64_t ir0 = get_ir(gte, 0);
+
+        for (uint32_t i = 1; i < 4; i++) {
+            set_mac_ir(gte, i, ((int64_t)get_mac(gte, i) << cmd.shift) + get_ir(gte, i) * ir0, cmd.shift, cmd.lm);
+        }
+
+        push_rgb(gte);
+    }
+
+    // * depth cue of color
+    void dpc(ps1::gte_t* gte, const command_t& cmd, uint32_t color) {
+        int64_t in[3];
+
+        for (uint32_t i = 0; i < 3; i++) {
+            in[i] = (int64_t)(uint8_t)(color >> (i * 8)) << 16;
+        }
+
+        interpolate(gte, cmd, in);
+        push_rgb(gte);
+    }
+
+    // * depth cue single, RGBC
+    void op_dpcs(ps1::gte_t* gte, const command_t& cmd) {
+        dpc(gte, cmd, gte->data[6]);
+    }
+
+    // * depth cue triple, each pass takes oldest entry of color fifo
+    void op_dpct(ps1::gte_t* gte, const command_t& cmd) {
+        for (uint32_t i = 0; i < 3; i++) {
+            dpc(gte, cmd, gte->data[20]);
+        }
+    }
+
+    // * interpolation of ir vector towards far color
+    void op_intpl(ps1::gte_t* gte, const command_t& cmd) {
+        int64_t in[3];
+
+        for (uint32_t i = 0; i < 3; i++) {
+            in[i] = (int64_t)get_ir(gte, i + 1) << 12;
+        }
+
+        interpolate(gte, cmd, in);
+        push_rgb(gte);
+    }
+
+    // * depth cue of RGBC modulated by ir vector
+    void op_dcpl(ps1::gte_t* gte, const command_t& cmd) {
+        int64_t in[3];
+        color_product(gte, in);
+
+        interpolate(gte, cmd, in);
+        push_rgb(gte);
+    }
+
+    // * normal color, vertex light only
+    void ncs(ps1::gte_t* gte, const command_t& cmd, uint32_t vertex) {
+        light(gte, cmd, vertex);
+        push_rgb(gte);
+    }
+
+    void op_ncs(ps1::gte_t* gte, const command_t& cmd) {
+        ncs(gte, cmd, 0);
+    }
+
+    void op_nct(ps1::gte_t* gte, const command_t& cmd) {
+        for (uint32_t i = 0; i < 3; i++) {
+            ncs(gte, cmd, i);
+        }
+    }
+
+    // * normal color, light modulated by RGBC
+    void nccs(ps1::gte_t* gte, const command_t& cmd, uint32_t vertex) {
+        light(gte, cmd, vertex);
+        apply_color(gte, cmd);
+        push_rgb(gte);
+    }
+
+    void op_nccs(ps1::gte_t* gte, const command_t& cmd) {
+        nccs(gte, cmd, 0);
+    }
+
+    void op_ncct(ps1::gte_t* gte, const command_t& cmd) {
+        for (uint32_t i = 0; i < 3; i++) {
+            nccs(gte, cmd, i);
+        }
+    }
+
+    // * normal color, light modulated by RGBC and depth cued
+    void ncds(ps1::gte_t* gte, const command_t& cmd, uint32_t vertex) {
+        light(gte, cmd, vertex);
+
+        int64_t in[3];
+        color_product(gte, in);
+
+        interpolate(gte, cmd, in);
+        push_rgb(gte);
+    }
+
+    void op_ncds(ps1::gte_t* gte, const command_t& cmd) {
+        ncds(gte, cmd, 0);
+    }
+
+    void op_ncdt(ps1::gte_t* gte, const command_t& cmd) {
+        for (uint32_t i = 0; i < 3; i++) {
+            ncds(gte, cmd, i);
+        }
+    }
+
+    // * light color of ir vector, BK SHL 12 + LCM * IR
+    void lcm_ir(ps1::gte_t* gte, const command_t& cmd) {
+        int16_t v[3];
+        get_vector(gte, 3, v);
+
+        int32_t bk[3];
+        get_translation(gte, 13, bk);
+
+        mul_mat_vec(gte, cmd, get_lcm(gte), v, bk);
+    }
+
+    // * color color
+    void op_cc(ps1::gte_t* gte, const command_t& cmd) {
+        lcm_ir(gte, cmd);
+        apply_color(gte, cmd);
+        push_rgb(gte);
+    }
+
+    // * color depth cue
+    void op_cdp(ps1::gte_t* gte, const command_t& cmd) {
+        lcm_ir(gte, cmd);
+
+        int64_t in[3];
+        color_product(gte, in);
+
+        interpolate(gte, cmd, in);
+        push_rgb(gte);
+    }
+
+    constexpr std::array<op_fn_t, 64> op_table = [] {
+        std::array<op_fn_t, 64> table {};
+
+        table.fill(op_none);
+
+        table[0x01] = op_rtps;
+        table[0x06] = op_nclip;
+        table[0x0C] = op_op;
+        table[0x10] = op_dpcs;
+        table[0x11] = op_intpl;
+        table[0x12] = op_mvmva;
+        table[0x13] = op_ncds;
+        table[0x14] = op_cdp;
+        table[0x16] = op_ncdt;
+        table[0x1B] = op_nccs;
+        table[0x1C] = op_cc;
+        table[0x1E] = op_ncs;
+        table[0x20] = op_nct;
+        table[0x28] = op_sqr;
+        table[0x29] = op_dcpl;
+        table[0x2A] = op_dpct;
+        table[0x2D] = op_avsz3;
+        table[0x2E] = op_avsz4;
+        table[0x30] = op_rtpt;
+        table[0x3D] = op_gpf;
+        table[0x3E] = op_gpl;
+        table[0x3F] = op_ncct;
+
+        return table;
+    }();
+
+    // * IR1-3 SAR 7 saturated to 5 bits each
+    uint32_t get_orgb(ps1::gte_t* gte) {
+        uint32_t color = 0;
+
+        for (uint32_t i = 0; i < 3; i++) {
+            color |= (uint32_t)std::clamp(get_ir(gte, i + 1) >> 7, 0, 0x1F) << (i * 5);
+        }
+
+        return color;
+    }
+
+    // * number of leading bits equal to sign bit
+    uint32_t count_leading_sign(uint32_t value) {
+        return std::countl_zero((int32_t)value < 0 ? ~value : value);
+    }
+}
+
+void ps1::gte_init(gte_t* gte) {
+    memset(gte->data, 0, sizeof(gte->data));
+    memset(gte->ctrl, 0, sizeof(gte->ctrl));
+
+    gte->data[31] = count_leading_sign(0);
+}
+
+uint32_t ps1::gte_read_data(gte_t* gte, uint32_t i) {
+    switch (i) {
+        case 1: case 3: case 5: case 8: case 9: case 10: case 11:
+            return (uint32_t)(int32_t)lo16(gte->data[i]);
+        case 7: case 16: case 17: case 18: case 19:
+            return (uint16_t)gte->data[i];
+        case 15:
+            return gte->data[14];
+        case 28: case 29:
+            return get_orgb(gte);
+        default:
+            return gte->data[i];
+    }
+}
+
+void ps1::gte_write_data(gte_t* gte, uint32_t i, uint32_t value) {
+    switch (i) {
+        case 15: {
+            gte->data[12] = gte->data[13];
+            gte->data[13] = gte->data[14];
+            gte->data[14] = value;
+        } break;
+        case 28: {
+            gte->data[28] = value & 0x7FFF;
+
+            for (uint32_t c = 0; c < 3; c++) {
+                gte->data[9 + c] = ((value >> (c * 5)) & 0x1F) << 7;
+            }
+        } break;
+        case 29: case 31:
+            break;
+        case 30: {
+            gte->data[30] = value;
+            gte->data[31] = count_leading_sign(value);
+        } break;
+        default:
+            gte->data[i] = value;
+    }
+}
+
+uint32_t ps1::gte_read_ctrl(gte_t* gte, uint32_t i) {
+    switch (i) {
+        // * H is unsigned but reads back sign extended on hardware
+        case 4: case 12: case 20: case 26: case 27: case 29: case 30:
+            return (uint32_t)(int32_t)lo16(gte->ctrl[i]);
+        default:
+            return gte->ctrl[i];
+    }
+}
+
+void ps1::gte_write_ctrl(gte_t* gte, uint32_t i, uint32_t value) {
+    if (i == reg_flag) {
+        value &= flag_writable_mask;
+
+        if (value & flag_error_mask) value |= flag_error;
+    }
+
+    gte->ctrl[i] = value;
+}
+
+void ps1::gte_execute(gte_t* gte, uint32_t instr) {
+    command_t cmd;
+    cmd.shift = (instr & (1 << 19)) ? 12 : 0;
+    cmd.lm = instr & (1 << 10);
+    cmd.mx = (instr >> 17) & 0x3;
+    cmd.vx = (instr >> 15) & 0x3;
+    cmd.tx = (instr >> 13) & 0x3;
+
+    gte->ctrl[reg_flag] = 0;
+
+    op_table[instr & 0x3F](gte, cmd);
+
+    if (gte->ctrl[reg_flag] & flag_error_mask) raise(gte, flag_error);
+}
+
+void ps1::gte_save_state(gte_t* gte, serializer_t* serializer) {
+    serializer_write(serializer, gte->data, sizeof(gte->data));
+    serializer_write(serializer, gte->ctrl, sizeof(gte->ctrl));
+}
+
+void ps1::gte_load_state(gte_t* gte, serializer_t* serializer) {
+    serializer_read(serializer, gte->data, sizeof(gte->data));
+    serializer_read(serializer, gte->ctrl, sizeof(gte->ctrl));
+}
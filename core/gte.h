@@ -0,0 +1,50 @@
+#pragma once
+
+#include "defs.h"
+
+namespace ps1 {
+    /*
+    * geometry transformation engine, cop2
+    * fixed point vector unit for perspective transform, lighting and depth cueing
+    *
+    * registers are kept in raw form as seen by mfc2/cfc2, commands unpack what they need
+    *
+    * data reg 0-5 V0, V1, V2 (xy, z pairs)
+    * data reg 6 RGBC
+    * data reg 7 OTZ
+    * data reg 8-11 IR0-IR3
+    * data reg 12-15 SXY fifo, 15 pushes on write
+    * data reg 16-19 SZ fifo
+    * data reg 20-22 RGB fifo
+    * data reg 24-27 MAC0-MAC3
+    * data reg 28-29 IRGB/ORGB 5:5:5 color conversion
+    * data reg 30-31 LZCS/LZCR leading sign bit count
+    *
+    * ctrl reg 0-4 RT rotation matrix, 5-7 TR translation
+    * ctrl reg 8-12 LLM light matrix, 13-15 BK background color
+    * ctrl reg 16-20 LCM light color matrix, 21-23 FC far color
+    * ctrl reg 24-25 OFX/OFY screen offset, 26 H projection plane distance
+    * ctrl reg 27-28 DQA/DQB depth cue, 29-30 ZSF3/ZSF4 average z scale
+    * ctrl reg 31 FLAG
+    */
+    struct gte_t {
+        uint32_t data[32];
+        uint32_t ctrl[32];
+    };
+
+    void gte_init(gte_t*);
+
+    // * mfc2/mtc2/lwc2/swc2
+    uint32_t gte_read_data(gte_t*, uint32_t);
+    void gte_write_data(gte_t*, uint32_t, uint32_t);
+
+    // * cfc2/ctc2
+    uint32_t gte_read_ctrl(gte_t*, uint32_t);
+    void gte_write_ctrl(gte_t*, uint32_t, uint32_t);
+
+    // * run command from lower 25 bits of cop2 instruction
+    void gte_execute(gte_t*, uint32_t);
+
+    void gte_save_state(gte_t*, serializer_t*);
+    void gte_load_state(gte_t*, serializer_t*);
+}
@@ -0,0 +1,472 @@
+#include "hle.h"
+#include "cpu.h"
+#include "ram.h"
+#include "peripheral.h"
+#include "logger.h"
+
+namespace {
+    constexpr uint32_t reg_v0 = 2;
+    constexpr uint32_t reg_a0 = 4;
+    constexpr uint32_t reg_t1 = 9;
+    constexpr uint32_t reg_sp = 29;
+    constexpr uint32_t reg_ra = 31;
+
+    // * load issued in delay slot of call jump has not landed yet
+    uint32_t get(ps1::cpu_t* cpu, uint32_t i) {
+        if (i != 0 && cpu->load_delay_target == i) return cpu->load_delay_value;
+
+        return cpu->in_regs[i];
+    }
+
+    uint32_t arg(ps1::cpu_t* cpu, uint32_t i) {
+        return get(cpu, reg_a0 + i);
+    }
+
+    // * null unless whole range is in ram. mirrors are left to bios
+    uint8_t* ram_ptr(ps1::hle_t* hle, ps1::mem_addr_t addr, uint32_t size) {
+        ps1::mem_addr_t offset = ps1::mask_addr(addr) - ps1::RAM_ADDR;
+
+        if (offset >= ps1::RAM_SIZE || size > ps1::RAM_SIZE - offset) return nullptr;
+
+        return hle->ram->data + offset;
+    }
+
+    // * null unless string is terminated inside ram
+    const char* ram_str(ps1::hle_t* hle, ps1::mem_addr_t addr, uint32_t* length) {
+        uint8_t* str = ram_ptr(hle, addr, 1);
+
+        if (!str) return nullptr;
+
+        size_t limit = ps1::RAM_SIZE - (str - hle->ram->data);
+        uint8_t* end = (uint8_t*)memchr(str, 0, limit);
+
+        if (!end) return nullptr;
+
+        *length = end - str;
+
+        return (const char*)str;
+    }
+
+    bool overlaps(ps1::mem_addr_t a, ps1::mem_addr_t b, uint32_t size) {
+        ps1::mem_addr_t pa = ps1::mask_addr(a);
+        ps1::mem_addr_t pb = ps1::mask_addr(b);
+
+        return pa < pb + size && pb < pa + size;
+    }
+
+    void tty_put(ps1::hle_t* hle, char c) {
+        if (!hle->output_enabled) return;
+
+        if (c == '\n') {
+            ps1::logger::push(hle->tty_line, ps1::logger::type_t::message, "tty");
+            hle->tty_line.clear();
+
+            return;
+        }
+
+        hle->tty_line.push_back(c);
+    }
+
+    // * bios returns 0 on null pointers and non positive sizes, those calls are left to it
+    bool hle_memcpy(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t dst = arg(cpu, 0);
+        ps1::mem_addr_t src = arg(cpu, 1);
+        int32_t size = arg(cpu, 2);
+
+        if (!dst || !src || size <= 0 || overlaps(dst, src, size)) return false;
+
+        uint8_t* dst_ptr = ram_ptr(hle, dst, size);
+        uint8_t* src_ptr = ram_ptr(hle, src, size);
+
+        if (!dst_ptr || !src_ptr) return false;
+
+        memcpy(dst_ptr, src_ptr, size);
+        *result = dst;
+
+        return true;
+    }
+
+    bool hle_memset(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t dst = arg(cpu, 0);
+        uint8_t fill = arg(cpu, 1);
+        int32_t size = arg(cpu, 2);
+
+        if (!dst || size <= 0) return false;
+
+        uint8_t* dst_ptr = ram_ptr(hle, dst, size);
+
+        if (!dst_ptr) return false;
+
+        memset(dst_ptr, fill, size);
+        *result = dst;
+
+        return true;
+    }
+
+    bool hle_bzero(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t dst = arg(cpu, 0);
+        int32_t size = arg(cpu, 1);
+
+        if (!dst || size <= 0) return false;
+
+        uint8_t* dst_ptr = ram_ptr(hle, dst, size);
+
+        if (!dst_ptr) return false;
+
+        memset(dst_ptr, 0, size);
+        *result = dst;
+
+        return true;
+    }
+
+    bool hle_memcmp(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t a = arg(cpu, 0);
+        ps1::mem_addr_t b = arg(cpu, 1);
+        int32_t size = arg(cpu, 2);
+
+        if (!a || !b || size <= 0) return false;
+
+        uint8_t* a_ptr = ram_ptr(hle, a, size);
+        uint8_t* b_ptr = ram_ptr(hle, b, size);
+
+        if (!a_ptr || !b_ptr) return false;
+
+        // * bios returns difference of first mismatching bytes
+        int32_t diff = 0;
+
+        for (int32_t i = 0; i < size && !diff; i++) {
+            diff = (int32_t)a_ptr[i] - (int32_t)b_ptr[i];
+        }
+
+        *result = diff;
+
+        return true;
+    }
+
+    bool hle_strlen(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t str = arg(cpu, 0);
+        uint32_t length;
+
+        if (!str || !ram_str(hle, str, &length)) return false;
+
+        *result = length;
+
+        return true;
+    }
+
+    bool hle_strcmp(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t a = arg(cpu, 0);
+        ps1::mem_addr_t b = arg(cpu, 1);
+        uint32_t a_length, b_length;
+
+        if (!a || !b) return false;
+
+        const uint8_t* a_str = (const uint8_t*)ram_str(hle, a, &a_length);
+        const uint8_t* b_str = (const uint8_t*)ram_str(hle, b, &b_length);
+
+        if (!a_str || !b_str) return false;
+
+        uint32_t i = 0;
+
+        while (a_str[i] && a_str[i] == b_str[i]) {
+            i++;
+        }
+
+        *result = (int32_t)a_str[i] - (int32_t)b_str[i];
+
+        return true;
+    }
+
+    bool hle_strncmp(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t a = arg(cpu, 0);
+        ps1::mem_addr_t b = arg(cpu, 1);
+        int32_t size = arg(cpu, 2);
+        uint32_t a_length, b_length;
+
+        if (!a || !b || size <= 0) return false;
+
+        const uint8_t* a_str = (const uint8_t*)ram_str(hle, a, &a_length);
+        const uint8_t* b_str = (const uint8_t*)ram_str(hle, b, &b_length);
+
+        if (!a_str || !b_str) return false;
+
+        int32_t diff = 0;
+
+        for (int32_t i = 0; i < size && !diff; i++) {
+            diff = (int32_t)a_str[i] - (int32_t)b_str[i];
+
+            if (!a_str[i]) break;
+        }
+
+        *result = diff;
+
+        return true;
+    }
+
+    bool hle_strcpy(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t dst = arg(cpu, 0);
+        ps1::mem_addr_t src = arg(cpu, 1);
+        uint32_t length;
+
+        if (!dst || !src) return false;
+
+        const char* src_str = ram_str(hle, src, &length);
+
+        if (!src_str || overlaps(dst, src, length + 1)) return false;
+
+        uint8_t* dst_ptr = ram_ptr(hle, dst, length + 1);
+
+        if (!dst_ptr) return false;
+
+        memcpy(dst_ptr, src_str, length + 1);
+        *result = dst;
+
+        return true;
+    }
+
+    bool hle_strcat(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t dst = arg(cpu, 0);
+        ps1::mem_addr_t src = arg(cpu, 1);
+        uint32_t dst_length, src_length;
+
+        if (!dst || !src) return false;
+
+        const char* dst_str = ram_str(hle, dst, &dst_length);
+        const char* src_str = ram_str(hle, src, &src_length);
+
+        if (!dst_str || !src_str || overlaps(dst + dst_length, src, src_length + 1)) return false;
+
+        uint8_t* tail = ram_ptr(hle, dst + dst_length, src_length + 1);
+
+        if (!tail) return false;
+
+        memcpy(tail, src_str, src_length + 1);
+        *result = dst;
+
+        return true;
+    }
+
+    bool hle_putchar(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        char c = arg(cpu, 0);
+
+        tty_put(hle, c);
+        *result = (uint8_t)c;
+
+        return true;
+    }
+
+    bool hle_puts(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t str = arg(cpu, 0);
+        uint32_t length;
+
+        const char* str_ptr = str ? ram_str(hle, str, &length) : nullptr;
+
+        if (!str_ptr) return false;
+
+        for (uint32_t i = 0; i < length; i++) {
+            tty_put(hle, str_ptr[i]);
+        }
+
+        *result = length;
+
+        return true;
+    }
+
+    /*
+    * arguments after format string come from $a1-$a3, then stack above home area of $a0-$a3
+    * supports flags, width, precision and d i u x X o c s p conversions
+    */
+    bool hle_printf(ps1::hle_t* hle, ps1::cpu_t* cpu, uint32_t* result) {
+        ps1::mem_addr_t format = arg(cpu, 0);
+        uint32_t length;
+
+        const char* fmt = format ? ram_str(hle, format, &length) : nullptr;
+
+        if (!fmt) return false;
+
+        ps1::mem_addr_t sp = get(cpu, reg_sp);
+        uint32_t arg_index = 1;
+
+        auto next_arg = [&](uint32_t* value) {
+            if (arg_index < 4) {
+                *value = arg(cpu, arg_index++);
+
+                return true;
+            }
+
+            uint8_t* slot = ram_ptr(hle, sp + arg_index++ * sizeof(uint32_t), sizeof(uint32_t));
+
+            if (!slot) return false;
+
+            memcpy(value, slot, sizeof(uint32_t));
+
+            return true;
+        };
+
+        str_t out;
+
+        for (uint32_t i = 0; i < length; i++) {
+            if (fmt[i] != '%') {
+                out.push_back(fmt[i]);
+
+                continue;
+            }
+
+            // * rebuild conversion spec for host snprintf, length modifiers are dropped since every argument is a word
+            str_t spec = "%";
+
+            for (i++; i < length && strchr("-+ #0", fmt[i]); i++) spec.push_back(fmt[i]);
+            for (; i < length && ((fmt[i] >= '0' && fmt[i] <= '9') || fmt[i] == '.'); i++) spec.push_back(fmt[i]);
+            for (; i < length && strchr("hlL", fmt[i]); i++);
+
+            if (i >= length) break;
+
+            char conversion = fmt[i];
+            char buffer[256];
+            uint32_t value = 0;
+
+            switch (conversion) {
+                case '%': {
+                    out.push_back('%');
+
+                    continue;
+                }
+
+                case 'd':
+                case 'i': {
+                    if (!next_arg(&value)) return false;
+                    snprintf(buffer, sizeof(buffer), (spec + "d").c_str(), (int32_t)value);
+
+                    break;
+                }
+
+                case 'u':
+                case 'x':
+                case 'X':
+                case 'o':
+                case 'c': {
+                    if (!next_arg(&value)) return false;
+                    snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), value);
+
+                    break;
+                }
+
+                case 'p': {
+                    if (!next_arg(&value)) return false;
+                    snprintf(buffer, sizeof(buffer), (spec + "x").c_str(), value);
+
+                    break;
+                }
+
+                case 's': {
+                    uint32_t str_length;
+
+                    if (!next_arg(&value)) return false;
+
+                    const char* str = value ? ram_str(hle, value, &str_length) : "<NULL>";
+
+                    if (!str) return false;
+
+                    snprintf(buffer, sizeof(buffer), (spec + "s").c_str(), str);
+
+                    break;
+                }
+
+                default: {
+                    // * unknown conversion is printed as is
+                    out += spec;
+                    out.push_back(conversion);
+
+                    continue;
+                }
+            }
+
+            out += buffer;
+        }
+
+        for (char c : out) {
+            tty_put(hle, c);
+        }
+
+        *result = out.size();
+
+        return true;
+    }
+}
+
+void ps1::hle_init(hle_t* hle, ram_t* ram) {
+    hle->ram = ram;
+    hle->enabled = false;
+    hle->call_cnt = 0;
+    hle->output_enabled = true;
+    hle->tty_line.clear();
+    hle->fns.clear();
+
+    // * function numbers as listed in nocash psx-spx bios chapter
+    hle_register(hle, HLE_VECTOR_A0, 0x15, hle_strcat);
+    hle_register(hle, HLE_VECTOR_A0, 0x17, hle_strcmp);
+    hle_register(hle, HLE_VECTOR_A0, 0x18, hle_strncmp);
+    hle_register(hle, HLE_VECTOR_A0, 0x19, hle_strcpy);
+    hle_register(hle, HLE_VECTOR_A0, 0x1B, hle_strlen);
+    hle_register(hle, HLE_VECTOR_A0, 0x28, hle_bzero);
+    hle_register(hle, HLE_VECTOR_A0, 0x2A, hle_memcpy);
+    hle_register(hle, HLE_VECTOR_A0, 0x2B, hle_memset);
+    hle_register(hle, HLE_VECTOR_A0, 0x2D, hle_memcmp);
+    hle_register(hle, HLE_VECTOR_A0, 0x3C, hle_putchar);
+    hle_register(hle, HLE_VECTOR_A0, 0x3E, hle_puts);
+    hle_register(hle, HLE_VECTOR_A0, 0x3F, hle_printf);
+
+    hle_register(hle, HLE_VECTOR_B0, 0x3D, hle_putchar);
+    hle_register(hle, HLE_VECTOR_B0, 0x3F, hle_puts);
+}
+
+void ps1::hle_exit(hle_t* hle) {
+    hle->fns.clear();
+}
+
+void ps1::hle_register(hle_t* hle, uint32_t vector, uint32_t fn, hle_fn_t hle_fn) {
+    hle->fns[(vector << 8) | (fn & 0xff)] = hle_fn;
+}
+
+void ps1::hle_set_enabled(hle_t* hle, cpu_t* cpu, bool enabled) {
+    if (hle->enabled == enabled) return;
+
+    hle->enabled = enabled;
+
+    constexpr uint32_t vectors[] = { HLE_VECTOR_A0, HLE_VECTOR_B0, HLE_VECTOR_C0 };
+
+    for (uint32_t i = 0; i < 3; i++) {
+        if (enabled) {
+            hle->hook_ids[i] = cpu_add_hook(cpu, vectors[i], [hle](cpu_t* cpu) { return hle_call(hle, cpu); });
+        } else {
+            cpu_remove_hook(cpu, hle->hook_ids[i]);
+        }
+    }
+}
+
+void ps1::hle_set_output_enabled(hle_t* hle, bool enabled) {
+    hle->output_enabled = enabled;
+}
+
+bool ps1::hle_call(hle_t* hle, cpu_t* cpu) {
+    uint32_t vector = mask_addr(cpu->pc);
+    uint32_t fn = get(cpu, reg_t1);
+
+    if (vector != HLE_VECTOR_A0 && vector != HLE_VECTOR_B0 && vector != HLE_VECTOR_C0) return false;
+    if (fn > 0xff) return false;
+
+    auto it = hle->fns.find((vector << 8) | fn);
+
+    if (it == hle->fns.end()) return false;
+
+    uint32_t result;
+
+    if (!it->second(hle, cpu, &result)) return false;
+
+    if (hle->output_enabled) hle->call_cnt++;
+
+    cpu_jump(cpu, get(cpu, reg_ra));
+    cpu_set_reg(cpu, reg_v0, result);
+
+    return true;
+}
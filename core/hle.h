@@ -0,0 +1,49 @@
+#pragma once
+
+#include "defs.h"
+
+namespace ps1 {
+    constexpr uint32_t HLE_VECTOR_A0 = 0xA0;
+    constexpr uint32_t HLE_VECTOR_B0 = 0xB0;
+    constexpr uint32_t HLE_VECTOR_C0 = 0xC0;
+
+    // * writes $v0 result. returns false to let bios run its own code, used for arguments with quirky bios behaviour
+    typedef bool (*hle_fn_t)(hle_t*, cpu_t*, uint32_t*);
+
+    /*
+    * high level emulation of bios kernel calls
+    * guest jumps to 0xA0, 0xB0 or 0xC0 with function number in $t1
+    * serviced calls run natively against ram, put result in $v0 and return to $ra
+    * anything that touches memory outside of ram falls back to bios code
+    */
+    struct hle_t {
+        ram_t* ram;
+
+        bool enabled; // * off by default, bios code is the reference
+
+        umap_t<uint32_t, hle_fn_t> fns; // * vector << 8 | function number
+
+        str_t tty_line; // * console output, pushed to log line by line
+
+        uint64_t call_cnt; // * serviced calls
+
+        bool output_enabled; // * tty output and call count are held back, for frames that are emulated twice
+
+        uint32_t hook_ids[3]; // * cpu hooks on call vectors while enabled
+    };
+
+    // * fills table with built-in functions
+    void hle_init(hle_t*, ram_t*);
+    void hle_exit(hle_t*);
+
+    void hle_register(hle_t*, uint32_t, uint32_t, hle_fn_t);
+
+    // * hooks call vectors of cpu. does nothing if already in requested state
+    void hle_set_enabled(hle_t*, cpu_t*, bool);
+
+    // * serviced calls still run, only effects outside console state are suppressed
+    void hle_set_output_enabled(hle_t*, bool);
+
+    // * called with pc on call vector. true if call was serviced and cpu now returns to caller
+    bool hle_call(hle_t*, cpu_t*);
+}
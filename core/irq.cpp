@@ -0,0 +1,27 @@
+#include "irq.h"
+#include "serializer.h"
+
+void ps1::irq_init(irq_t* irq) {
+    irq->stat = 0;
+    irq->mask = 0;
+}
+
+void ps1::irq_exit(irq_t* irq) {}
+
+void ps1::irq_save_state(irq_t* irq, serializer_t* serializer) {
+    serializer_write32(serializer, irq->stat);
+    serializer_write32(serializer, irq->mask);
+}
+
+void ps1::irq_load_state(irq_t* irq, serializer_t* serializer) {
+    irq->stat = serializer_read32(serializer);
+    irq->mask = serializer_read32(serializer);
+}
+
+void ps1::irq_request(irq_t* irq, irq_line_t line) {
+    irq->stat |= 1 << (uint32_t)line;
+}
+
+bool ps1::irq_is_pending(irq_t* irq) {
+    return irq->stat & irq->mask;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "defs.h"
+#include "peripheral.h"
+
+namespace ps1 {
+    // * I_STAT/I_MASK bits
+    enum struct irq_line_t : uint32_t {
+        vblank = 0,
+        gpu = 1,
+        cdrom = 2,
+        dma = 3,
+        timer0 = 4,
+        timer1 = 5,
+        timer2 = 6,
+        pad = 7,
+        sio = 8,
+        spu = 9,
+        lightpen = 10,
+    };
+
+    /*
+    * interrupt controller
+    * devices raise lines in stat, cpu sees cop0 cause bit 10 while any raised line is unmasked
+    */
+    struct irq_t {
+        uint32_t stat; // * +0x0, writing acknowledges lines written as zero
+        uint32_t mask; // * +0x4
+    };
+
+    void irq_init(irq_t*);
+    void irq_exit(irq_t*);
+
+    void irq_save_state(irq_t*, serializer_t*);
+    void irq_load_state(irq_t*, serializer_t*);
+
+    void irq_request(irq_t*, irq_line_t);
+
+    // * cpu interrupt input
+    bool irq_is_pending(irq_t*);
+
+    FETCH_FN(irq_t) fetch(void* device, mem_addr_t offset) {
+        irq_t* irq = (irq_t*)device;
+
+        if (offset == 0) {
+            return irq->stat;
+        } else if (offset == 4) {
+            return irq->mask;
+        }
+
+        ASSERT(false, "unhandled irq fetch");
+
+        return 0;
+    }
+
+    STORE_FN(irq_t) store(void* device, mem_addr_t offset, type_t value) {
+        irq_t* irq = (irq_t*)device;
+
+        if (offset == 0) {
+            irq->stat &= value;
+        } else if (offset == 4) {
+            irq->mask = value & 0x7FF;
+        } else {
+            ASSERT(false, "unhandled irq store");
+        }
+    }
+}
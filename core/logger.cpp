@@ -1,5 +1,7 @@
 #include "logger.h"
 
+#include <mutex>
+
 namespace {
     auto channels = dyn_arr_t <str_t> ();
     auto logs = dyn_arr_t <dyn_arr_t <pair_t <str_t, ps1::logger::type_t>>> ();
@@ -16,6 +18,9 @@ namespace {
     uint32_t spam_count = 0;
     constexpr uint32_t spam_max = 100;
 
+    std::mutex log_mutex; // * logs are pushed from emulation thread and displayed on ui thread
+
+#if !defined(PS1_HEADLESS)
     uint32_t get_type_color(ps1::logger::type_t type) {
         return
             type == ps1::logger::type_t::error ? IM_COL32(211, 47, 47, 255) :
@@ -26,9 +31,12 @@ namespace {
 
     bool filter[4] = { 1, 1, 1, 1 };
     char search_buffer[256]  = { 0 };
+#endif
 }
 
 void ps1::logger::push(const str_t& msg, type_t type, const str_t& channel) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+
     uint32_t ind = -1;
 
     for (uint32_t i = 0 ; i < channels.size(); i++) {
@@ -50,6 +58,8 @@ void ps1::logger::push(const str_t& msg, type_t type, const str_t& channel) {
 }
 
 void ps1::logger::spam(const str_t& msg) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+
     spam_item* item = new spam_item { std::move(msg), nullptr, nullptr };
     
     spam_count++;
@@ -73,7 +83,10 @@ void ps1::logger::spam(const str_t& msg) {
     }
 }
 
+#if !defined(PS1_HEADLESS)
 void ps1::logger::display() {
+    std::lock_guard<std::mutex> lock(log_mutex);
+
     ImGui::Begin("Debug Log");
         ImGui::PushStyleColor(ImGuiCol_Text, ::get_type_color(type_t::message));
         ImGui::Checkbox("message", filter);
@@ -216,4 +229,5 @@ void ps1::logger::display() {
 
         ImGui::EndTabBar();
     ImGui::End();
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
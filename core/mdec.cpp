@@ -0,0 +1,497 @@
+#include "mdec.h"
+#include "dma.h"
+#include "ram.h"
+#include "pool.h"
+#include "serializer.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint16_t end_of_block = 0xFE00; // * also used as padding between blocks
+
+    // * coefficients arrive in zigzag order, this gives their row major position
+    constexpr uint8_t zigzag_to_row[64] = {
+        0, 1, 8, 16, 9, 2, 3, 10,
+        17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34,
+        27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36,
+        29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46,
+        53, 60, 61, 54, 47, 55, 62, 63,
+    };
+
+    // * command numbers, bits [29:31]
+    constexpr uint32_t command_decode = 1;
+    constexpr uint32_t command_quant = 2;
+    constexpr uint32_t command_scale = 3;
+
+    constexpr uint32_t control_reset = 1u << 31;
+    constexpr uint32_t control_in_request = 1u << 30;
+    constexpr uint32_t control_out_request = 1u << 29;
+
+    // * largest output one decode command can produce, 64 bytes per input halfword for color macroblocks
+    constexpr size_t max_input_size = 0xFFFF * 2;
+    constexpr size_t max_output_size = max_input_size * 64;
+
+    ps1::mdec_depth_t get_depth(uint32_t command) {
+        return (ps1::mdec_depth_t)((command >> 27) & 0x3);
+    }
+
+    bool is_color(ps1::mdec_depth_t depth) {
+        return depth == ps1::mdec_depth_t::rgb24 || depth == ps1::mdec_depth_t::rgb15;
+    }
+
+    // * bytes per macroblock, 16x16 pixels for color and 8x8 for mono
+    uint32_t macroblock_size(ps1::mdec_depth_t depth) {
+        switch (depth) {
+            case ps1::mdec_depth_t::mono4: return 8 * 8 / 2;
+            case ps1::mdec_depth_t::mono8: return 8 * 8;
+            case ps1::mdec_depth_t::rgb24: return 16 * 16 * 3;
+            case ps1::mdec_depth_t::rgb15: return 16 * 16 * 2;
+        }
+
+        return 0;
+    }
+
+    int32_t signed10(uint32_t code) {
+        return (int32_t)(code << 22) >> 22;
+    }
+
+    int32_t clamp(int32_t value, int32_t min, int32_t max) {
+        return value < min ? min : (value > max ? max : value);
+    }
+
+    /*
+    * one dimension for every row, written transposed so running it twice transforms both dimensions
+    * inner loop is eight independent lanes, compiler turns it into simd of whatever width target allows
+    */
+    void idct_pass(const int32_t* in, int32_t* out, const int16_t* scale) {
+        for (uint32_t row = 0; row < 8; row++) {
+            int32_t sum[8] = {};
+
+            for (uint32_t u = 0; u < 8; u++) {
+                int32_t coeff = in[row * 8 + u];
+
+                // * most high frequencies are zero
+                if (coeff == 0) continue;
+
+                for (uint32_t x = 0; x < 8; x++) {
+                    sum[x] += coeff * scale[u * 8 + x];
+                }
+            }
+
+            for (uint32_t x = 0; x < 8; x++) {
+                out[x * 8 + row] = (sum[x] + 0x8000) >> 16;
+            }
+        }
+    }
+
+    void idct(int32_t* block, const int16_t* scale) {
+        int32_t transposed[64];
+
+        idct_pass(block, transposed, scale);
+        idct_pass(transposed, block, scale);
+
+        // * hardware keeps 9 bits of result
+        for (uint32_t i = 0; i < 64; i++) {
+            block[i] = (int32_t)((uint32_t)block[i] << 23) >> 23;
+        }
+    }
+
+    // * run length decode and dequantize one block, position is left past its end of block code
+    void decode_block(const uint16_t* in, uint32_t* pos, const uint8_t* quant, const int16_t* scale, int32_t* block) {
+        memset(block, 0, 64 * sizeof(int32_t));
+
+        uint32_t code = in[(*pos)++];
+
+        while (code == end_of_block) {
+            code = in[(*pos)++];
+        }
+
+        int32_t q_scale = (code >> 10) & 0x3F;
+        int32_t value = signed10(code) * quant[0];
+        uint32_t k = 0;
+
+        while (true) {
+            // * q scale 0 means coefficients are stored unquantized and in row order
+            if (q_scale == 0) {
+                value = signed10(code) * 2;
+            }
+
+            block[q_scale ? zigzag_to_row[k] : k] = clamp(value, -0x400, 0x3FF);
+
+            code = in[(*pos)++];
+            k += ((code >> 10) & 0x3F) + 1;
+
+            if (k > 63) break;
+
+            value = (signed10(code) * quant[k] * q_scale + 4) / 8;
+        }
+
+        idct(block, scale);
+    }
+
+    void write_mono(ps1::mdec_t* mdec, const int32_t* block, uint8_t* out) {
+        bool is_signed = mdec->command & (1u << 26);
+        uint8_t pixels[64];
+
+        for (uint32_t i = 0; i < 64; i++) {
+            pixels[i] = (uint8_t)clamp(block[i], -128, 127) ^ (is_signed ? 0 : 0x80);
+        }
+
+        if (get_depth(mdec->command) == ps1::mdec_depth_t::mono8) {
+            memcpy(out, pixels, 64);
+        } else {
+            // * first pixel in low nibble
+            for (uint32_t i = 0; i < 32; i++) {
+                out[i] = (pixels[i * 2] >> 4) | (pixels[i * 2 + 1] & 0xF0);
+            }
+        }
+    }
+
+    // * blocks are cr, cb and four luma blocks left to right, top to bottom
+    void write_color(ps1::mdec_t* mdec, const int32_t (*blocks)[64], uint8_t* out) {
+        bool is_signed = mdec->command & (1u << 26);
+        bool is_rgb15 = get_depth(mdec->command) == ps1::mdec_depth_t::rgb15;
+        uint16_t bit15 = (mdec->command & (1u << 25)) ? 0x8000 : 0;
+        uint8_t sign_flip = is_signed ? 0 : 0x80;
+
+        const int32_t* cr = blocks[0];
+        const int32_t* cb = blocks[1];
+
+        for (uint32_t y_block = 0; y_block < 4; y_block++) {
+            const int32_t* luma = blocks[2 + y_block];
+            uint32_t x_base = (y_block & 1) * 8;
+            uint32_t y_base = (y_block >> 1) * 8;
+
+            for (uint32_t y = 0; y < 8; y++) {
+                for (uint32_t x = 0; x < 8; x++) {
+                    uint32_t px = x_base + x;
+                    uint32_t py = y_base + y;
+                    uint32_t chroma = (px >> 1) + (py >> 1) * 8;
+
+                    int32_t l = luma[y * 8 + x];
+                    int32_t r = l + ((359 * cr[chroma] + 0x80) >> 8);
+                    int32_t g = l + ((((-88 * cb[chroma]) & ~0x1F) + ((-183 * cr[chroma]) & ~0x07) + 0x80) >> 8);
+                    int32_t b = l + ((454 * cb[chroma] + 0x80) >> 8);
+
+                    uint8_t r8 = (uint8_t)clamp(r, -128, 127) ^ sign_flip;
+                    uint8_t g8 = (uint8_t)clamp(g, -128, 127) ^ sign_flip;
+                    uint8_t b8 = (uint8_t)clamp(b, -128, 127) ^ sign_flip;
+
+                    uint32_t pixel = py * 16 + px;
+
+                    if (is_rgb15) {
+                        uint16_t color = (r8 >> 3) | ((g8 >> 3) << 5) | ((b8 >> 3) << 10) | bit15;
+
+                        memcpy(out + pixel * 2, &color, 2);
+                    } else {
+                        out[pixel * 3 + 0] = r8;
+                        out[pixel * 3 + 1] = g8;
+                        out[pixel * 3 + 2] = b8;
+                    }
+                }
+            }
+        }
+    }
+
+    // * runs on worker threads, only reads device
+    void decode_macroblock(ps1::mdec_t* mdec, uint32_t pos, uint8_t* out) {
+        const uint16_t* in = mdec->input.data();
+
+        if (is_color(get_depth(mdec->command))) {
+            int32_t blocks[6][64];
+
+            decode_block(in, &pos, mdec->quant_chroma, mdec->scale, blocks[0]);
+            decode_block(in, &pos, mdec->quant_chroma, mdec->scale, blocks[1]);
+
+            for (uint32_t i = 2; i < 6; i++) {
+                decode_block(in, &pos, mdec->quant_luma, mdec->scale, blocks[i]);
+            }
+
+            write_color(mdec, blocks, out);
+        } else {
+            int32_t block[64];
+
+            decode_block(in, &pos, mdec->quant_luma, mdec->scale, block);
+            write_mono(mdec, block, out);
+        }
+    }
+
+    /*
+    * walks codes without decoding to find where every macroblock starts
+    * trailing padding and cut off macroblock at the end are dropped
+    */
+    void find_macroblocks(ps1::mdec_t* mdec, uint32_t block_cnt) {
+        const uint16_t* in = mdec->input.data();
+        uint32_t size = (uint32_t)mdec->input.size();
+        uint32_t pos = 0;
+
+        mdec->macroblocks.clear();
+
+        while (true) {
+            uint32_t start = pos;
+
+            for (uint32_t i = 0; i < block_cnt; i++) {
+                while (pos < size && in[pos] == end_of_block) {
+                    pos++;
+                }
+
+                pos++; // * dc coefficient
+                uint32_t k = 0;
+
+                while (k <= 63) {
+                    if (pos >= size) return;
+
+                    k += ((in[pos++] >> 10) & 0x3F) + 1;
+                }
+            }
+
+            mdec->macroblocks.push_back(start);
+        }
+    }
+
+    // * ram destination of armed dma channel 1 if it takes whole output in one contiguous run
+    uint8_t* find_direct_target(ps1::mdec_t* mdec, size_t size) {
+        using control_t = ps1::dma_t::channel_t::control_t;
+
+        auto& channel = mdec->dma->channels[(uint32_t)ps1::dma_t::port_t::mdecout];
+
+        if (!channel.control.is_active()) return nullptr;
+        if (channel.control.direction != control_t::transfer_dir_t::device_to_ram) return nullptr;
+        if (channel.control.addr_step || channel.control.sync_mode == control_t::sync_mode_t::linked_list) return nullptr;
+
+        ps1::mem_addr_t addr = channel.base & 0x1FFFFC;
+
+        if ((size_t)channel.get_transfer_size() * 4 < size || addr + size > ps1::RAM_SIZE) return nullptr;
+
+        return mdec->ram->data + addr;
+    }
+
+    void decode(ps1::mdec_t* mdec) {
+        ps1::mdec_depth_t depth = get_depth(mdec->command);
+        uint32_t mb_size = macroblock_size(depth);
+
+        find_macroblocks(mdec, is_color(depth) ? 6 : 1);
+
+        uint32_t mb_cnt = (uint32_t)mdec->macroblocks.size();
+        size_t size = (size_t)mb_cnt * mb_size;
+
+        mdec->output.clear();
+        mdec->output_pos = 0;
+
+        uint8_t* target = size ? find_direct_target(mdec, size) : nullptr;
+        bool direct = target != nullptr;
+
+        if (!direct) {
+            mdec->output.resize(size);
+            target = mdec->output.data();
+        }
+
+        ps1::pool_run(mdec->pool, mb_cnt, [&](uint32_t i) {
+            decode_macroblock(mdec, mdec->macroblocks[i], target + (size_t)i * mb_size);
+        });
+
+        auto& channel = mdec->dma->channels[(uint32_t)ps1::dma_t::port_t::mdecout];
+
+        if (direct) {
+            ps1::dma_complete(mdec->dma, (uint32_t)ps1::dma_t::port_t::mdecout);
+        } else if (channel.control.is_active()) {
+            // * channel was waiting for smaller slice than whole output
+            ps1::dma_process(mdec->dma, (uint32_t)ps1::dma_t::port_t::mdecout);
+        }
+    }
+
+    void finish_command(ps1::mdec_t* mdec) {
+        switch (mdec->command >> 29) {
+            case command_decode: {
+                decode(mdec);
+
+                break;
+            }
+
+            case command_quant: {
+                memcpy(mdec->quant_luma, mdec->input.data(), 64);
+
+                if (mdec->command & 1) {
+                    memcpy(mdec->quant_chroma, (uint8_t*)mdec->input.data() + 64, 64);
+                }
+
+                break;
+            }
+
+            case command_scale: {
+                memcpy(mdec->scale, mdec->input.data(), sizeof(mdec->scale));
+
+                break;
+            }
+
+            default: {
+                // * remaining commands take parameters and do nothing with them
+                break;
+            }
+        }
+
+        mdec->input.clear();
+    }
+
+    void reset(ps1::mdec_t* mdec) {
+        mdec->command = 0;
+        mdec->remaining = 0;
+        mdec->input.clear();
+        mdec->output.clear();
+        mdec->output_pos = 0;
+    }
+}
+
+void ps1::mdec_init(mdec_t* mdec, dma_t* dma, ram_t* ram, pool_t* pool) {
+    mdec->dma = dma;
+    mdec->ram = ram;
+    mdec->pool = pool;
+
+    mdec->control = 0;
+
+    memset(mdec->quant_luma, 0, sizeof(mdec->quant_luma));
+    memset(mdec->quant_chroma, 0, sizeof(mdec->quant_chroma));
+    memset(mdec->scale, 0, sizeof(mdec->scale));
+
+    reset(mdec);
+}
+
+void ps1::mdec_exit(mdec_t* mdec) {}
+
+void ps1::mdec_save_state(mdec_t* mdec, serializer_t* serializer) {
+    serializer_write32(serializer, mdec->command);
+    serializer_write32(serializer, mdec->remaining);
+    serializer_write32(serializer, mdec->control);
+
+    serializer_write(serializer, mdec->quant_luma, sizeof(mdec->quant_luma));
+    serializer_write(serializer, mdec->quant_chroma, sizeof(mdec->quant_chroma));
+    serializer_write(serializer, mdec->scale, sizeof(mdec->scale));
+
+    serializer_write32(serializer, (uint32_t)mdec->input.size());
+    serializer_write(serializer, mdec->input.data(), mdec->input.size() * sizeof(uint16_t));
+
+    // * only part not read yet
+    serializer_write32(serializer, (uint32_t)(mdec->output.size() - mdec->output_pos));
+    serializer_write(serializer, mdec->output.data() + mdec->output_pos, mdec->output.size() - mdec->output_pos);
+}
+
+void ps1::mdec_load_state(mdec_t* mdec, serializer_t* serializer) {
+    mdec->command = serializer_read32(serializer);
+    mdec->remaining = serializer_read32(serializer);
+    mdec->control = serializer_read32(serializer);
+
+    serializer_read(serializer, mdec->quant_luma, sizeof(mdec->quant_luma));
+    serializer_read(serializer, mdec->quant_chroma, sizeof(mdec->quant_chroma));
+    serializer_read(serializer, mdec->scale, sizeof(mdec->scale));
+
+    uint32_t input_size = serializer_read32(serializer);
+    serializer->failed |= input_size > max_input_size;
+    mdec->input.resize(serializer->failed ? 0 : input_size);
+    serializer_read(serializer, mdec->input.data(), mdec->input.size() * sizeof(uint16_t));
+
+    uint32_t output_size = serializer_read32(serializer);
+    serializer->failed |= output_size > max_output_size;
+    mdec->output.resize(serializer->failed ? 0 : output_size);
+    mdec->output_pos = 0;
+    serializer_read(serializer, mdec->output.data(), mdec->output.size());
+}
+
+void ps1::mdec_write(mdec_t* mdec, uint32_t value) {
+    if (mdec->remaining > 0) {
+        mdec->input.push_back(value & 0xFFFF);
+        mdec->input.push_back(value >> 16);
+
+        if (--mdec->remaining == 0) {
+            finish_command(mdec);
+        }
+
+        return;
+    }
+
+    mdec->command = value;
+    mdec->input.clear();
+
+    switch (value >> 29) {
+        case command_quant: {
+            mdec->remaining = (value & 1) ? 32 : 16; // * luma table, then chroma table if bit 0 is set
+
+            break;
+        }
+
+        case command_scale: {
+            mdec->remaining = 32;
+
+            break;
+        }
+
+        default: {
+            mdec->remaining = value & 0xFFFF;
+
+            break;
+        }
+    }
+
+    if (mdec->remaining == 0) {
+        finish_command(mdec);
+    }
+}
+
+void ps1::mdec_write_control(mdec_t* mdec, uint32_t value) {
+    if (value & control_reset) {
+        reset(mdec);
+    }
+
+    mdec->control = value & (control_in_request | control_out_request);
+}
+
+uint32_t ps1::mdec_read(mdec_t* mdec) {
+    if (mdec->output_pos >= mdec->output.size()) return 0;
+
+    uint32_t value;
+    memcpy(&value, mdec->output.data() + mdec->output_pos, 4);
+    mdec->output_pos += 4;
+
+    return value;
+}
+
+uint32_t ps1::mdec_read_status(mdec_t* mdec) {
+    bool has_output = mdec->output_pos < mdec->output.size();
+    uint32_t status = 0;
+
+    status |= has_output ? 0 : 1u << 31;
+    status |= mdec->remaining ? 1u << 29 : 0;
+    status |= (mdec->control & control_in_request) ? 1u << 28 : 0;
+    status |= (mdec->control & control_out_request) && has_output ? 1u << 27 : 0;
+    status |= ((mdec->command >> 25) & 0xF) << 23; // * depth, signed and bit 15 of current command
+    status |= 4 << 16; // * current block, output is never caught mid macroblock
+    status |= (mdec->remaining - 1) & 0xFFFF;
+
+    return status;
+}
+
+bool ps1::mdec_dma_read(mdec_t* mdec, mem_addr_t addr, uint32_t word_cnt) {
+    size_t available = mdec->output.size() - mdec->output_pos;
+
+    if (available == 0) return false;
+
+    size_t size = std::min((size_t)word_cnt * 4, available);
+    const uint8_t* src = mdec->output.data() + mdec->output_pos;
+
+    mdec->output_pos += (uint32_t)size;
+
+    // * one copy per run up to end of ram, address wraps past it
+    while (size > 0) {
+        size_t run = std::min(size, (size_t)(RAM_SIZE - addr));
+
+        memcpy(mdec->ram->data + addr, src, run);
+
+        src += run;
+        size -= run;
+        addr = 0;
+    }
+
+    return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "defs.h"
+#include "peripheral.h"
+
+namespace ps1 {
+    // * output depth of decode command, bits [27:28]
+    enum struct mdec_depth_t : uint32_t {
+        mono4 = 0,
+        mono8 = 1,
+        rgb24 = 2,
+        rgb15 = 3,
+    };
+
+    /*
+    * macroblock decoder
+    * run length coded blocks are dequantized, inverse transformed and converted from yuv, whole decode command at once
+    *
+    * decoding starts once last parameter word arrives. macroblock starts are found by walking codes,
+    * after that macroblocks are independent and get decoded on worker pool.
+    * if dma channel 1 is already waiting for output, pixels are decoded straight into its destination in ram,
+    * otherwise they wait in output buffer until channel 1 or data port picks them up
+    */
+    struct mdec_t {
+        dma_t* dma;
+        ram_t* ram;
+        pool_t* pool;
+
+        uint32_t command; // * command word being received
+        uint32_t remaining; // * parameter words still expected, 0 while idle
+        uint32_t control; // * data request enables written to +0x4
+
+        uint8_t quant_luma[64];
+        uint8_t quant_chroma[64];
+        int16_t scale[64]; // * idct matrix, row per frequency
+
+        dyn_arr_t<uint16_t> input; // * parameters of current command, two halfwords per word
+        dyn_arr_t<uint8_t> output; // * decoded pixels not read yet
+        uint32_t output_pos;
+
+        dyn_arr_t<uint32_t> macroblocks; // * input position of every macroblock of current decode, scratch
+    };
+
+    void mdec_init(mdec_t*, dma_t*, ram_t*, pool_t*);
+    void mdec_exit(mdec_t*);
+
+    void mdec_save_state(mdec_t*, serializer_t*);
+    void mdec_load_state(mdec_t*, serializer_t*);
+
+    // * +0x0, command or parameter word
+    void mdec_write(mdec_t*, uint32_t);
+    // * +0x4, reset and dma request enables
+    void mdec_write_control(mdec_t*, uint32_t);
+
+    // * +0x0, next word of output
+    uint32_t mdec_read(mdec_t*);
+    // * +0x4
+    uint32_t mdec_read_status(mdec_t*);
+
+    // * dma channel 1, copies up to given word count into ram. false if there is no output yet
+    bool mdec_dma_read(mdec_t*, mem_addr_t, uint32_t);
+
+    FETCH_FN(mdec_t) fetch(void* device, mem_addr_t offset) {
+        mdec_t* mdec = (mdec_t*)device;
+
+        if (offset == 0) {
+            return mdec_read(mdec);
+        } else if (offset == 4) {
+            return mdec_read_status(mdec);
+        }
+
+        ASSERT(false, "unhandled mdec fetch");
+
+        return 0;
+    }
+
+    STORE_FN(mdec_t) store(void* device, mem_addr_t offset, type_t value) {
+        mdec_t* mdec = (mdec_t*)device;
+
+        if (offset == 0) {
+            mdec_write(mdec, value);
+        } else if (offset == 4) {
+            mdec_write_control(mdec, value);
+        } else {
+            ASSERT(false, "unhandled mdec store");
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "defs.h"
+#include "peripheral.h"
+
+namespace ps1 {
+    /*
+    * controller and memory card port with nothing plugged in
+    * transfers finish right away and no device ever acknowledges, so kernel sees empty slots instead of waiting forever
+    */
+    struct pad_t {};
+
+    FETCH_FN(pad_t) fetch(void* device, mem_addr_t offset) {
+        if (offset == 0x0) {
+            return (type_t)0xFF; // * JOY_RX_DATA, floating bus
+        } else if (offset == 0x4) {
+            return 0x7; // * JOY_STAT, tx ready, rx byte waiting and tx finished
+        }
+
+        return 0;
+    }
+
+    STORE_FN(pad_t) store(void* device, mem_addr_t offset, type_t value) {}
+}
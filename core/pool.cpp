@@ -0,0 +1,101 @@
+#include "pool.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint32_t max_thread_cnt = 7;
+
+    void run_items(ps1::pool_t* pool) {
+        uint32_t item;
+
+        while ((item = pool->next_item.fetch_add(1, std::memory_order_relaxed)) < pool->item_cnt) {
+            (*pool->job)(item);
+        }
+    }
+
+    void worker(ps1::pool_t* pool) {
+        uint64_t seen = 0;
+
+        while (true) {
+            {
+                std::unique_lock lock(pool->mutex);
+                pool->work_cv.wait(lock, [&] { return pool->quit || pool->generation != seen; });
+
+                if (pool->quit) return;
+
+                seen = pool->generation;
+            }
+
+            run_items(pool);
+
+            std::lock_guard lock(pool->mutex);
+
+            if (--pool->active_cnt == 0) {
+                pool->done_cv.notify_one();
+            }
+        }
+    }
+}
+
+void ps1::pool_init(pool_t* pool, uint32_t thread_cnt) {
+    if (thread_cnt == 0) {
+        uint32_t hardware_cnt = std::thread::hardware_concurrency();
+
+        thread_cnt = std::min(hardware_cnt > 1 ? hardware_cnt - 1 : 0, max_thread_cnt);
+    }
+
+    pool->job = nullptr;
+    pool->item_cnt = 0;
+    pool->next_item = 0;
+    pool->active_cnt = 0;
+    pool->generation = 0;
+    pool->quit = false;
+
+    for (uint32_t i = 0; i < thread_cnt; i++) {
+        pool->threads.emplace_back(worker, pool);
+    }
+}
+
+void ps1::pool_exit(pool_t* pool) {
+    {
+        std::lock_guard lock(pool->mutex);
+        pool->quit = true;
+    }
+
+    pool->work_cv.notify_all();
+
+    for (auto& thread : pool->threads) {
+        thread.join();
+    }
+
+    pool->threads.clear();
+}
+
+void ps1::pool_run(pool_t* pool, uint32_t count, const func_t<void(uint32_t)>& job) {
+    // * waking workers costs more than a couple of items
+    if (pool->threads.empty() || count < 2) {
+        for (uint32_t i = 0; i < count; i++) {
+            job(i);
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard lock(pool->mutex);
+
+        pool->job = &job;
+        pool->item_cnt = count;
+        pool->next_item = 0;
+        pool->active_cnt = (uint32_t)pool->threads.size();
+        pool->generation++;
+    }
+
+    pool->work_cv.notify_all();
+
+    run_items(pool);
+
+    // * job lives on caller stack, every worker has to let go of it before returning
+    std::unique_lock lock(pool->mutex);
+    pool->done_cv.wait(lock, [&] { return pool->active_cnt == 0; });
+}
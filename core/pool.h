@@ -0,0 +1,37 @@
+#pragma once
+
+#include "defs.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace ps1 {
+    /*
+    * fixed set of worker threads for fork join work on emulation thread
+    * items are claimed one at a time, calling thread claims items too and returns only once every item is done
+    */
+    struct pool_t {
+        dyn_arr_t<std::thread> threads;
+
+        std::mutex mutex;
+        std::condition_variable work_cv;
+        std::condition_variable done_cv;
+
+        // * current job, written under mutex before generation is bumped
+        const func_t<void(uint32_t)>* job;
+        uint32_t item_cnt;
+        std::atomic<uint32_t> next_item;
+        uint32_t active_cnt; // * workers that have not finished current generation
+        uint64_t generation;
+        bool quit;
+    };
+
+    // * 0 picks hardware thread count minus emulation thread
+    void pool_init(pool_t*, uint32_t);
+    void pool_exit(pool_t*);
+
+    // * calls function once for every index in [0, count)
+    void pool_run(pool_t*, uint32_t, const func_t<void(uint32_t)>&);
+}
@@ -1,6 +1,11 @@
 #include "ps1.h"
 
-#include "file.h"
+#include "serializer.h"
+#include "compress.h"
+#include "logger.h"
+
+#include <future>
+#include <filesystem>
 
 #define SETUP_FETCH(type, info)\
     info.fetch32 = ps1::fetch<type, uint32_t>;\
@@ -18,6 +23,7 @@
 
 namespace {
     ps1::nodevice_t nodevice;
+    ps1::pad_t pad;
 
     void ps1_interconnect(ps1::ps1_t* console) {
         // * nodevice
@@ -56,31 +62,48 @@ namespace {
         dma_info.device = &console->dma;
         SETUP_STORE_FETCH(ps1::dma_t, dma_info);
 
+        // * controller and memory card ports
+        ps1::device_info_t pad_info;
+        pad_info.device = &pad;
+        SETUP_STORE_FETCH(ps1::pad_t, pad_info);
+
+        // * interrupt controller
+        ps1::device_info_t irq_info;
+        irq_info.device = &console->irq;
+        SETUP_STORE_FETCH(ps1::irq_t, irq_info);
+
+        // * cdrom
+        ps1::device_info_t cdrom_info;
+        cdrom_info.device = &console->cdrom;
+        SETUP_STORE_FETCH(ps1::cdrom_t, cdrom_info);
+
+        // * macroblock decoder
+        ps1::device_info_t mdec_info;
+        mdec_info.device = &console->mdec;
+        SETUP_STORE_FETCH(ps1::mdec_t, mdec_info);
+
+        // * sound processing unit
+        ps1::device_info_t spu_info;
+        spu_info.device = &console->spu;
+        SETUP_STORE_FETCH(ps1::spu_t, spu_info);
+
         // * important to map nodevices first to override subregions
         {
             // * Cache control registers
             nodevice_info.mem_range = { 0xFFFE0130, 4 };
             ps1::bus_connect(&console->bus, nodevice_info);
 
-            // * SPU memory region
-            nodevice_info.mem_range = { 0x1F801C00, 0x1F802000 - 0x1F801C00 };
-            ps1::bus_connect(&console->bus, nodevice_info);
-
             // * Expansion 2 memory region. Used for debugging
             nodevice_info.mem_range = { 0x1F802000, 0x80 };
             ps1::bus_connect(&console->bus, nodevice_info);
 
-            // * Interrupt control registers. Not yet needed
-            nodevice_info.mem_range = { 0x1F801070, 8 };
+            // * Serial port
+            nodevice_info.mem_range = { 0x1F801050, 0x1F801060 - 0x1F801050 };
             ps1::bus_connect(&console->bus, nodevice_info);
 
             // * Timer
             nodevice_info.mem_range = { 0x1F801100, 0x1F801130 - 0x1F801100 };
             ps1::bus_connect(&console->bus, nodevice_info);
-
-            // * CDROM
-            nodevice_info.mem_range = { 0x1F801800, 0x1F801810 - 0x1F801800 };
-            ps1::bus_connect(&console->bus, nodevice_info);
         }
 
         {
@@ -98,6 +121,24 @@ namespace {
         ram_info.mem_range = { ps1::RAM_ADDR, ps1::RAM_SIZE };
         ps1::bus_connect(&console->bus, ram_info);
 
+        // * devices are searched in order, ports hit less often than bios and ram go after them but still before hardware register region
+        {
+            pad_info.mem_range = { 0x1F801040, 0x10 };
+            ps1::bus_connect(&console->bus, pad_info);
+
+            irq_info.mem_range = { 0x1F801070, 8 };
+            ps1::bus_connect(&console->bus, irq_info);
+
+            cdrom_info.mem_range = { 0x1F801800, 4 };
+            ps1::bus_connect(&console->bus, cdrom_info);
+
+            mdec_info.mem_range = { 0x1F801820, 8 };
+            ps1::bus_connect(&console->bus, mdec_info);
+
+            spu_info.mem_range = { 0x1F801C00, 0x1F802000 - 0x1F801C00 };
+            ps1::bus_connect(&console->bus, spu_info);
+        }
+
         hardreg_info.mem_range = { ps1::HARDREG_ADDR, ps1::HARDREG_SIZE };
         ps1::bus_connect(&console->bus, hardreg_info);
 
@@ -106,48 +147,543 @@ namespace {
     }
 }
     
+namespace {
+    void vblank_event(void* device) {
+        ps1::ps1_t* console = (ps1::ps1_t*)device;
+
+        ps1::irq_request(&console->irq, ps1::irq_line_t::vblank);
+        ps1::scheduler_schedule(&console->scheduler, ps1::event_slot_t::vblank, (uint64_t)ps1::gpu_cycles_per_frame(&console->gpu));
+    }
+}
+
+namespace {
+    constexpr uint32_t fourcc(const char* code) {
+        return code[0] | (code[1] << 8) | (code[2] << 16) | (code[3] << 24);
+    }
+
+    constexpr uint32_t state_magic = fourcc("PS1S");
+
+    // * bump whenever save layout of any device changes
+    constexpr uint32_t state_version = 5;
+
+    constexpr uint32_t chunk_flag_lz = 0x1;
+
+    constexpr uint32_t chunk_cnt = (uint32_t)ps1::state_chunk_t::count;
+
+    struct chunk_info_t {
+        uint32_t tag;
+        const char* name;
+        bool compressed; // * small device chunks are not worth it
+    };
+
+    constexpr chunk_info_t chunk_infos[chunk_cnt] = {
+        { fourcc("CPU "), "cpu", false },
+        { fourcc("RAM "), "ram", true },
+        { fourcc("GPU "), "gpu", false },
+        { fourcc("DMA "), "dma", false },
+        { fourcc("VRAM"), "vram", true },
+        { fourcc("IRQ "), "irq", false },
+        { fourcc("SCHD"), "scheduler", false },
+        { fourcc("CDRM"), "cdrom", false },
+        { fourcc("MDEC"), "mdec", true },
+        { fourcc("SPU "), "spu", true },
+    };
+
+    struct encoded_chunk_t {
+        dyn_arr_t<uint8_t> data; // * only used when compressed
+        uint32_t flags;
+        uint32_t checksum;
+    };
+
+    struct decoded_chunk_t {
+        uint32_t flags;
+        uint32_t raw_size;
+        uint32_t stored_size;
+        uint32_t checksum;
+
+        const uint8_t* stored; // * view into mapped file, null if chunk is missing
+        const uint8_t* raw; // * stored itself or decompressed
+        dyn_arr_t<uint8_t> decompressed;
+        bool valid;
+    };
+
+    // * stops cpu on shell entry, pending boot work is then done by ps1_poll_shell_entry
+    void arm_shell_entry(ps1::ps1_t* console) {
+        if (console->boot.hook_id) return;
+
+        console->boot.hook_id = ps1::cpu_add_hook(&console->cpu, ps1::SHELL_ENTRY, [](ps1::cpu_t* cpu) {
+            ps1::cpu_set_state(cpu, ps1::cpu_state_t::sleeping);
+
+            return false;
+        });
+    }
+
+    // * version string may come from anywhere, keep file name portable
+    str_t sanitize_file_name(str_t name) {
+        for (char& c : name) {
+            if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '_') c = '-';
+        }
+
+        return name;
+    }
+
+    // * fnv-1a
+    uint64_t hash_bios(const uint8_t* data) {
+        uint64_t hash = 0xcbf29ce484222325;
+
+        for (uint32_t i = 0; i < ps1::BIOS_SIZE; i++) {
+            hash = (hash ^ data[i]) * 0x100000001b3;
+        }
+
+        return hash;
+    }
+
+    template <typename T>
+    void save_chunk(dyn_arr_t<uint8_t>* chunk, T* device, void (*save)(T*, ps1::serializer_t*)) {
+        chunk->clear();
+
+        ps1::serializer_t serializer;
+        ps1::serializer_open_memory(&serializer, chunk);
+        save(device, &serializer);
+        ps1::serializer_close(&serializer);
+    }
+
+    // * false if chunk size does not match what device reads
+    template <typename T>
+    bool load_chunk(decoded_chunk_t* chunk, T* device, void (*load)(T*, ps1::serializer_t*)) {
+        ps1::serializer_t serializer;
+        ps1::serializer_open_memory(&serializer, chunk->raw, chunk->raw_size);
+        load(device, &serializer);
+
+        bool consumed = serializer.offset == chunk->raw_size;
+
+        return ps1::serializer_close(&serializer) && consumed;
+    }
+
+    // * compressed form is dropped if it does not save anything
+    void encode_chunk(const dyn_arr_t<uint8_t>* chunk, encoded_chunk_t* encoded, bool compress) {
+        encoded->checksum = ps1::adler32(chunk->data(), chunk->size());
+        encoded->flags = 0;
+
+        if (!compress) return;
+
+        encoded->data.clear();
+        ps1::lz_compress(chunk->data(), chunk->size(), &encoded->data);
+
+        if (encoded->data.size() < chunk->size()) {
+            encoded->flags |= chunk_flag_lz;
+        }
+    }
+
+    void decode_chunk(decoded_chunk_t* chunk) {
+        if (chunk->flags & chunk_flag_lz) {
+            chunk->decompressed.resize(chunk->raw_size);
+            chunk->raw = chunk->decompressed.data();
+            chunk->valid = ps1::lz_decompress(chunk->stored, chunk->stored_size, chunk->decompressed.data(), chunk->raw_size);
+        } else {
+            chunk->raw = chunk->stored;
+            chunk->valid = chunk->stored_size == chunk->raw_size;
+        }
+
+        chunk->valid = chunk->valid && ps1::adler32(chunk->raw, chunk->raw_size) == chunk->checksum;
+    }
+}
+
 void ps1::ps1_init(ps1_t* console, const str_t& bios_path) {
     ps1_interconnect(console);
+    pool_init(&console->pool, 0);
+    audio_ring_init(&console->audio, AUDIO_SAMPLE_RATE / 4);
     bios_init(&console->bios, bios_path);
     vram_init(&console->vram);
+    hle_init(&console->hle, &console->ram);
     ps1_soft_reset(console);
+
+    console->pending_save.pending = false;
+    console->boot.capture = false;
+    console->boot.sideload = false;
+    console->boot.hook_id = 0;
 }
 
 void ps1::ps1_exit(ps1_t* console) {
+    ps1_poll_save_state(console, true);
+
     cpu_exit(&console->cpu);
     bus_exit(&console->bus);
     ram_exit(&console->ram);
     dma_exit(&console->dma);
+    cdrom_exit(&console->cdrom);
+    irq_exit(&console->irq);
+    mdec_exit(&console->mdec);
+    spu_exit(&console->spu);
+    disc_close(&console->disc);
+    pool_exit(&console->pool);
+    audio_ring_exit(&console->audio);
     vram_exit(&console->vram);
+    hle_exit(&console->hle);
     bios_exit(&console->bios);
 }
 
 void ps1::ps1_soft_reset(ps1_t* console) {
+    spu_exit(&console->spu);
+    mdec_exit(&console->mdec);
+    cdrom_exit(&console->cdrom);
+    irq_exit(&console->irq);
     dma_exit(&console->dma);
     gpu_exit(&console->gpu);
     ram_exit(&console->ram);
     cpu_exit(&console->cpu);
 
-    cpu_init(&console->cpu, &console->bus);
+    cpu_init(&console->cpu, &console->cpu_watch, &console->bus, &console->irq, &console->scheduler);
+    scheduler_init(&console->scheduler, &console->cpu.cycle_cnt);
+    irq_init(&console->irq);
     ram_init(&console->ram);
     gpu_init(&console->gpu, &console->vram);
-    dma_init(&console->dma, &console->ram, &console->gpu);
+    cdrom_init(&console->cdrom, &console->scheduler, &console->irq, &console->disc);
+    mdec_init(&console->mdec, &console->dma, &console->ram, &console->pool);
+    spu_init(&console->spu, &console->cpu.cycle_cnt, &console->scheduler, &console->irq, &console->audio);
+    dma_init(&console->dma, &console->irq, &console->ram, &console->gpu, &console->cdrom, &console->mdec, &console->spu);
+
+    scheduler_register(&console->scheduler, event_slot_t::vblank, vblank_event, console);
+    scheduler_schedule(&console->scheduler, event_slot_t::vblank, (uint64_t)gpu_cycles_per_frame(&console->gpu));
+}
+
+void ps1::ps1_set_hle(ps1_t* console, bool enabled) {
+    hle_set_enabled(&console->hle, &console->cpu, enabled);
+}
+
+bool ps1::ps1_insert_disc(ps1_t* console, const str_t& path) {
+    bool opened = disc_open(&console->disc, path);
+
+    cdrom_disc_changed(&console->cdrom);
+
+    return opened;
+}
+
+bool ps1::ps1_boot_from_cache(ps1_t* console, const str_t& cache_dir) {
+    ps1_boot_t* boot = &console->boot;
+
+    // * emulator version covers fixes that change boot without touching save layout
+    char name[64];
+    snprintf(name, sizeof(name), "boot_%016llx_v%u_", (unsigned long long)hash_bios(console->bios.data), state_version);
+
+    boot->cache_path = cache_dir + "/" + name + sanitize_file_name(PS1_VERSION) + ".state";
+
+    std::error_code error;
+
+    if (std::filesystem::exists(boot->cache_path, error)) {
+        if (ps1_load_state(console, boot->cache_path)) {
+            logger::push("restored boot snapshot " + boot->cache_path, logger::type_t::info, "state");
+
+            return true;
+        }
+
+        // * stale snapshot might have been partially loaded, boot from scratch and overwrite it
+        ps1_soft_reset(console);
+    }
+
+    std::filesystem::create_directories(cache_dir, error);
+
+    boot->capture = true;
+    arm_shell_entry(console);
+
+    return false;
+}
+
+bool ps1::ps1_sideload_exe(ps1_t* console, const str_t& path) {
+    ps1_boot_t* boot = &console->boot;
+
+    if (!exe_read(&boot->exe, path)) return false;
+
+    if (console->cpu.pc == SHELL_ENTRY) {
+        exe_load(&boot->exe, &console->ram, &console->cpu);
+
+        return true;
+    }
+
+    boot->sideload = true;
+    arm_shell_entry(console);
+
+    return true;
+}
+
+bool ps1::ps1_poll_shell_entry(ps1_t* console) {
+    ps1_boot_t* boot = &console->boot;
+
+    if (!(boot->capture || boot->sideload) || console->cpu.pc != SHELL_ENTRY) return false;
+
+    cpu_remove_hook(&console->cpu, boot->hook_id);
+    boot->hook_id = 0;
+
+    if (boot->capture) {
+        boot->capture = false;
+
+        ps1_save_state(console, boot->cache_path);
+
+        logger::push("captured boot snapshot " + boot->cache_path, logger::type_t::info, "state");
+    }
+
+    if (boot->sideload) {
+        boot->sideload = false;
+
+        exe_load(&boot->exe, &console->ram, &console->cpu);
+    }
+
+    // * user breakpoint on shell entry still stops there
+    if (!console->cpu_watch.breakpoints.contains(SHELL_ENTRY)) {
+        cpu_set_state(&console->cpu, cpu_state_t::running);
+    }
+
+    return true;
+}
+
+void ps1::ps1_save_state(ps1_t* console, serializer_t* serializer) {
+    cpu_save_state(&console->cpu, serializer);
+    ram_save_state(&console->ram, serializer);
+    gpu_save_state(&console->gpu, serializer);
+    dma_save_state(&console->dma, serializer);
+    irq_save_state(&console->irq, serializer);
+    scheduler_save_state(&console->scheduler, serializer);
+    cdrom_save_state(&console->cdrom, serializer);
+    mdec_save_state(&console->mdec, serializer);
+    spu_save_state(&console->spu, serializer);
+}
+
+bool ps1::ps1_load_state(ps1_t* console, serializer_t* serializer) {
+    cpu_load_state(&console->cpu, serializer);
+    ram_load_state(&console->ram, serializer);
+    gpu_load_state(&console->gpu, serializer);
+    dma_load_state(&console->dma, serializer);
+    irq_load_state(&console->irq, serializer);
+    scheduler_load_state(&console->scheduler, serializer);
+    cdrom_load_state(&console->cdrom, serializer);
+    mdec_load_state(&console->mdec, serializer);
+    spu_load_state(&console->spu, serializer);
+
+    return !serializer->failed;
+}
+
+void ps1::ps1_begin_save_state(ps1_t* console, const str_t& path) {
+    ps1_pending_save_t* save = &console->pending_save;
+
+    // * only one readback can be in flight
+    ps1_poll_save_state(console, true);
+
+    save->path = path;
+    save->pending = true;
+
+    save_chunk(&save->chunks[(size_t)state_chunk_t::cpu], &console->cpu, cpu_save_state);
+    save_chunk(&save->chunks[(size_t)state_chunk_t::ram], &console->ram, ram_save_state);
+    save_chunk(&save->chunks[(size_t)state_chunk_t::gpu], &console->gpu, gpu_save_state);
+    save_chunk(&save->chunks[(size_t)state_chunk_t::dma], &console->dma, dma_save_state);
+    save_chunk(&save->chunks[(size_t)state_chunk_t::irq], &console->irq, irq_save_state);
+    save_chunk(&save->chunks[(size_t)state_chunk_t::scheduler], &console->scheduler, scheduler_save_state);
+    save_chunk(&save->chunks[(size_t)state_chunk_t::cdrom], &console->cdrom, cdrom_save_state);
+    save_chunk(&save->chunks[(size_t)state_chunk_t::mdec], &console->mdec, mdec_save_state);
+    save_chunk(&save->chunks[(size_t)state_chunk_t::spu], &console->spu, spu_save_state);
+
+    vram_begin_readback(&console->vram);
+}
+
+void ps1::ps1_poll_save_state(ps1_t* console, bool wait) {
+    ps1_pending_save_t* save = &console->pending_save;
+
+    if (!save->pending) return;
+    if (!wait && !vram_is_readback_ready(&console->vram)) return;
+
+    save->pending = false;
+
+    dyn_arr_t<uint8_t>& vram_chunk = save->chunks[(size_t)state_chunk_t::vram];
+    vram_chunk.resize(VRAM_WIDTH * VRAM_HEIGHT * sizeof(uint16_t));
+
+    // * null backend has no pixels, state is written without vram chunk instead of black vram
+    bool has_vram = vram_end_readback(&console->vram, (uint16_t*)vram_chunk.data());
+
+    auto is_written = [has_vram](uint32_t i) {
+        return has_vram || i != (uint32_t)state_chunk_t::vram;
+    };
+
+    encoded_chunk_t encoded[chunk_cnt];
+    std::future<void> tasks[chunk_cnt];
+
+    for (uint32_t i = 0; i < chunk_cnt; i++) {
+        if (!is_written(i)) continue;
+
+        if (chunk_infos[i].compressed) {
+            tasks[i] = std::async(std::launch::async, encode_chunk, &save->chunks[i], &encoded[i], true);
+        } else {
+            encode_chunk(&save->chunks[i], &encoded[i], false);
+        }
+    }
+
+    for (auto& task : tasks) {
+        if (task.valid()) task.wait();
+    }
+
+    serializer_t serializer;
+
+    if (!serializer_open_mmap(&serializer, save->path, serializer_mode_t::write)) {
+        logger::push("failed to open " + save->path + " for writing", logger::type_t::error, "state");
+    }
+
+    serializer_write32(&serializer, state_magic);
+    serializer_write32(&serializer, state_version);
+    serializer_write32(&serializer, has_vram ? chunk_cnt : chunk_cnt - 1);
+
+    for (uint32_t i = 0; i < chunk_cnt; i++) {
+        if (!is_written(i)) continue;
+
+        const dyn_arr_t<uint8_t>& data = encoded[i].flags & chunk_flag_lz ? encoded[i].data : save->chunks[i];
+
+        serializer_write32(&serializer, chunk_infos[i].tag);
+        serializer_write32(&serializer, encoded[i].flags);
+        serializer_write32(&serializer, (uint32_t)save->chunks[i].size());
+        serializer_write32(&serializer, (uint32_t)data.size());
+        serializer_write32(&serializer, encoded[i].checksum);
+        serializer_write(&serializer, data.data(), data.size());
+    }
+
+    if (!serializer_close(&serializer)) {
+        logger::push("failed to save state to " + save->path, logger::type_t::error, "state");
+    }
 }
 
 void ps1::ps1_save_state(ps1_t* console, const str_t& path) {
-    file::open_writable(path);
-    cpu_save_state(&console->cpu);
-    ram_save_state(&console->ram);
-    gpu_save_state(&console->gpu);
-    dma_save_state(&console->dma);
-    file::close_writable();
-}
-
-void ps1::ps1_load_state(ps1_t* console, const str_t& path) {
-    file::open_readable(path);
-    cpu_load_state(&console->cpu);
-    ram_load_state(&console->ram);
-    gpu_load_state(&console->gpu);
-    dma_load_state(&console->dma);
-    file::close_readable();
+    ps1_begin_save_state(console, path);
+    ps1_poll_save_state(console, true);
+}
+
+bool ps1::ps1_load_state(ps1_t* console, const str_t& path) {
+    serializer_t serializer;
+
+    if (!serializer_open_mmap(&serializer, path, serializer_mode_t::read)) {
+        logger::push("failed to open " + path, logger::type_t::error, "state");
+
+        serializer_close(&serializer);
+
+        return false;
+    }
+
+    uint32_t magic = serializer_read32(&serializer);
+    uint32_t version = serializer_read32(&serializer);
+    uint32_t stored_chunk_cnt = serializer_read32(&serializer);
+
+    if (magic != state_magic) {
+        logger::push(path + " is not a save state", logger::type_t::error, "state");
+
+        serializer_close(&serializer);
+
+        return false;
+    }
+
+    if (version != state_version) {
+        logger::push("state " + path + " has version " + std::to_string(version) + ", expected " + std::to_string(state_version), logger::type_t::error, "state");
+
+        serializer_close(&serializer);
+
+        return false;
+    }
+
+    decoded_chunk_t decoded[chunk_cnt] = {};
+
+    for (uint32_t i = 0; i < stored_chunk_cnt && !serializer.failed; i++) {
+        decoded_chunk_t chunk = {};
+
+        uint32_t tag = serializer_read32(&serializer);
+        chunk.flags = serializer_read32(&serializer);
+        chunk.raw_size = serializer_read32(&serializer);
+        chunk.stored_size = serializer_read32(&serializer);
+        chunk.checksum = serializer_read32(&serializer);
+        chunk.stored = serializer_read_view(&serializer, chunk.stored_size);
+
+        // * chunks written by newer builds are skipped
+        for (uint32_t j = 0; j < chunk_cnt; j++) {
+            if (chunk_infos[j].tag == tag) decoded[j] = chunk;
+        }
+    }
+
+    if (serializer.failed) {
+        logger::push("state " + path + " is truncated", logger::type_t::error, "state");
+
+        serializer_close(&serializer);
+
+        return false;
+    }
+
+    std::future<void> tasks[chunk_cnt];
+
+    for (uint32_t i = 0; i < chunk_cnt; i++) {
+        if (!decoded[i].stored) continue;
+
+        if (decoded[i].flags & chunk_flag_lz) {
+            tasks[i] = std::async(std::launch::async, decode_chunk, &decoded[i]);
+        } else {
+            decode_chunk(&decoded[i]);
+        }
+    }
+
+    for (auto& task : tasks) {
+        if (task.valid()) task.wait();
+    }
+
+    for (uint32_t i = 0; i < chunk_cnt; i++) {
+        // * missing vram, e.g. in states written by headless build, keeps current vram until game redraws
+        if (!decoded[i].stored && i == (uint32_t)state_chunk_t::vram) continue;
+
+        if (!decoded[i].stored || !decoded[i].valid) {
+            logger::push("state " + path + " has " + (decoded[i].stored ? "corrupt " : "no ") + chunk_infos[i].name + " chunk", logger::type_t::error, "state");
+
+            serializer_close(&serializer);
+
+            return false;
+        }
+    }
+
+    // * every chunk is verified at this point, devices are only touched from here on
+    bool loaded = true;
+
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::cpu], &console->cpu, cpu_load_state);
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::ram], &console->ram, ram_load_state);
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::gpu], &console->gpu, gpu_load_state);
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::dma], &console->dma, dma_load_state);
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::irq], &console->irq, irq_load_state);
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::scheduler], &console->scheduler, scheduler_load_state);
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::cdrom], &console->cdrom, cdrom_load_state);
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::mdec], &console->mdec, mdec_load_state);
+    loaded &= load_chunk(&decoded[(size_t)state_chunk_t::spu], &console->spu, spu_load_state);
+
+    decoded_chunk_t* vram_chunk = &decoded[(size_t)state_chunk_t::vram];
+
+    if (vram_chunk->stored && vram_chunk->raw_size == VRAM_WIDTH * VRAM_HEIGHT * sizeof(uint16_t)) {
+        vram_write_all(&console->vram, (const uint16_t*)vram_chunk->raw);
+    } else {
+        loaded &= !vram_chunk->stored;
+    }
+
+    serializer_close(&serializer);
+
+    if (!loaded) {
+        // ! devices are left partially loaded, soft reset is the only way back to sane state
+        logger::push("state " + path + " does not match device layout", logger::type_t::error, "state");
+
+        return false;
+    }
+
+    return true;
+}
+
+void ps1::ps1_save_state(ps1_t* console, dyn_arr_t<uint8_t>* buffer) {
+    buffer->clear();
+
+    serializer_t serializer;
+    serializer_open_memory(&serializer, buffer);
+    ps1_save_state(console, &serializer);
+    serializer_close(&serializer);
+}
+
+bool ps1::ps1_load_state(ps1_t* console, const dyn_arr_t<uint8_t>* buffer) {
+    serializer_t serializer;
+    serializer_open_memory(&serializer, buffer->data(), buffer->size());
+    ps1_load_state(console, &serializer);
+
+    return serializer_close(&serializer);
 }
\ No newline at end of file
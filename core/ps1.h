@@ -10,12 +10,57 @@
 #include "gpu.h"
 #include "dma.h"
 #include "nodevice.h"
+#include "pad.h"
 #include "vram.h"
+#include "exe.h"
+#include "hle.h"
+#include "irq.h"
+#include "scheduler.h"
+#include "cdrom.h"
+#include "disc.h"
+#include "mdec.h"
+#include "pool.h"
+#include "spu.h"
+#include "audio.h"
 
 namespace ps1 {
+    // * chunks of file state, in the order they are written and loaded
+    enum struct state_chunk_t : uint32_t {
+        cpu,
+        ram,
+        gpu,
+        dma,
+        vram,
+        irq,
+        scheduler,
+        cdrom,
+        mdec,
+        spu,
+        count
+    };
+
+    // * file save waiting for vram readback. devices are serialized at the moment save was requested
+    struct ps1_pending_save_t {
+        str_t path;
+        dyn_arr_t<uint8_t> chunks[(size_t)state_chunk_t::count];
+        bool pending;
+    };
+
+    // * work done once cpu arrives at shell entry, hook there stops cpu while any of it is pending
+    struct ps1_boot_t {
+        str_t cache_path; // * post bios snapshot
+        bool capture;
+
+        exe_t exe;
+        bool sideload;
+
+        uint32_t hook_id; // * 0 when not armed
+    };
+
     struct ps1_t {
         bus_t bus;
         cpu_t cpu;
+        cpu_watch_t cpu_watch;
         bios_t bios;
         ram_t ram;
         hardreg_t hardreg;
@@ -23,6 +68,19 @@ namespace ps1 {
         gpu_t gpu;
         dma_t dma;
         vram_t vram;
+        hle_t hle;
+        irq_t irq;
+        scheduler_t scheduler;
+        cdrom_t cdrom;
+        disc_t disc;
+        mdec_t mdec;
+        spu_t spu;
+
+        pool_t pool; // * shared by devices that split work across threads
+        audio_ring_t audio; // * spu output, drained by host audio or wav sink
+
+        ps1_pending_save_t pending_save;
+        ps1_boot_t boot;
     };
 
     void ps1_init(ps1_t*, const str_t&);
@@ -30,13 +88,62 @@ namespace ps1 {
 
     void ps1_soft_reset(ps1_t*);
 
+    // * service hot bios kernel calls natively
+    void ps1_set_hle(ps1_t*, bool);
+
+    // * .cue or raw .bin image, replaces disc in drive. false if image can not be opened, drive is then empty
+    bool ps1_insert_disc(ps1_t*, const str_t&);
+
+    /*
+    * snapshot file in given directory is keyed by bios hash, state version and emulator version
+    * restores it if present and returns true, console is then sitting at shell entry
+    * otherwise arms shell entry hook and returns false
+    */
+    bool ps1_boot_from_cache(ps1_t*, const str_t&);
+
+    // * exe replaces shell once bios reaches it, right away if console already sits at shell entry. false if exe can not be read
+    bool ps1_sideload_exe(ps1_t*, const str_t&);
+
+    /*
+    * call whenever cpu stops. if it stopped on shell entry with work pending,
+    * boot snapshot is written, exe is loaded, cpu is resumed unless user breakpoint sits there and true is returned
+    */
+    bool ps1_poll_shell_entry(ps1_t*);
+
     /*
     * cpu
     * ram
     * gpu
     * dma
-    ? vram: not really needed since we will get new frame instantly after launch
+    * irq
+    * scheduler
+    * cdrom
+    ! vram is only part of file states, reading it back every frame would stall gl pipeline
     */
+    void ps1_save_state(ps1_t*, serializer_t*);
+    bool ps1_load_state(ps1_t*, serializer_t*);
+
+    /*
+    * file states go through mmap sink
+    * [magic] [version] [chunk count] then per chunk [tag] [flags] [raw size] [stored size] [adler32 of raw data] [data]
+    * ram and vram chunks are lz compressed. chunks are decoded and verified in parallel before any device is touched
+    * unknown chunks are skipped, version mismatch is refused. vram chunk is left out when vram backend keeps no pixels
+    *
+    * begin serializes devices and queues asynchronous vram readback
+    * poll compresses and writes file once readback is done, usually a frame later. wait forces it
+    */
+    void ps1_begin_save_state(ps1_t*, const str_t&);
+    void ps1_poll_save_state(ps1_t*, bool);
+
+    // * blocking begin and poll
     void ps1_save_state(ps1_t*, const str_t&);
-    void ps1_load_state(ps1_t*, const str_t&);
+    bool ps1_load_state(ps1_t*, const str_t&);
+
+    /*
+    * in-memory states without vram, vram_backup and vram_restore cover it on gpu side where needed
+    * buffer is cleared but keeps its capacity, so repeated saves do not allocate
+    * warm save or load is a copy of ram and sound ram at memory bandwidth, about 150 - 200 us
+    */
+    void ps1_save_state(ps1_t*, dyn_arr_t<uint8_t>*);
+    bool ps1_load_state(ps1_t*, const dyn_arr_t<uint8_t>*);
 }
\ No newline at end of file
@@ -7,13 +7,31 @@ namespace {
     constexpr uint32_t window_height = 864;
 
     GLFWwindow* window;
+
+    // * shadow copy of gl state. empty value means state is unknown
+    struct gl_state_t {
+        optional_t<uint32_t> read_framebuffer;
+        optional_t<uint32_t> draw_framebuffer;
+        optional_t<uint32_t> program;
+        optional_t<uint32_t> vertex_array;
+        optional_t<uint32_t> array_buffer;
+        optional_t<uint32_t> texture;
+        optional_t<ps1::render::rect_t> viewport;
+        optional_t<ps1::render::rect_t> scissor;
+        optional_t<bool> scissor_test;
+        optional_t<bool> stencil_test;
+        optional_t<ps1::render::mask_mode_t> mask_mode;
+        optional_t<ps1::render::blend_mode_t> blend_mode;
+    };
+
+    thread_local gl_state_t gl_state;
 }
 
 GLFWwindow* ps1::render::init() {
     glfwInit();
     ::window = glfwCreateWindow(window_width, window_height, "ps1", NULL, NULL);
     glfwMakeContextCurrent(::window);
-    glfwSwapInterval(0);
+    glfwSwapInterval(1); // * emulation is paced on its own thread
 
     ImGui::CreateContext();
     ImGui_ImplGlfw_InitForOpenGL(::window, true);
@@ -24,6 +42,8 @@ GLFWwindow* ps1::render::init() {
 
     glewInit();
 
+    invalidate_state();
+
     return ::window;
 }
 
@@ -36,6 +56,23 @@ void ps1::render::exit() {
     glfwTerminate();
 }
 
+GLFWwindow* ps1::render::make_shared_context() {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* context = glfwCreateWindow(1, 1, "ps1 emulation", NULL, ::window);
+    glfwDefaultWindowHints();
+
+    return context;
+}
+
+void ps1::render::destroy_context(GLFWwindow* context) {
+    glfwDestroyWindow(context);
+}
+
+void ps1::render::bind_context(GLFWwindow* context) {
+    glfwMakeContextCurrent(context);
+    invalidate_state();
+}
+
 void ps1::render::begin_frame() {
     glfwPollEvents();
         
@@ -43,14 +80,23 @@ void ps1::render::begin_frame() {
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
-    glViewport(0, 0, window_width, window_height);
+    bind_framebuffer(0);
+    set_viewport({ 0, 0, window_width, window_height });
+    set_scissor_test(false);
+
     glClearColor(0.f, 0.f, 0.f, 1.f);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void ps1::render::end_frame() {
+    // * imgui renders into currently bound framebuffer and restores rest of the state afterwards
+    bind_framebuffer(0);
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
+
+void ps1::render::present() {
     glfwSwapBuffers(::window);
 }
 
@@ -118,5 +164,158 @@ void ps1::render::make_shader(const char* vertex_shader_path, const char* fragme
 }
 
 void ps1::render::use_shader(uint32_t type) {
-    glUseProgram(shaders[type]);
+    uint32_t program = shaders[type];
+
+    if (gl_state.program == program) return;
+
+    glUseProgram(program);
+    gl_state.program = program;
+}
+
+void ps1::render::invalidate_state() {
+    gl_state = {};
+}
+
+void ps1::render::bind_framebuffer(uint32_t fbo) {
+    if (gl_state.read_framebuffer == fbo && gl_state.draw_framebuffer == fbo) return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    gl_state.read_framebuffer = fbo;
+    gl_state.draw_framebuffer = fbo;
+}
+
+void ps1::render::bind_read_framebuffer(uint32_t fbo) {
+    if (gl_state.read_framebuffer == fbo) return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    gl_state.read_framebuffer = fbo;
+}
+
+void ps1::render::bind_draw_framebuffer(uint32_t fbo) {
+    if (gl_state.draw_framebuffer == fbo) return;
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+    gl_state.draw_framebuffer = fbo;
+}
+
+void ps1::render::bind_vertex_array(uint32_t vao) {
+    if (gl_state.vertex_array == vao) return;
+
+    glBindVertexArray(vao);
+    gl_state.vertex_array = vao;
+}
+
+void ps1::render::bind_array_buffer(uint32_t vbo) {
+    if (gl_state.array_buffer == vbo) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    gl_state.array_buffer = vbo;
+}
+
+void ps1::render::bind_texture(uint32_t tbo) {
+    if (gl_state.texture == tbo) return;
+
+    glBindTexture(GL_TEXTURE_2D, tbo);
+    gl_state.texture = tbo;
+}
+
+void ps1::render::set_viewport(rect_t rect) {
+    if (gl_state.viewport == rect) return;
+
+    glViewport(rect.x, rect.y, rect.width, rect.height);
+    gl_state.viewport = rect;
+}
+
+void ps1::render::set_scissor(rect_t rect) {
+    if (gl_state.scissor == rect) return;
+
+    glScissor(rect.x, rect.y, rect.width, rect.height);
+    gl_state.scissor = rect;
+}
+
+void ps1::render::set_scissor_test(bool enabled) {
+    if (gl_state.scissor_test == enabled) return;
+
+    if (enabled) {
+        glEnable(GL_SCISSOR_TEST);
+    } else {
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+    gl_state.scissor_test = enabled;
+}
+
+void ps1::render::set_stencil_test(bool enabled) {
+    if (gl_state.stencil_test == enabled) return;
+
+    if (enabled) {
+        glEnable(GL_STENCIL_TEST);
+    } else {
+        glDisable(GL_STENCIL_TEST);
+    }
+
+    gl_state.stencil_test = enabled;
+}
+
+/*
+* drawn pixel always gets mask bit replaced with set_mask value
+* with mask test stencil must be 0: GL_EQUAL against 0, or GL_GREATER when 1 is written
+*/
+void ps1::render::set_mask_mode(mask_mode_t mode) {
+    if (gl_state.mask_mode == mode) return;
+
+    GLenum func = !mode.test_mask ? GL_ALWAYS : mode.set_mask ? GL_GREATER : GL_EQUAL;
+
+    glStencilFunc(func, mode.set_mask, 0x1);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+    gl_state.mask_mode = mode;
+}
+
+void ps1::render::set_blend_mode(blend_mode_t mode) {
+    if (gl_state.blend_mode == mode) return;
+
+    switch (mode) {
+        case blend_mode_t::opaque: {
+            glDisable(GL_BLEND);
+
+            break;
+        }
+
+        case blend_mode_t::average: {
+            glEnable(GL_BLEND);
+            glBlendColor(0.f, 0.f, 0.f, .5f);
+            glBlendEquation(GL_FUNC_ADD);
+            glBlendFunc(GL_CONSTANT_ALPHA, GL_CONSTANT_ALPHA);
+
+            break;
+        }
+
+        case blend_mode_t::add: {
+            glEnable(GL_BLEND);
+            glBlendEquation(GL_FUNC_ADD);
+            glBlendFunc(GL_ONE, GL_ONE);
+
+            break;
+        }
+
+        case blend_mode_t::subtract: {
+            glEnable(GL_BLEND);
+            glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
+            glBlendFunc(GL_ONE, GL_ONE);
+
+            break;
+        }
+
+        case blend_mode_t::add_quarter: {
+            glEnable(GL_BLEND);
+            glBlendColor(0.f, 0.f, 0.f, .25f);
+            glBlendEquation(GL_FUNC_ADD);
+            glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE);
+
+            break;
+        }
+    }
+
+    gl_state.blend_mode = mode;
 }
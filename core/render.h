@@ -3,14 +3,67 @@
 #include "defs.h"
 
 namespace ps1::render {
+    struct rect_t {
+        int32_t x;
+        int32_t y;
+        int32_t width;
+        int32_t height;
+
+        bool operator==(const rect_t&) const = default;
+    };
+
+    enum struct blend_mode_t {
+        opaque,
+        average, // * B / 2 + F / 2
+        add, // * B + F
+        subtract, // * B - F
+        add_quarter, // * B + F / 4
+    };
+
+    // * vram mask bit is emulated with stencil bit 0
+    struct mask_mode_t {
+        bool set_mask; // * drawn pixels get mask bit
+        bool test_mask; // * pixels with mask bit are left untouched
+
+        bool operator==(const mask_mode_t&) const = default;
+    };
+
     GLFWwindow* init();
     void exit();
 
+    // * hidden context sharing objects with main window, used by emulation thread
+    GLFWwindow* make_shared_context();
+    void destroy_context(GLFWwindow*);
+    void bind_context(GLFWwindow*);
+
     void begin_frame();
     void end_frame();
+    void present();
 
     bool should_close();
 
     void make_shader(const char*, const char*, uint32_t);
     void use_shader(uint32_t);
+
+    /*
+    * gl state cache
+    * calls are forwarded to driver only when shadowed value changes
+    * anything that touches gl state directly must either restore it or invalidate the cache
+    * cache is per thread, same as current gl context
+    */
+    void invalidate_state();
+
+    void bind_framebuffer(uint32_t);
+    void bind_read_framebuffer(uint32_t);
+    void bind_draw_framebuffer(uint32_t);
+    void bind_vertex_array(uint32_t);
+    void bind_array_buffer(uint32_t);
+    void bind_texture(uint32_t);
+
+    void set_viewport(rect_t);
+    void set_scissor(rect_t);
+    void set_scissor_test(bool);
+    void set_stencil_test(bool);
+    void set_mask_mode(mask_mode_t);
+    void set_blend_mode(blend_mode_t);
 }
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "rewind.h"
+
+namespace {
+    // * literal runs end once this many unchanged bytes follow, shorter gaps are cheaper to keep inline
+    constexpr size_t min_zero_run = 8;
+
+    uint64_t load64(const uint8_t* ptr) {
+        uint64_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    void write_varint(dyn_arr_t<uint8_t>* out, size_t value) {
+        while (value >= 0x80) {
+            out->push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+
+        out->push_back((uint8_t)value);
+    }
+
+    size_t read_varint(const uint8_t* data, size_t* pos) {
+        size_t value = 0;
+        uint32_t shift = 0;
+
+        while (data[*pos] & 0x80) {
+            value |= (size_t)(data[(*pos)++] & 0x7f) << shift;
+            shift += 7;
+        }
+
+        value |= (size_t)data[(*pos)++] << shift;
+
+        return value;
+    }
+
+    /*
+    * xor of two equally sized states as sequence of
+    * [varint unchanged byte count] [varint changed byte count] [changed bytes xored]
+    */
+    void encode_delta(const uint8_t* a, const uint8_t* b, size_t size, dyn_arr_t<uint8_t>* out) {
+        out->clear();
+
+        size_t i = 0;
+
+        while (i < size) {
+            size_t zero_start = i;
+
+            while (i + sizeof(uint64_t) <= size && load64(a + i) == load64(b + i)) {
+                i += sizeof(uint64_t);
+            }
+
+            while (i < size && a[i] == b[i]) {
+                i++;
+            }
+
+            size_t literal_start = i;
+            size_t literal_end = size;
+            size_t equal_cnt = 0;
+
+            for (; i < size; i++) {
+                if (a[i] != b[i]) {
+                    equal_cnt = 0;
+                } else if (++equal_cnt == min_zero_run) {
+                    literal_end = i + 1 - min_zero_run;
+                    break;
+                }
+            }
+
+            i = literal_end;
+
+            write_varint(out, literal_start - zero_start);
+            write_varint(out, literal_end - literal_start);
+
+            for (size_t j = literal_start; j < literal_end; j++) {
+                out->push_back(a[j] ^ b[j]);
+            }
+        }
+
+        out->shrink_to_fit();
+    }
+
+    void apply_delta(uint8_t* state, const dyn_arr_t<uint8_t>& delta) {
+        size_t pos = 0;
+        size_t offset = 0;
+
+        while (pos < delta.size()) {
+            offset += read_varint(delta.data(), &pos);
+
+            size_t literal_size = read_varint(delta.data(), &pos);
+
+            for (size_t j = 0; j < literal_size; j++) {
+                state[offset + j] ^= delta[pos + j];
+            }
+
+            offset += literal_size;
+            pos += literal_size;
+        }
+    }
+
+    void update_counters(ps1::rewind_t* rewind) {
+        rewind->state_cnt = rewind->deltas.size() + (rewind->latest.empty() ? 0 : 1);
+        rewind->total_bytes = rewind->delta_bytes + rewind->latest.size();
+    }
+
+    void work(ps1::rewind_t* rewind) {
+        dyn_arr_t<uint8_t> state;
+        uint32_t generation;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(rewind->pending_mutex);
+                rewind->cv.wait(lock, [rewind] { return rewind->quit || rewind->has_pending; });
+
+                if (rewind->quit) break;
+
+                state.swap(rewind->pending);
+                generation = rewind->pending_generation;
+                rewind->has_pending = false;
+            }
+
+            std::lock_guard<std::mutex> lock(rewind->history_mutex);
+
+            // * pop or clear ran after capture was taken off pending, it must not land on top of their result
+            if (generation != rewind->generation) continue;
+
+            // * state layout changed, older history can not be reconstructed anymore
+            if (rewind->latest.size() != state.size()) {
+                rewind->deltas.clear();
+                rewind->delta_bytes = 0;
+                rewind->latest.swap(state);
+
+                update_counters(rewind);
+
+                continue;
+            }
+
+            ps1::rewind_delta_t delta;
+
+            encode_delta(rewind->latest.data(), state.data(), state.size(), &delta.data);
+
+            rewind->delta_bytes += delta.data.size();
+            rewind->deltas.emplace_back(std::move(delta));
+            rewind->latest.swap(state);
+
+            while (rewind->delta_bytes > rewind->max_bytes && !rewind->deltas.empty()) {
+                rewind->delta_bytes -= rewind->deltas.front().data.size();
+                rewind->deltas.pop_front();
+            }
+
+            update_counters(rewind);
+        }
+    }
+}
+
+void ps1::rewind_init(rewind_t* rewind, size_t max_bytes) {
+    rewind->quit = false;
+    rewind->has_pending = false;
+    rewind->pending_generation = 0;
+    rewind->generation = 0;
+    rewind->delta_bytes = 0;
+    rewind->max_bytes = max_bytes;
+    rewind->state_cnt = 0;
+    rewind->total_bytes = 0;
+
+    rewind->thread = std::thread(work, rewind);
+}
+
+void ps1::rewind_exit(rewind_t* rewind) {
+    {
+        std::lock_guard<std::mutex> lock(rewind->pending_mutex);
+        rewind->quit = true;
+    }
+
+    rewind->cv.notify_one();
+    rewind->thread.join();
+
+    rewind->pending.clear();
+    rewind->latest.clear();
+    rewind->deltas.clear();
+}
+
+void ps1::rewind_push(rewind_t* rewind, dyn_arr_t<uint8_t>* state) {
+    {
+        std::lock_guard<std::mutex> lock(rewind->pending_mutex);
+
+        // * worker fell behind, unprocessed capture is replaced by newer one
+        rewind->pending.swap(*state);
+        rewind->pending_generation = rewind->generation;
+        rewind->has_pending = true;
+    }
+
+    rewind->cv.notify_one();
+}
+
+namespace {
+    // * capture newer than state being returned would break delta chain. one already taken by worker is dropped by generation check
+    void drop_pending(ps1::rewind_t* rewind) {
+        std::lock_guard<std::mutex> lock(rewind->pending_mutex);
+        rewind->has_pending = false;
+    }
+}
+
+bool ps1::rewind_pop(rewind_t* rewind, dyn_arr_t<uint8_t>* state) {
+    drop_pending(rewind);
+
+    std::lock_guard<std::mutex> lock(rewind->history_mutex);
+
+    rewind->generation++;
+
+    if (rewind->deltas.empty()) return false;
+
+    rewind_delta_t& delta = rewind->deltas.back();
+
+    apply_delta(rewind->latest.data(), delta.data);
+
+    rewind->delta_bytes -= delta.data.size();
+    rewind->deltas.pop_back();
+
+    update_counters(rewind);
+
+    *state = rewind->latest;
+
+    return true;
+}
+
+void ps1::rewind_clear(rewind_t* rewind) {
+    drop_pending(rewind);
+
+    std::lock_guard<std::mutex> lock(rewind->history_mutex);
+
+    rewind->generation++;
+
+    rewind->latest.clear();
+    rewind->deltas.clear();
+    rewind->delta_bytes = 0;
+
+    update_counters(rewind);
+}
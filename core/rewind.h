@@ -0,0 +1,58 @@
+#pragma once
+
+#include "defs.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+namespace ps1 {
+    // * run length encoded xor of two consecutive states. xor with newer state gives back older one
+    struct rewind_delta_t {
+        dyn_arr_t<uint8_t> data;
+    };
+
+    /*
+    * ring of past console states
+    * only newest state is kept whole, each older one is stored as delta against its successor
+    * deltas are built on worker thread, emulation thread only hands over copied state
+    */
+    struct rewind_t {
+        std::thread thread;
+
+        // * handoff from emulation thread, held only for buffer swaps
+        std::mutex pending_mutex;
+        std::condition_variable cv;
+        dyn_arr_t<uint8_t> pending; // * newest captured state not yet processed by worker
+        uint32_t pending_generation; // * generation pending was captured in
+        bool has_pending;
+        bool quit;
+
+        // * held by worker while delta is encoded, pop and clear wait on it
+        std::mutex history_mutex;
+        dyn_arr_t<uint8_t> latest; // * newest processed state, base for every delta
+        std::deque<rewind_delta_t> deltas; // * oldest first
+        size_t delta_bytes;
+        size_t max_bytes; // * oldest deltas are dropped past this budget
+
+        // * bumped by pop and clear under history lock. captures from older generation belong to abandoned timeline
+        std::atomic<uint32_t> generation;
+
+        // * read by ui without lock
+        std::atomic<uint32_t> state_cnt;
+        std::atomic<size_t> total_bytes;
+    };
+
+    void rewind_init(rewind_t*, size_t);
+    void rewind_exit(rewind_t*);
+
+    // * hand over captured state, buffer is swapped with internal one and may hold stale data afterwards
+    void rewind_push(rewind_t*, dyn_arr_t<uint8_t>*);
+
+    // * step one state back. false if there is nothing older than current state
+    bool rewind_pop(rewind_t*, dyn_arr_t<uint8_t>*);
+
+    void rewind_clear(rewind_t*);
+}
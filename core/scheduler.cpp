@@ -0,0 +1,83 @@
+#include "scheduler.h"
+#include "serializer.h"
+
+#include <algorithm>
+
+namespace {
+    void update_next(ps1::scheduler_t* scheduler) {
+        scheduler->next = ps1::EVENT_IDLE;
+
+        for (auto& slot : scheduler->slots) {
+            scheduler->next = std::min(scheduler->next, slot.deadline);
+        }
+    }
+}
+
+void ps1::scheduler_init(scheduler_t* scheduler, const uint64_t* clock) {
+    scheduler->clock = clock;
+
+    for (auto& slot : scheduler->slots) {
+        slot.deadline = EVENT_IDLE;
+    }
+
+    scheduler->next = EVENT_IDLE;
+}
+
+void ps1::scheduler_register(scheduler_t* scheduler, event_slot_t id, event_fn_t fn, void* device) {
+    scheduler->slots[(size_t)id].fn = fn;
+    scheduler->slots[(size_t)id].device = device;
+}
+
+void ps1::scheduler_schedule(scheduler_t* scheduler, event_slot_t id, uint64_t delay) {
+    uint64_t deadline = *scheduler->clock + delay;
+
+    scheduler->slots[(size_t)id].deadline = deadline;
+    scheduler->next = std::min(scheduler->next, deadline);
+}
+
+void ps1::scheduler_cancel(scheduler_t* scheduler, event_slot_t id) {
+    scheduler->slots[(size_t)id].deadline = EVENT_IDLE;
+
+    update_next(scheduler);
+}
+
+bool ps1::scheduler_is_scheduled(scheduler_t* scheduler, event_slot_t id) {
+    return scheduler->slots[(size_t)id].deadline != EVENT_IDLE;
+}
+
+void ps1::scheduler_run(scheduler_t* scheduler) {
+    uint64_t now = *scheduler->clock;
+
+    // * event may schedule itself or other slots again, slot is cleared before call
+    for (auto& slot : scheduler->slots) {
+        if (slot.deadline > now) continue;
+
+        slot.deadline = EVENT_IDLE;
+        slot.fn(slot.device);
+    }
+
+    update_next(scheduler);
+}
+
+void ps1::scheduler_save_state(scheduler_t* scheduler, serializer_t* serializer) {
+    uint64_t now = *scheduler->clock;
+
+    for (auto& slot : scheduler->slots) {
+        uint64_t remaining = slot.deadline == EVENT_IDLE ? EVENT_IDLE : slot.deadline - std::min(slot.deadline, now);
+
+        serializer_write(serializer, &remaining, sizeof(remaining));
+    }
+}
+
+void ps1::scheduler_load_state(scheduler_t* scheduler, serializer_t* serializer) {
+    uint64_t now = *scheduler->clock;
+
+    for (auto& slot : scheduler->slots) {
+        uint64_t remaining;
+        serializer_read(serializer, &remaining, sizeof(remaining));
+
+        slot.deadline = remaining == EVENT_IDLE ? EVENT_IDLE : now + remaining;
+    }
+
+    update_next(scheduler);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "defs.h"
+
+namespace ps1 {
+    // * one pending event per slot, rescheduling a slot replaces its deadline
+    enum struct event_slot_t : uint32_t {
+        vblank, // * start of vertical blank, once per frame
+        cdrom_command, // * command acknowledge
+        cdrom_complete, // * second response of slow commands
+        cdrom_drive, // * sector reads
+        cdrom_irq, // * queued response after previous one was acknowledged
+        spu, // * hands batch of generated samples to audio ring
+        count
+    };
+
+    typedef void (*event_fn_t)(void*); // * device
+
+    constexpr uint64_t EVENT_IDLE = UINT64_MAX;
+
+    /*
+    * devices ask to be called back after given number of cpu cycles
+    * cpu compares its cycle counter against earliest deadline once per instruction
+    */
+    struct scheduler_t {
+        const uint64_t* clock; // * cpu cycle counter
+        struct slot_t {
+            uint64_t deadline;
+            event_fn_t fn;
+            void* device;
+        };
+
+        slot_t slots[(size_t)event_slot_t::count];
+        uint64_t next; // * earliest deadline
+    };
+
+    void scheduler_init(scheduler_t*, const uint64_t*);
+
+    void scheduler_register(scheduler_t*, event_slot_t, event_fn_t, void*);
+
+    // * deadline is given in cycles from now
+    void scheduler_schedule(scheduler_t*, event_slot_t, uint64_t);
+    void scheduler_cancel(scheduler_t*, event_slot_t);
+    bool scheduler_is_scheduled(scheduler_t*, event_slot_t);
+
+    // * fires every event that is due
+    void scheduler_run(scheduler_t*);
+
+    // * deadlines are stored relative to clock, cpu cycle counter is not part of states
+    void scheduler_save_state(scheduler_t*, serializer_t*);
+    void scheduler_load_state(scheduler_t*, serializer_t*);
+}
@@ -0,0 +1,324 @@
+#include "serializer.h"
+
+#include <algorithm>
+
+#if defined(PS1_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr size_t mmap_initial_size = 4 * 1024 * 1024;
+
+    void reset(ps1::serializer_t* serializer, ps1::serializer_mode_t mode, ps1::serializer_sink_t sink) {
+        serializer->mode = mode;
+        serializer->sink = sink;
+        serializer->offset = 0;
+        serializer->failed = false;
+
+        serializer->buffer = nullptr;
+        serializer->read_data = nullptr;
+        serializer->read_size = 0;
+
+        serializer->file = nullptr;
+
+        serializer->mapped = nullptr;
+        serializer->mapped_size = 0;
+        serializer->handle = -1;
+        serializer->mapping = 0;
+    }
+
+#if defined(PS1_WINDOWS)
+    bool map(ps1::serializer_t* serializer, size_t size) {
+        DWORD protect = serializer->mode == ps1::serializer_mode_t::write ? PAGE_READWRITE : PAGE_READONLY;
+        DWORD access = serializer->mode == ps1::serializer_mode_t::write ? FILE_MAP_WRITE : FILE_MAP_READ;
+
+        HANDLE mapping = CreateFileMappingA((HANDLE)serializer->handle, nullptr, protect, (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+        if (!mapping) return false;
+
+        void* view = MapViewOfFile(mapping, access, 0, 0, size);
+        if (!view) {
+            CloseHandle(mapping);
+
+            return false;
+        }
+
+        serializer->mapping = (intptr_t)mapping;
+        serializer->mapped = (uint8_t*)view;
+        serializer->mapped_size = size;
+
+        return true;
+    }
+
+    void unmap(ps1::serializer_t* serializer) {
+        if (serializer->mapped) UnmapViewOfFile(serializer->mapped);
+        if (serializer->mapping) CloseHandle((HANDLE)serializer->mapping);
+
+        serializer->mapped = nullptr;
+        serializer->mapping = 0;
+    }
+#else
+    bool map(ps1::serializer_t* serializer, size_t size) {
+        bool writable = serializer->mode == ps1::serializer_mode_t::write;
+
+        if (writable && ftruncate((int)serializer->handle, size) != 0) return false;
+
+        void* view = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, writable ? MAP_SHARED : MAP_PRIVATE, (int)serializer->handle, 0);
+        if (view == MAP_FAILED) return false;
+
+        serializer->mapped = (uint8_t*)view;
+        serializer->mapped_size = size;
+
+        return true;
+    }
+
+    void unmap(ps1::serializer_t* serializer) {
+        if (serializer->mapped) munmap(serializer->mapped, serializer->mapped_size);
+
+        serializer->mapped = nullptr;
+    }
+#endif
+
+    // * writer mapping grows geometrically, file is truncated to written size on close
+    bool ensure_mapped(ps1::serializer_t* serializer, size_t size) {
+        if (size <= serializer->mapped_size) return true;
+
+        size_t new_size = std::max(serializer->mapped_size * 2, std::max(size, mmap_initial_size));
+
+        unmap(serializer);
+
+        return map(serializer, new_size);
+    }
+}
+
+void ps1::serializer_open_memory(serializer_t* serializer, dyn_arr_t<uint8_t>* buffer) {
+    reset(serializer, serializer_mode_t::write, serializer_sink_t::memory);
+
+    serializer->buffer = buffer;
+}
+
+void ps1::serializer_open_memory(serializer_t* serializer, const uint8_t* data, size_t size) {
+    reset(serializer, serializer_mode_t::read, serializer_sink_t::memory);
+
+    serializer->read_data = data;
+    serializer->read_size = size;
+}
+
+bool ps1::serializer_open_file(serializer_t* serializer, const str_t& path, serializer_mode_t mode) {
+    reset(serializer, mode, serializer_sink_t::file);
+
+    serializer->file = fopen(path.c_str(), mode == serializer_mode_t::write ? "wb" : "rb");
+    serializer->failed = !serializer->file;
+
+    return serializer->file;
+}
+
+bool ps1::serializer_open_mmap(serializer_t* serializer, const str_t& path, serializer_mode_t mode) {
+    reset(serializer, mode, serializer_sink_t::mmap);
+
+    bool writable = mode == serializer_mode_t::write;
+
+#if defined(PS1_WINDOWS)
+    HANDLE file = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr, writable ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        serializer->failed = true;
+
+        return false;
+    }
+
+    serializer->handle = (intptr_t)file;
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    size_t size = writable ? mmap_initial_size : (size_t)file_size.QuadPart;
+#else
+    int fd = open(path.c_str(), writable ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+
+    if (fd < 0) {
+        serializer->failed = true;
+
+        return false;
+    }
+
+    serializer->handle = fd;
+
+    struct stat file_stat;
+    fstat(fd, &file_stat);
+    size_t size = writable ? mmap_initial_size : (size_t)file_stat.st_size;
+#endif
+
+    // * empty file can not be mapped, reads will just fail
+    if (size > 0 && !map(serializer, size)) {
+        serializer->failed = true;
+    }
+
+    return !serializer->failed;
+}
+
+bool ps1::serializer_close(serializer_t* serializer) {
+    switch (serializer->sink) {
+        case serializer_sink_t::memory: {
+            break;
+        }
+
+        case serializer_sink_t::file: {
+            if (serializer->file && fclose(serializer->file) != 0) {
+                serializer->failed = true;
+            }
+
+            break;
+        }
+
+        case serializer_sink_t::mmap: {
+            unmap(serializer);
+
+#if defined(PS1_WINDOWS)
+            if (serializer->handle != -1) {
+                if (serializer->mode == serializer_mode_t::write) {
+                    LARGE_INTEGER end;
+                    end.QuadPart = serializer->offset;
+                    SetFilePointerEx((HANDLE)serializer->handle, end, nullptr, FILE_BEGIN);
+                    SetEndOfFile((HANDLE)serializer->handle);
+                }
+
+                CloseHandle((HANDLE)serializer->handle);
+            }
+#else
+            if (serializer->handle != -1) {
+                if (serializer->mode == serializer_mode_t::write && ftruncate((int)serializer->handle, serializer->offset) != 0) {
+                    serializer->failed = true;
+                }
+
+                close((int)serializer->handle);
+            }
+#endif
+
+            break;
+        }
+    }
+
+    bool ok = !serializer->failed;
+
+    reset(serializer, serializer->mode, serializer->sink);
+
+    return ok;
+}
+
+void ps1::serializer_write(serializer_t* serializer, const void* data, size_t size) {
+    ASSERT(serializer->mode == serializer_mode_t::write, "serializer is opened for reading");
+
+    if (serializer->failed) return;
+
+    switch (serializer->sink) {
+        case serializer_sink_t::memory: {
+            // * range insert copies straight into reserved capacity, resize would zero fill it first
+            serializer->buffer->insert(serializer->buffer->end(), (const uint8_t*)data, (const uint8_t*)data + size);
+
+            break;
+        }
+
+        case serializer_sink_t::file: {
+            serializer->failed = fwrite(data, 1, size, serializer->file) != size;
+
+            break;
+        }
+
+        case serializer_sink_t::mmap: {
+            if (!ensure_mapped(serializer, serializer->offset + size)) {
+                serializer->failed = true;
+
+                return;
+            }
+
+            memcpy(serializer->mapped + serializer->offset, data, size);
+
+            break;
+        }
+    }
+
+    serializer->offset += size;
+}
+
+void ps1::serializer_write32(serializer_t* serializer, uint32_t value) {
+    serializer_write(serializer, &value, sizeof(value));
+}
+
+void ps1::serializer_read(serializer_t* serializer, void* data, size_t size) {
+    ASSERT(serializer->mode == serializer_mode_t::read, "serializer is opened for writing");
+
+    if (serializer->failed) {
+        memset(data, 0, size);
+
+        return;
+    }
+
+    switch (serializer->sink) {
+        case serializer_sink_t::memory: {
+            serializer->failed = serializer->offset + size > serializer->read_size;
+
+            if (!serializer->failed) {
+                memcpy(data, serializer->read_data + serializer->offset, size);
+            }
+
+            break;
+        }
+
+        case serializer_sink_t::file: {
+            serializer->failed = fread(data, 1, size, serializer->file) != size;
+
+            break;
+        }
+
+        case serializer_sink_t::mmap: {
+            serializer->failed = serializer->offset + size > serializer->mapped_size;
+
+            if (!serializer->failed) {
+                memcpy(data, serializer->mapped + serializer->offset, size);
+            }
+
+            break;
+        }
+    }
+
+    if (serializer->failed) {
+        memset(data, 0, size);
+
+        return;
+    }
+
+    serializer->offset += size;
+}
+
+uint32_t ps1::serializer_read32(serializer_t* serializer) {
+    uint32_t value;
+    serializer_read(serializer, &value, sizeof(value));
+    return value;
+}
+
+const uint8_t* ps1::serializer_read_view(serializer_t* serializer, size_t size) {
+    ASSERT(serializer->mode == serializer_mode_t::read, "serializer is opened for writing");
+    ASSERT(serializer->sink != serializer_sink_t::file, "file sink can not be viewed in place");
+
+    if (serializer->failed) return nullptr;
+
+    const uint8_t* data = serializer->sink == serializer_sink_t::memory ? serializer->read_data : serializer->mapped;
+    size_t data_size = serializer->sink == serializer_sink_t::memory ? serializer->read_size : serializer->mapped_size;
+
+    if (serializer->offset + size > data_size) {
+        serializer->failed = true;
+
+        return nullptr;
+    }
+
+    const uint8_t* view = data + serializer->offset;
+    serializer->offset += size;
+
+    return view;
+}
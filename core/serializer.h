@@ -0,0 +1,61 @@
+#pragma once
+
+#include "defs.h"
+
+namespace ps1 {
+    enum struct serializer_mode_t {
+        write,
+        read
+    };
+
+    enum struct serializer_sink_t {
+        memory, // * growable byte buffer owned by caller
+        file, // * buffered stdio stream
+        mmap // * file mapped into memory, grown on demand while writing
+    };
+
+    /*
+    * byte stream used by device save and load functions
+    * no global state, any number of serializers can be open at once on different threads
+    */
+    struct serializer_t {
+        serializer_mode_t mode;
+        serializer_sink_t sink;
+
+        size_t offset; // * bytes written or read so far
+        bool failed; // * set on short read or write, sticky until close
+
+        // * memory sink
+        dyn_arr_t<uint8_t>* buffer;
+        const uint8_t* read_data;
+        size_t read_size;
+
+        // * file sink
+        FILE* file;
+
+        // * mmap sink
+        uint8_t* mapped;
+        size_t mapped_size;
+        intptr_t handle; // * file descriptor or HANDLE
+        intptr_t mapping; // * HANDLE of file mapping, unused on posix
+    };
+
+    // * writer appends to buffer, reader starts at its beginning
+    void serializer_open_memory(serializer_t*, dyn_arr_t<uint8_t>*);
+    void serializer_open_memory(serializer_t*, const uint8_t*, size_t);
+
+    bool serializer_open_file(serializer_t*, const str_t&, serializer_mode_t);
+    bool serializer_open_mmap(serializer_t*, const str_t&, serializer_mode_t);
+
+    // * returns false if any read or write came up short
+    bool serializer_close(serializer_t*);
+
+    void serializer_write(serializer_t*, const void*, size_t);
+    void serializer_write32(serializer_t*, uint32_t);
+
+    void serializer_read(serializer_t*, void*, size_t);
+    uint32_t serializer_read32(serializer_t*);
+
+    // * next bytes in place without copy, memory and mmap readers only. valid until close, null on short read
+    const uint8_t* serializer_read_view(serializer_t*, size_t);
+}
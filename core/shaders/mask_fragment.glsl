@@ -0,0 +1,13 @@
+#version 330
+
+uniform usampler2D mask;
+
+out vec4 frag_color;
+
+void main() {
+    if ((texelFetch(mask, ivec2(gl_FragCoord.xy), 0).r & 1u) == 0u) {
+        discard;
+    }
+
+    frag_color = vec4(0.0);
+}
\ No newline at end of file
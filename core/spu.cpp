@@ -0,0 +1,809 @@
+#include "spu.h"
+#include "irq.h"
+#include "scheduler.h"
+#include "audio.h"
+#include "serializer.h"
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+    // * byte offsets from 0x1F801C00
+    constexpr uint32_t voice_volume_left = 0x0;
+    constexpr uint32_t voice_volume_right = 0x2;
+    constexpr uint32_t voice_pitch = 0x4;
+    constexpr uint32_t voice_start = 0x6;
+    constexpr uint32_t voice_adsr_low = 0x8;
+    constexpr uint32_t voice_adsr_high = 0xA;
+    constexpr uint32_t voice_envelope = 0xC;
+    constexpr uint32_t voice_repeat = 0xE;
+
+    constexpr uint32_t main_volume_left = 0x180;
+    constexpr uint32_t main_volume_right = 0x182;
+    constexpr uint32_t reverb_volume_left = 0x184;
+    constexpr uint32_t reverb_volume_right = 0x186;
+    constexpr uint32_t key_on = 0x188;
+    constexpr uint32_t key_off = 0x18C;
+    constexpr uint32_t pitch_mod = 0x190;
+    constexpr uint32_t noise_on = 0x194;
+    constexpr uint32_t reverb_on = 0x198;
+    constexpr uint32_t voice_endx = 0x19C;
+    constexpr uint32_t reverb_base = 0x1A2;
+    constexpr uint32_t irq_addr = 0x1A4;
+    constexpr uint32_t transfer_addr = 0x1A6;
+    constexpr uint32_t transfer_fifo = 0x1A8;
+    constexpr uint32_t control = 0x1AA;
+    constexpr uint32_t status = 0x1AE;
+    constexpr uint32_t current_main_volume = 0x1B8;
+    constexpr uint32_t voice_current_volume = 0x200;
+
+    // * reverb configuration, 0x1DC0 - 0x1E00
+    constexpr uint32_t rev_d_apf1 = 0x1C0;
+    constexpr uint32_t rev_d_apf2 = 0x1C2;
+    constexpr uint32_t rev_v_iir = 0x1C4;
+    constexpr uint32_t rev_v_comb1 = 0x1C6;
+    constexpr uint32_t rev_v_comb2 = 0x1C8;
+    constexpr uint32_t rev_v_comb3 = 0x1CA;
+    constexpr uint32_t rev_v_comb4 = 0x1CC;
+    constexpr uint32_t rev_v_wall = 0x1CE;
+    constexpr uint32_t rev_v_apf1 = 0x1D0;
+    constexpr uint32_t rev_v_apf2 = 0x1D2;
+    constexpr uint32_t rev_m_lsame = 0x1D4;
+    constexpr uint32_t rev_m_rsame = 0x1D6;
+    constexpr uint32_t rev_m_lcomb1 = 0x1D8;
+    constexpr uint32_t rev_m_rcomb1 = 0x1DA;
+    constexpr uint32_t rev_m_lcomb2 = 0x1DC;
+    constexpr uint32_t rev_m_rcomb2 = 0x1DE;
+    constexpr uint32_t rev_d_lsame = 0x1E0;
+    constexpr uint32_t rev_d_rsame = 0x1E2;
+    constexpr uint32_t rev_m_ldiff = 0x1E4;
+    constexpr uint32_t rev_m_rdiff = 0x1E6;
+    constexpr uint32_t rev_m_lcomb3 = 0x1E8;
+    constexpr uint32_t rev_m_rcomb3 = 0x1EA;
+    constexpr uint32_t rev_m_lcomb4 = 0x1EC;
+    constexpr uint32_t rev_m_rcomb4 = 0x1EE;
+    constexpr uint32_t rev_d_ldiff = 0x1F0;
+    constexpr uint32_t rev_d_rdiff = 0x1F2;
+    constexpr uint32_t rev_m_lapf1 = 0x1F4;
+    constexpr uint32_t rev_m_rapf1 = 0x1F6;
+    constexpr uint32_t rev_m_lapf2 = 0x1F8;
+    constexpr uint32_t rev_m_rapf2 = 0x1FA;
+    constexpr uint32_t rev_v_lin = 0x1FC;
+    constexpr uint32_t rev_v_rin = 0x1FE;
+
+    // * spucnt bits
+    constexpr uint16_t control_enable = 0x8000;
+    constexpr uint16_t control_unmute = 0x4000;
+    constexpr uint16_t control_reverb = 0x0080;
+    constexpr uint16_t control_irq = 0x0040;
+
+    // * adpcm block flags
+    constexpr uint32_t block_loop_end = 0x1;
+    constexpr uint32_t block_loop_repeat = 0x2;
+    constexpr uint32_t block_loop_start = 0x4;
+
+    constexpr int32_t adpcm_pos[5] = { 0, 60, 115, 98, 122 };
+    constexpr int32_t adpcm_neg[5] = { 0, 0, -52, -55, -60 };
+
+    constexpr uint32_t ram_mask = ps1::SPU_RAM_SIZE - 1;
+
+    /*
+    * hardware interpolation table, entry i weights sample (512 - i) / 256 samples away from output position
+    * four weights of one phase sum to just under 0x8000, so output never exceeds input range
+    */
+    constexpr int16_t gauss[512] = {
+        -0x001, -0x001, -0x001, -0x001, -0x001, -0x001, -0x001, -0x001,
+        -0x001, -0x001, -0x001, -0x001, -0x001, -0x001, -0x001, -0x001,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0001,
+        0x0001, 0x0001, 0x0001, 0x0002, 0x0002, 0x0002, 0x0003, 0x0003,
+        0x0003, 0x0004, 0x0004, 0x0005, 0x0005, 0x0006, 0x0007, 0x0007,
+        0x0008, 0x0009, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E,
+        0x000F, 0x0010, 0x0011, 0x0012, 0x0013, 0x0015, 0x0016, 0x0018,
+        0x0019, 0x001B, 0x001C, 0x001E, 0x0020, 0x0021, 0x0023, 0x0025,
+        0x0027, 0x0029, 0x002C, 0x002E, 0x0030, 0x0033, 0x0035, 0x0038,
+        0x003A, 0x003D, 0x0040, 0x0043, 0x0046, 0x0049, 0x004D, 0x0050,
+        0x0054, 0x0057, 0x005B, 0x005F, 0x0063, 0x0067, 0x006B, 0x006F,
+        0x0074, 0x0078, 0x007D, 0x0082, 0x0087, 0x008C, 0x0091, 0x0096,
+        0x009C, 0x00A1, 0x00A7, 0x00AD, 0x00B3, 0x00BA, 0x00C0, 0x00C7,
+        0x00CD, 0x00D4, 0x00DB, 0x00E3, 0x00EA, 0x00F2, 0x00FA, 0x0101,
+        0x010A, 0x0112, 0x011B, 0x0123, 0x012C, 0x0135, 0x013F, 0x0148,
+        0x0152, 0x015C, 0x0166, 0x0171, 0x017B, 0x0186, 0x0191, 0x019C,
+        0x01A8, 0x01B4, 0x01C0, 0x01CC, 0x01D9, 0x01E5, 0x01F2, 0x0200,
+        0x020D, 0x021B, 0x0229, 0x0237, 0x0246, 0x0255, 0x0264, 0x0273,
+        0x0283, 0x0293, 0x02A3, 0x02B4, 0x02C4, 0x02D6, 0x02E7, 0x02F9,
+        0x030B, 0x031D, 0x0330, 0x0343, 0x0356, 0x036A, 0x037E, 0x0392,
+        0x03A7, 0x03BC, 0x03D1, 0x03E7, 0x03FC, 0x0413, 0x042A, 0x0441,
+        0x0458, 0x0470, 0x0488, 0x04A0, 0x04B9, 0x04D2, 0x04EC, 0x0506,
+        0x0520, 0x053B, 0x0556, 0x0572, 0x058E, 0x05AA, 0x05C7, 0x05E4,
+        0x0601, 0x061F, 0x063E, 0x065C, 0x067C, 0x069B, 0x06BB, 0x06DC,
+        0x06FD, 0x071E, 0x0740, 0x0762, 0x0784, 0x07A7, 0x07CB, 0x07EF,
+        0x0813, 0x0838, 0x085D, 0x0883, 0x08A9, 0x08D0, 0x08F7, 0x091E,
+        0x0946, 0x096F, 0x0998, 0x09C1, 0x09EB, 0x0A16, 0x0A40, 0x0A6C,
+        0x0A98, 0x0AC4, 0x0AF1, 0x0B1E, 0x0B4C, 0x0B7A, 0x0BA9, 0x0BD8,
+        0x0C07, 0x0C38, 0x0C68, 0x0C99, 0x0CCB, 0x0CFD, 0x0D30, 0x0D63,
+        0x0D97, 0x0DCB, 0x0E00, 0x0E35, 0x0E6B, 0x0EA1, 0x0ED7, 0x0F0F,
+        0x0F46, 0x0F7F, 0x0FB7, 0x0FF1, 0x102A, 0x1065, 0x109F, 0x10DB,
+        0x1116, 0x1153, 0x118F, 0x11CD, 0x120B, 0x1249, 0x1288, 0x12C7,
+        0x1307, 0x1347, 0x1388, 0x13C9, 0x140B, 0x144D, 0x1490, 0x14D4,
+        0x1517, 0x155C, 0x15A0, 0x15E6, 0x162C, 0x1672, 0x16B9, 0x1700,
+        0x1747, 0x1790, 0x17D8, 0x1821, 0x186B, 0x18B5, 0x1900, 0x194B,
+        0x1996, 0x19E2, 0x1A2E, 0x1A7B, 0x1AC8, 0x1B16, 0x1B64, 0x1BB3,
+        0x1C02, 0x1C51, 0x1CA1, 0x1CF1, 0x1D42, 0x1D93, 0x1DE5, 0x1E37,
+        0x1E89, 0x1EDC, 0x1F2F, 0x1F82, 0x1FD6, 0x202A, 0x207F, 0x20D4,
+        0x2129, 0x217F, 0x21D5, 0x222C, 0x2282, 0x22DA, 0x2331, 0x2389,
+        0x23E1, 0x2439, 0x2492, 0x24EB, 0x2545, 0x259E, 0x25F8, 0x2653,
+        0x26AD, 0x2708, 0x2763, 0x27BE, 0x281A, 0x2876, 0x28D2, 0x292E,
+        0x298B, 0x29E7, 0x2A44, 0x2AA1, 0x2AFF, 0x2B5C, 0x2BBA, 0x2C18,
+        0x2C76, 0x2CD4, 0x2D33, 0x2D91, 0x2DF0, 0x2E4F, 0x2EAE, 0x2F0D,
+        0x2F6C, 0x2FCC, 0x302B, 0x308B, 0x30EA, 0x314A, 0x31AA, 0x3209,
+        0x3269, 0x32C9, 0x3329, 0x3389, 0x33E9, 0x3449, 0x34A9, 0x3509,
+        0x3569, 0x35C9, 0x3629, 0x3689, 0x36E8, 0x3748, 0x37A8, 0x3807,
+        0x3867, 0x38C6, 0x3926, 0x3985, 0x39E4, 0x3A43, 0x3AA2, 0x3B00,
+        0x3B5F, 0x3BBD, 0x3C1B, 0x3C79, 0x3CD7, 0x3D35, 0x3D92, 0x3DEF,
+        0x3E4C, 0x3EA9, 0x3F05, 0x3F62, 0x3FBD, 0x4019, 0x4074, 0x40D0,
+        0x412A, 0x4185, 0x41DF, 0x4239, 0x4292, 0x42EB, 0x4344, 0x439C,
+        0x43F4, 0x444C, 0x44A3, 0x44FA, 0x4550, 0x45A6, 0x45FC, 0x4651,
+        0x46A6, 0x46FA, 0x474E, 0x47A1, 0x47F4, 0x4846, 0x4898, 0x48E9,
+        0x493A, 0x498A, 0x49D9, 0x4A29, 0x4A77, 0x4AC5, 0x4B13, 0x4B5F,
+        0x4BAC, 0x4BF7, 0x4C42, 0x4C8D, 0x4CD7, 0x4D20, 0x4D68, 0x4DB0,
+        0x4DF7, 0x4E3E, 0x4E84, 0x4EC9, 0x4F0E, 0x4F52, 0x4F95, 0x4FD7,
+        0x5019, 0x505A, 0x509A, 0x50DA, 0x5118, 0x5156, 0x5194, 0x51D0,
+        0x520C, 0x5247, 0x5281, 0x52BA, 0x52F3, 0x532A, 0x5361, 0x5397,
+        0x53CC, 0x5401, 0x5434, 0x5467, 0x5499, 0x54CA, 0x54FA, 0x5529,
+        0x5558, 0x5585, 0x55B2, 0x55DE, 0x5609, 0x5632, 0x565B, 0x5684,
+        0x56AB, 0x56D1, 0x56F6, 0x571B, 0x573E, 0x5761, 0x5782, 0x57A3,
+        0x57C3, 0x57E2, 0x57FF, 0x581C, 0x5838, 0x5853, 0x586D, 0x5886,
+        0x589E, 0x58B5, 0x58CB, 0x58E0, 0x58F4, 0x5907, 0x5919, 0x592A,
+        0x593A, 0x5949, 0x5958, 0x5965, 0x5971, 0x597C, 0x5986, 0x598F,
+        0x5997, 0x599E, 0x59A4, 0x59A9, 0x59AD, 0x59B0, 0x59B2, 0x59B3
+    };
+
+    int32_t saturate(int32_t value) {
+        return std::clamp(value, -0x8000, 0x7FFF);
+    }
+
+    uint16_t& reg(ps1::spu_t* spu, uint32_t offset) {
+        return spu->regs[offset >> 1];
+    }
+
+    // * voice bitmasks are split over two registers
+    uint32_t reg_mask(ps1::spu_t* spu, uint32_t offset) {
+        return reg(spu, offset) | ((uint32_t)reg(spu, offset + 2) << 16);
+    }
+
+    uint16_t& voice_reg(ps1::spu_t* spu, uint32_t voice, uint32_t offset) {
+        return spu->regs[(voice * 0x10 + offset) >> 1];
+    }
+
+    int16_t read_ram(ps1::spu_t* spu, uint32_t addr) {
+        int16_t value;
+        memcpy(&value, spu->ram + (addr & ram_mask & ~1), 2);
+
+        return value;
+    }
+
+    void write_ram(ps1::spu_t* spu, uint32_t addr, int16_t value) {
+        memcpy(spu->ram + (addr & ram_mask & ~1), &value, 2);
+    }
+
+    // * irq fires once when given range touches irq address, until game acknowledges it through spucnt
+    void check_irq(ps1::spu_t* spu, uint32_t addr, uint32_t size) {
+        if (!(reg(spu, control) & control_irq) || spu->irq_flag) return;
+
+        uint32_t target = reg(spu, irq_addr) * 8;
+
+        if (target >= addr && target < addr + size) {
+            spu->irq_flag = true;
+            ps1::irq_request(spu->irq, ps1::irq_line_t::spu);
+        }
+    }
+
+    struct envelope_t {
+        bool exponential;
+        bool decrease;
+        uint32_t shift;
+        int32_t step;
+    };
+
+    // * one envelope tick, level only changes once wait runs out
+    int32_t step_envelope(envelope_t envelope, int32_t level, uint32_t* wait) {
+        if (*wait > 0) {
+            (*wait)--;
+
+            return level;
+        }
+
+        uint32_t cycles = 1 << std::max(0, (int32_t)envelope.shift - 11);
+        int32_t step = envelope.step * (1 << std::max(0, 11 - (int32_t)envelope.shift));
+
+        if (envelope.exponential && !envelope.decrease && level > 0x6000) {
+            cycles *= 4;
+        }
+
+        if (envelope.exponential && envelope.decrease) {
+            step = step * level >> 15;
+        }
+
+        *wait = cycles - 1;
+
+        return std::clamp(level + step, 0, 0x7FFF);
+    }
+
+    void step_adsr(ps1::spu_t* spu, uint32_t voice) {
+        ps1::spu_voices_t* voices = &spu->voices;
+
+        uint16_t low = voice_reg(spu, voice, voice_adsr_low);
+        uint16_t high = voice_reg(spu, voice, voice_adsr_high);
+        int32_t& level = voices->envelope[voice];
+        uint32_t* wait = &voices->envelope_wait[voice];
+
+        switch (voices->phase[voice]) {
+            case ps1::spu_phase_t::attack: {
+                level = step_envelope({ (bool)(low >> 15), false, (low >> 10) & 0x1Fu, 7 - ((low >> 8) & 0x3) }, level, wait);
+
+                if (level >= 0x7FFF) {
+                    voices->phase[voice] = ps1::spu_phase_t::decay;
+                    *wait = 0;
+                }
+
+                break;
+            }
+
+            case ps1::spu_phase_t::decay: {
+                int32_t sustain_level = std::min(((low & 0xF) + 1) * 0x800, 0x7FFF);
+
+                level = step_envelope({ true, true, (low >> 4) & 0xFu, -8 }, level, wait);
+
+                if (level <= sustain_level) {
+                    voices->phase[voice] = ps1::spu_phase_t::sustain;
+                    *wait = 0;
+                }
+
+                break;
+            }
+
+            case ps1::spu_phase_t::sustain: {
+                bool decrease = (high >> 14) & 1;
+                int32_t step = decrease ? -8 + ((high >> 6) & 0x3) : 7 - ((high >> 6) & 0x3);
+
+                level = step_envelope({ (bool)(high >> 15), decrease, (high >> 8) & 0x1Fu, step }, level, wait);
+
+                break;
+            }
+
+            case ps1::spu_phase_t::release: {
+                level = step_envelope({ (bool)((high >> 5) & 1), true, high & 0x1Fu, -8 }, level, wait);
+
+                if (level == 0) {
+                    voices->phase[voice] = ps1::spu_phase_t::off;
+                    spu->active &= ~(1u << voice);
+                }
+
+                break;
+            }
+
+            case ps1::spu_phase_t::off: {
+                break;
+            }
+        }
+    }
+
+    // * volume register in sweep mode moves current volume towards its limit
+    void step_sweep(uint16_t value, int32_t* volume, uint32_t* wait) {
+        if (!(value & 0x8000)) return;
+
+        bool decrease = (value >> 13) & 1;
+        int32_t step = decrease ? -8 + (value & 0x3) : 7 - (value & 0x3);
+
+        *volume = step_envelope({ (bool)((value >> 14) & 1), decrease, (value >> 2) & 0x1Fu, step }, std::abs(*volume), wait);
+    }
+
+    // * decodes block at voice address into decoded samples, last samples of previous block become history
+    void decode_block(ps1::spu_t* spu, uint32_t voice) {
+        ps1::spu_voices_t* voices = &spu->voices;
+
+        uint32_t addr = voices->addr[voice] & ram_mask & ~0xF;
+        const uint8_t* block = spu->ram + addr;
+
+        check_irq(spu, addr, 16);
+
+        uint32_t shift = block[0] & 0xF;
+        uint32_t filter = std::min((block[0] >> 4) & 0x7, 4);
+
+        // * reserved shift values behave like 9
+        if (shift > 12) shift = 9;
+
+        voices->flags[voice] = block[1];
+
+        if (block[1] & block_loop_start) {
+            voices->repeat_addr[voice] = addr;
+        }
+
+        int16_t* decoded = voices->decoded[voice];
+        memcpy(decoded, decoded + ps1::SPU_BLOCK_SAMPLES, ps1::SPU_HISTORY_SAMPLES * sizeof(int16_t));
+
+        int32_t old = voices->adpcm_old[voice];
+        int32_t older = voices->adpcm_older[voice];
+
+        for (uint32_t i = 0; i < ps1::SPU_BLOCK_SAMPLES; i++) {
+            int32_t nibble = (block[2 + i / 2] >> ((i & 1) * 4)) & 0xF;
+            int32_t sample = (int16_t)(nibble << 12) >> shift;
+
+            sample = saturate(sample + ((old * adpcm_pos[filter] + older * adpcm_neg[filter] + 32) >> 6));
+
+            decoded[ps1::SPU_HISTORY_SAMPLES + i] = (int16_t)sample;
+
+            older = old;
+            old = sample;
+        }
+
+        voices->adpcm_old[voice] = old;
+        voices->adpcm_older[voice] = older;
+    }
+
+    // * flags of block just played decide where voice continues
+    void next_block(ps1::spu_t* spu, uint32_t voice) {
+        ps1::spu_voices_t* voices = &spu->voices;
+        uint32_t flags = voices->flags[voice];
+
+        if (flags & block_loop_end) {
+            spu->endx |= 1u << voice;
+            voices->addr[voice] = voices->repeat_addr[voice];
+
+            // * end without repeat silences voice right away
+            if (!(flags & block_loop_repeat)) {
+                voices->phase[voice] = ps1::spu_phase_t::release;
+                voices->envelope[voice] = 0;
+            }
+        } else {
+            voices->addr[voice] += 16;
+        }
+
+        decode_block(spu, voice);
+    }
+
+    void start_voice(ps1::spu_t* spu, uint32_t voice) {
+        ps1::spu_voices_t* voices = &spu->voices;
+
+        voices->addr[voice] = voice_reg(spu, voice, voice_start) * 8;
+        voices->counter[voice] = 0;
+        voices->adpcm_old[voice] = 0;
+        voices->adpcm_older[voice] = 0;
+        memset(voices->decoded[voice], 0, sizeof(voices->decoded[voice]));
+
+        voices->phase[voice] = ps1::spu_phase_t::attack;
+        voices->envelope[voice] = 0;
+        voices->envelope_wait[voice] = 0;
+
+        spu->endx &= ~(1u << voice);
+        spu->active |= 1u << voice;
+
+        decode_block(spu, voice);
+    }
+
+    void stop_voice(ps1::spu_t* spu, uint32_t voice) {
+        if (spu->voices.phase[voice] == ps1::spu_phase_t::off) return;
+
+        spu->voices.phase[voice] = ps1::spu_phase_t::release;
+        spu->voices.envelope_wait[voice] = 0;
+    }
+
+    void step_noise(ps1::spu_t* spu) {
+        uint16_t cnt = reg(spu, control);
+        int32_t step = ((cnt >> 8) & 0x3) + 4;
+        int32_t period = 0x20000 >> ((cnt >> 10) & 0xF);
+
+        spu->noise_timer -= step;
+
+        if (spu->noise_timer < 0) {
+            uint32_t level = (uint16_t)spu->noise_level;
+            uint32_t parity = ((level >> 15) ^ (level >> 12) ^ (level >> 11) ^ (level >> 10) ^ 1) & 1;
+
+            spu->noise_level = (int16_t)(level * 2 + parity);
+            spu->noise_timer += period;
+
+            if (spu->noise_timer < 0) {
+                spu->noise_timer += period;
+            }
+        }
+    }
+
+    // * reverb work area is a ring from base to end of sound ram, offsets are relative to current position
+    uint32_t reverb_address(ps1::spu_t* spu, int64_t offset) {
+        uint32_t base = reg(spu, reverb_base) * 8;
+        int64_t size = ps1::SPU_RAM_SIZE - base;
+        int64_t pos = ((int64_t)spu->reverb_addr - base + offset) % size;
+
+        return base + (uint32_t)(pos < 0 ? pos + size : pos);
+    }
+
+    int32_t reverb_read(ps1::spu_t* spu, uint32_t addr_reg, int32_t back = 0) {
+        return read_ram(spu, reverb_address(spu, (int64_t)reg(spu, addr_reg) * 8 - back));
+    }
+
+    int32_t reverb_read_delta(ps1::spu_t* spu, uint32_t addr_reg, uint32_t delta_reg) {
+        return read_ram(spu, reverb_address(spu, (int64_t)reg(spu, addr_reg) * 8 - (int64_t)reg(spu, delta_reg) * 8));
+    }
+
+    void reverb_write(ps1::spu_t* spu, uint32_t addr_reg, int32_t value) {
+        write_ram(spu, reverb_address(spu, (int64_t)reg(spu, addr_reg) * 8), (int16_t)saturate(value));
+    }
+
+    int32_t mul(int32_t value, uint32_t volume_reg, ps1::spu_t* spu) {
+        return value * (int16_t)reg(spu, volume_reg) >> 15;
+    }
+
+    // * same side and cross reflections, comb filter and two all pass filters
+    void run_reverb(ps1::spu_t* spu, int32_t in_left, int32_t in_right) {
+        bool write = reg(spu, control) & control_reverb;
+
+        int32_t left = mul(in_left, rev_v_lin, spu);
+        int32_t right = mul(in_right, rev_v_rin, spu);
+
+        if (write) {
+            int32_t lsame = reverb_read(spu, rev_m_lsame, 2);
+            int32_t rsame = reverb_read(spu, rev_m_rsame, 2);
+            int32_t ldiff = reverb_read(spu, rev_m_ldiff, 2);
+            int32_t rdiff = reverb_read(spu, rev_m_rdiff, 2);
+
+            reverb_write(spu, rev_m_lsame, mul(left + mul(reverb_read(spu, rev_d_lsame), rev_v_wall, spu) - lsame, rev_v_iir, spu) + lsame);
+            reverb_write(spu, rev_m_rsame, mul(right + mul(reverb_read(spu, rev_d_rsame), rev_v_wall, spu) - rsame, rev_v_iir, spu) + rsame);
+            reverb_write(spu, rev_m_ldiff, mul(left + mul(reverb_read(spu, rev_d_rdiff), rev_v_wall, spu) - ldiff, rev_v_iir, spu) + ldiff);
+            reverb_write(spu, rev_m_rdiff, mul(right + mul(reverb_read(spu, rev_d_ldiff), rev_v_wall, spu) - rdiff, rev_v_iir, spu) + rdiff);
+        }
+
+        int32_t out_left = mul(reverb_read(spu, rev_m_lcomb1), rev_v_comb1, spu) + mul(reverb_read(spu, rev_m_lcomb2), rev_v_comb2, spu)
+            + mul(reverb_read(spu, rev_m_lcomb3), rev_v_comb3, spu) + mul(reverb_read(spu, rev_m_lcomb4), rev_v_comb4, spu);
+        int32_t out_right = mul(reverb_read(spu, rev_m_rcomb1), rev_v_comb1, spu) + mul(reverb_read(spu, rev_m_rcomb2), rev_v_comb2, spu)
+            + mul(reverb_read(spu, rev_m_rcomb3), rev_v_comb3, spu) + mul(reverb_read(spu, rev_m_rcomb4), rev_v_comb4, spu);
+
+        auto all_pass = [&](int32_t value, uint32_t addr_reg, uint32_t delta_reg, uint32_t volume_reg) {
+            int32_t delayed = reverb_read_delta(spu, addr_reg, delta_reg);
+
+            value = saturate(value - mul(delayed, volume_reg, spu));
+
+            if (write) {
+                reverb_write(spu, addr_reg, value);
+            }
+
+            return saturate(mul(value, volume_reg, spu) + delayed);
+        };
+
+        out_left = all_pass(saturate(out_left), rev_m_lapf1, rev_d_apf1, rev_v_apf1);
+        out_right = all_pass(saturate(out_right), rev_m_rapf1, rev_d_apf1, rev_v_apf1);
+        out_left = all_pass(out_left, rev_m_lapf2, rev_d_apf2, rev_v_apf2);
+        out_right = all_pass(out_right, rev_m_rapf2, rev_d_apf2, rev_v_apf2);
+
+        spu->reverb_out_left = mul(out_left, reverb_volume_left, spu);
+        spu->reverb_out_right = mul(out_right, reverb_volume_right, spu);
+
+        uint32_t base = reg(spu, reverb_base) * 8;
+        spu->reverb_addr = std::max(base, (spu->reverb_addr + 2) & (ram_mask & ~1));
+    }
+
+    // * fixed volume is stored halved, sweep mode keeps whatever volume sweep reached
+    int32_t fixed_volume(uint16_t value) {
+        return (int16_t)(value << 1);
+    }
+
+    void generate(ps1::spu_t* spu, int16_t* frame) {
+        constexpr uint32_t n = ps1::SPU_VOICE_CNT;
+
+        ps1::spu_voices_t* voices = &spu->voices;
+        uint16_t cnt = reg(spu, control);
+
+        step_noise(spu);
+
+        uint32_t noise = reg_mask(spu, noise_on);
+        uint32_t reverb = reg_mask(spu, reverb_on);
+
+        // * lane loops over every voice, voices that are off have zero envelope
+        int32_t sample[n];
+
+        for (uint32_t v = 0; v < n; v++) {
+            uint32_t index = voices->counter[v] >> 12;
+            uint32_t phase = (voices->counter[v] >> 4) & 0xFF;
+            const int16_t* s = voices->decoded[v] + index;
+
+            sample[v] = (gauss[0xFF - phase] * s[0] + gauss[0x1FF - phase] * s[1] + gauss[0x100 + phase] * s[2] + gauss[phase] * s[3]) >> 15;
+        }
+
+        for (uint32_t v = 0; v < n; v++) {
+            sample[v] = ((noise >> v) & 1) ? spu->noise_level : sample[v];
+            sample[v] = sample[v] * voices->envelope[v] >> 15;
+            voices->out[v] = sample[v];
+        }
+
+        int32_t left = 0;
+        int32_t right = 0;
+        int32_t reverb_left = 0;
+        int32_t reverb_right = 0;
+
+        for (uint32_t v = 0; v < n; v++) {
+            int32_t l = sample[v] * voices->volume_left[v] >> 15;
+            int32_t r = sample[v] * voices->volume_right[v] >> 15;
+            int32_t mask = -(int32_t)((reverb >> v) & 1);
+
+            left += l;
+            right += r;
+            reverb_left += l & mask;
+            reverb_right += r & mask;
+        }
+
+        // * envelopes, sweeps and pitch are stepped voice by voice, pitch modulation depends on previous voice
+        uint32_t modulated = reg_mask(spu, pitch_mod);
+
+        for (uint32_t active = spu->active; active;) {
+            uint32_t v = std::countr_zero(active);
+            active &= active - 1;
+
+            step_adsr(spu, v);
+            step_sweep(voice_reg(spu, v, voice_volume_left), &voices->volume_left[v], &voices->sweep_wait_left[v]);
+            step_sweep(voice_reg(spu, v, voice_volume_right), &voices->volume_right[v], &voices->sweep_wait_right[v]);
+
+            uint32_t step = voice_reg(spu, v, voice_pitch);
+
+            if (v > 0 && ((modulated >> v) & 1)) {
+                step = (uint32_t)(((int32_t)(int16_t)step * (voices->out[v - 1] + 0x8000)) >> 15) & 0xFFFF;
+            }
+
+            voices->counter[v] += std::min(step, 0x4000u);
+
+            while (voices->counter[v] >= ps1::SPU_BLOCK_SAMPLES << 12) {
+                voices->counter[v] -= ps1::SPU_BLOCK_SAMPLES << 12;
+                next_block(spu, v);
+            }
+        }
+
+        // * reverb runs at 22.05 kHz
+        if ((spu->sample_cnt++ & 1) == 0) {
+            run_reverb(spu, reverb_left, reverb_right);
+        }
+
+        left = saturate(left + spu->reverb_out_left);
+        right = saturate(right + spu->reverb_out_right);
+
+        bool audible = (cnt & control_enable) && (cnt & control_unmute);
+        uint16_t main_left = reg(spu, main_volume_left);
+        uint16_t main_right = reg(spu, main_volume_right);
+
+        // ! main volume sweep is not emulated, swept main volume plays at full level
+        left = left * ((main_left & 0x8000) ? 0x7FFF : fixed_volume(main_left)) >> 15;
+        right = right * ((main_right & 0x8000) ? 0x7FFF : fixed_volume(main_right)) >> 15;
+
+        frame[0] = audible ? (int16_t)saturate(left) : 0;
+        frame[1] = audible ? (int16_t)saturate(right) : 0;
+    }
+
+    void flush(ps1::spu_t* spu) {
+        if (spu->output_enabled && spu->frame_cnt) {
+            ps1::audio_ring_push(spu->ring, spu->frames, spu->frame_cnt);
+        }
+
+        spu->frame_cnt = 0;
+    }
+
+    void batch_event(void* device) {
+        ps1::spu_t* spu = (ps1::spu_t*)device;
+
+        ps1::spu_sync(spu);
+        flush(spu);
+
+        ps1::scheduler_schedule(spu->scheduler, ps1::event_slot_t::spu, ps1::SPU_BATCH_FRAMES * ps1::SPU_CYCLES_PER_SAMPLE);
+    }
+
+    constexpr size_t state_offset = offsetof(ps1::spu_t, regs);
+    constexpr size_t state_size = offsetof(ps1::spu_t, synced) - state_offset;
+}
+
+void ps1::spu_init(spu_t* spu, const uint64_t* clock, scheduler_t* scheduler, irq_t* irq, audio_ring_t* ring) {
+    spu->clock = clock;
+    spu->scheduler = scheduler;
+    spu->irq = irq;
+    spu->ring = ring;
+
+    spu->ram = new uint8_t[SPU_RAM_SIZE];
+    memset(spu->ram, 0, SPU_RAM_SIZE);
+
+    memset((uint8_t*)spu + state_offset, 0, state_size);
+
+    spu->synced = *clock;
+    spu->frame_cnt = 0;
+
+    scheduler_register(scheduler, event_slot_t::spu, batch_event, spu);
+    scheduler_schedule(scheduler, event_slot_t::spu, SPU_BATCH_FRAMES * SPU_CYCLES_PER_SAMPLE);
+}
+
+void ps1::spu_exit(spu_t* spu) {
+    delete[] spu->ram;
+    spu->ram = nullptr;
+}
+
+void ps1::spu_save_state(spu_t* spu, serializer_t* serializer) {
+    serializer_write(serializer, (uint8_t*)spu + state_offset, state_size);
+    serializer_write32(serializer, (uint32_t)(*spu->clock - spu->synced));
+    serializer_write(serializer, spu->ram, SPU_RAM_SIZE);
+}
+
+void ps1::spu_load_state(spu_t* spu, serializer_t* serializer) {
+    serializer_read(serializer, (uint8_t*)spu + state_offset, state_size);
+    spu->synced = *spu->clock - serializer_read32(serializer);
+    serializer_read(serializer, spu->ram, SPU_RAM_SIZE);
+
+    // * frames of old timeline not pushed yet are dropped
+    spu->frame_cnt = 0;
+}
+
+void ps1::spu_set_output_enabled(spu_t* spu, bool enabled) {
+    // * frames generated so far belong to old setting
+    flush(spu);
+
+    spu->output_enabled = enabled;
+}
+
+void ps1::spu_sync(spu_t* spu) {
+    uint64_t now = *spu->clock;
+
+    while (now - spu->synced >= SPU_CYCLES_PER_SAMPLE) {
+        generate(spu, &spu->frames[spu->frame_cnt * 2]);
+        spu->synced += SPU_CYCLES_PER_SAMPLE;
+
+        if (++spu->frame_cnt == SPU_BATCH_FRAMES) {
+            flush(spu);
+        }
+    }
+}
+
+uint16_t ps1::spu_read16(spu_t* spu, mem_addr_t offset) {
+    spu_sync(spu);
+
+    if (offset < main_volume_left) {
+        uint32_t voice = offset >> 4;
+
+        switch (offset & 0xF) {
+            case voice_envelope: return (uint16_t)spu->voices.envelope[voice];
+            case voice_repeat: return (uint16_t)(spu->voices.repeat_addr[voice] / 8);
+            default: return reg(spu, offset);
+        }
+    }
+
+    if (offset >= voice_current_volume && offset < voice_current_volume + SPU_VOICE_CNT * 4) {
+        uint32_t voice = (offset - voice_current_volume) >> 2;
+
+        return (uint16_t)(((offset & 2) ? spu->voices.volume_right[voice] : spu->voices.volume_left[voice]) >> 1);
+    }
+
+    switch (offset) {
+        case voice_endx: return (uint16_t)spu->endx;
+        case voice_endx + 2: return (uint16_t)(spu->endx >> 16);
+
+        case status: {
+            uint16_t cnt = reg(spu, control);
+
+            // * transfers finish right away, never busy
+            return (cnt & 0x3F) | (spu->irq_flag ? 0x40 : 0) | ((cnt & 0x20) << 2);
+        }
+
+        case current_main_volume: return (uint16_t)fixed_volume(reg(spu, main_volume_left));
+        case current_main_volume + 2: return (uint16_t)fixed_volume(reg(spu, main_volume_right));
+
+        default: return reg(spu, offset);
+    }
+}
+
+void ps1::spu_write16(spu_t* spu, mem_addr_t offset, uint16_t value) {
+    spu_sync(spu);
+
+    if (offset < main_volume_left) {
+        uint32_t voice = offset >> 4;
+
+        reg(spu, offset) = value;
+
+        switch (offset & 0xF) {
+            case voice_volume_left: {
+                if (!(value & 0x8000)) spu->voices.volume_left[voice] = fixed_volume(value);
+
+                break;
+            }
+
+            case voice_volume_right: {
+                if (!(value & 0x8000)) spu->voices.volume_right[voice] = fixed_volume(value);
+
+                break;
+            }
+
+            case voice_envelope: {
+                spu->voices.envelope[voice] = value & 0x7FFF;
+
+                break;
+            }
+
+            case voice_repeat: {
+                spu->voices.repeat_addr[voice] = value * 8;
+
+                break;
+            }
+        }
+
+        return;
+    }
+
+    switch (offset) {
+        case key_on:
+        case key_on + 2: {
+            uint32_t mask = (uint32_t)value << ((offset - key_on) * 8);
+
+            for (uint32_t v = 0; v < SPU_VOICE_CNT; v++) {
+                if (mask & (1u << v)) start_voice(spu, v);
+            }
+
+            break;
+        }
+
+        case key_off:
+        case key_off + 2: {
+            uint32_t mask = (uint32_t)value << ((offset - key_off) * 8);
+
+            for (uint32_t v = 0; v < SPU_VOICE_CNT; v++) {
+                if (mask & (1u << v)) stop_voice(spu, v);
+            }
+
+            break;
+        }
+
+        case voice_endx:
+        case voice_endx + 2:
+        case status: {
+            return; // * read only
+        }
+
+        case reverb_base: {
+            spu->reverb_addr = value * 8;
+
+            break;
+        }
+
+        case transfer_addr: {
+            spu->transfer_addr = value * 8;
+
+            break;
+        }
+
+        case transfer_fifo: {
+            check_irq(spu, spu->transfer_addr, 2);
+            write_ram(spu, spu->transfer_addr, (int16_t)value);
+            spu->transfer_addr = (spu->transfer_addr + 2) & ram_mask;
+
+            break;
+        }
+
+        case control: {
+            // * clearing irq enable acknowledges irq
+            if (!(value & control_irq)) spu->irq_flag = false;
+
+            break;
+        }
+    }
+
+    reg(spu, offset) = value;
+}
+
+void ps1::spu_dma_write(spu_t* spu, uint32_t value) {
+    check_irq(spu, spu->transfer_addr, 4);
+
+    write_ram(spu, spu->transfer_addr, (int16_t)value);
+    write_ram(spu, spu->transfer_addr + 2, (int16_t)(value >> 16));
+
+    spu->transfer_addr = (spu->transfer_addr + 4) & ram_mask;
+}
+
+uint32_t ps1::spu_dma_read(spu_t* spu) {
+    check_irq(spu, spu->transfer_addr, 4);
+
+    uint32_t value = (uint16_t)read_ram(spu, spu->transfer_addr) | ((uint32_t)(uint16_t)read_ram(spu, spu->transfer_addr + 2) << 16);
+
+    spu->transfer_addr = (spu->transfer_addr + 4) & ram_mask;
+
+    return value;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "defs.h"
+#include "peripheral.h"
+
+namespace ps1 {
+    constexpr uint32_t SPU_RAM_SIZE = 512 * 1024;
+    constexpr uint32_t SPU_VOICE_CNT = 24;
+    constexpr uint32_t SPU_CYCLES_PER_SAMPLE = 768; // * cpu clock / 44100
+
+    constexpr uint32_t SPU_BLOCK_SAMPLES = 28; // * samples in one 16 byte adpcm block
+    constexpr uint32_t SPU_HISTORY_SAMPLES = 3; // * end of previous block kept for interpolation
+
+    constexpr uint32_t SPU_BATCH_FRAMES = 64; // * frames generated between two pushes into audio ring
+
+    enum struct spu_phase_t : uint32_t {
+        off,
+        attack,
+        decay,
+        sustain,
+        release,
+    };
+
+    /*
+    * voice state, one array per field
+    * per sample interpolation, envelope and mixing loops run over all voices as lanes so they vectorize,
+    * only block decoding and envelope stepping are done voice by voice
+    */
+    struct spu_voices_t {
+        int16_t decoded[SPU_VOICE_CNT][SPU_HISTORY_SAMPLES + SPU_BLOCK_SAMPLES + 1]; // * history, current block, padding
+        uint32_t counter[SPU_VOICE_CNT]; // * [12:16] sample in current block, [4:11] interpolation phase
+        uint32_t addr[SPU_VOICE_CNT]; // * current block in sound ram
+        uint32_t repeat_addr[SPU_VOICE_CNT];
+        uint32_t flags[SPU_VOICE_CNT]; // * loop flags of current block
+        int32_t adpcm_old[SPU_VOICE_CNT];
+        int32_t adpcm_older[SPU_VOICE_CNT];
+
+        int32_t envelope[SPU_VOICE_CNT]; // * 0 to 0x7FFF
+        uint32_t envelope_wait[SPU_VOICE_CNT]; // * samples until next envelope step
+        spu_phase_t phase[SPU_VOICE_CNT];
+
+        int32_t volume_left[SPU_VOICE_CNT];
+        int32_t volume_right[SPU_VOICE_CNT];
+        uint32_t sweep_wait_left[SPU_VOICE_CNT];
+        uint32_t sweep_wait_right[SPU_VOICE_CNT];
+
+        int32_t out[SPU_VOICE_CNT]; // * last sample after envelope, source of pitch modulation for next voice
+    };
+
+    /*
+    * sound processing unit
+    * 24 adpcm voices with gaussian interpolation and adsr envelopes, noise, pitch modulation and reverb, mixed at 44.1 kHz
+    *
+    * samples are generated lazily. every register access and a periodic event first catch spu up to cpu clock,
+    * generated frames are handed to audio ring in batches
+    */
+    struct spu_t {
+        const uint64_t* clock;
+        scheduler_t* scheduler;
+        irq_t* irq;
+        audio_ring_t* ring;
+
+        bool output_enabled = true; // * frames are dropped instead of pushed, for frames that are emulated twice
+
+        uint8_t* ram = nullptr;
+
+        // * saved as raw range from regs up to synced
+        uint16_t regs[0x200]; // * 0x1F801C00 - 0x1F802000, as last written
+        spu_voices_t voices;
+
+        uint32_t active; // * voices keyed on that have not finished release
+        uint32_t endx; // * voices that passed a loop end block since key on
+        bool irq_flag;
+
+        uint32_t transfer_addr;
+
+        int32_t noise_level;
+        int32_t noise_timer;
+
+        uint32_t reverb_addr;
+        int32_t reverb_out_left; // * reverb runs at half rate, output is held for two samples
+        int32_t reverb_out_right;
+        uint32_t sample_cnt;
+
+        uint64_t synced; // * cycle of next sample to generate, saved relative to clock
+
+        int16_t frames[SPU_BATCH_FRAMES * 2];
+        uint32_t frame_cnt;
+    };
+
+    void spu_init(spu_t*, const uint64_t*, scheduler_t*, irq_t*, audio_ring_t*);
+    void spu_exit(spu_t*);
+
+    void spu_save_state(spu_t*, serializer_t*);
+    void spu_load_state(spu_t*, serializer_t*);
+
+    // * pending frames are pushed or dropped under old setting first
+    void spu_set_output_enabled(spu_t*, bool);
+
+    // * generate samples up to cpu clock
+    void spu_sync(spu_t*);
+
+    uint16_t spu_read16(spu_t*, mem_addr_t);
+    void spu_write16(spu_t*, mem_addr_t, uint16_t);
+
+    // * dma channel 4, one word is two halfwords at transfer address
+    void spu_dma_write(spu_t*, uint32_t);
+    uint32_t spu_dma_read(spu_t*);
+
+    // * registers are 16 bit, 32 bit accesses are split
+    FETCH_FN(spu_t) fetch(void* device, mem_addr_t offset) {
+        spu_t* spu = (spu_t*)device;
+
+        if constexpr (sizeof(type_t) == 4) {
+            return spu_read16(spu, offset) | ((uint32_t)spu_read16(spu, offset + 2) << 16);
+        } else {
+            return (type_t)(spu_read16(spu, offset & ~1) >> ((offset & 1) * 8));
+        }
+    }
+
+    STORE_FN(spu_t) store(void* device, mem_addr_t offset, type_t value) {
+        spu_t* spu = (spu_t*)device;
+
+        if constexpr (sizeof(type_t) == 4) {
+            spu_write16(spu, offset, (uint16_t)value);
+            spu_write16(spu, offset + 2, (uint16_t)(value >> 16));
+        } else {
+            spu_write16(spu, offset & ~1, (uint16_t)value);
+        }
+    }
+}
@@ -2,62 +2,229 @@
 #include "render.h"
 #include "logger.h"
 
+#include <algorithm>
+#include <bit>
+
 namespace {
-    constexpr uint32_t vram_width = 1024;
-    constexpr uint32_t vram_height = 512;
+    constexpr uint32_t max_resolution_scale = 8;
+
+    constexpr uint32_t tile_size = 32;
+    constexpr uint32_t tile_columns = ps1::VRAM_WIDTH / tile_size;
+    constexpr uint32_t tile_rows = ps1::VRAM_HEIGHT / tile_size;
+
+    static_assert(tile_columns == 32, "tile row must fit into single dirty mask");
 }
 
 namespace ps1 {
     void tsb_init(texture_stream_buffer_t* tsb) {
-        tsb->buffer = new uint8_t[vram_width * vram_height * 3];
+        tsb->buffer = new uint8_t[VRAM_WIDTH * VRAM_HEIGHT * 3];
+        tsb->mask_buffer = new uint8_t[VRAM_WIDTH * VRAM_HEIGHT];
     }
 
     void tsb_exit(texture_stream_buffer_t* tsb) {
         delete[] tsb->buffer;
+        delete[] tsb->mask_buffer;
     }
 }
 
 namespace {
     void gen_texture(uint32_t* fbo, uint32_t* tbo, uint32_t* rbo, uint32_t width, uint32_t height) {
         glGenFramebuffers(1, fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+        ps1::render::bind_framebuffer(*fbo);
 
         glGenTextures(1, tbo);
-        glBindTexture(GL_TEXTURE_2D, *tbo);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, vram_width, vram_height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        ps1::render::bind_texture(*tbo);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        // * sampling is fixed here for texture lifetime, uploads do not touch it
+        // * texels stay sharp when magnified. before render state cache every upload switched texture to linear for good,
+        // * so vram was displayed blurred once anything had been uploaded and sharp before that
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, width > ps1::VRAM_WIDTH ? GL_LINEAR : GL_NEAREST); // * upscaled vram is displayed shrunk
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
         
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *tbo, 0);
 
+        // * stencil bit 0 holds mask bit of each pixel
         glGenRenderbuffers(1, rbo);
         glBindRenderbuffer(GL_RENDERBUFFER, *rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, vram_width, vram_height);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, *rbo);
         
+        ps1::render::set_scissor_test(false);
         glClearColor(.0f, .0f, .0f, 1.f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glClearStencil(0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     }
-
     
     void del_texture(uint32_t* fbo, uint32_t* tbo, uint32_t* rbo) {
         glDeleteFramebuffers(1, fbo);
         glDeleteTextures(1, tbo);
         glDeleteRenderbuffers(1, rbo);
     }
+
+    // * copy native rectangle between framebuffers of different scale. mask bits are carried in stencil
+    void blit_rect(uint32_t src_fbo, uint32_t src_scale, uint32_t dst_fbo, uint32_t dst_scale, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+        ps1::render::bind_read_framebuffer(src_fbo);
+        ps1::render::bind_draw_framebuffer(dst_fbo);
+        ps1::render::set_scissor_test(false);
+
+        glBlitFramebuffer(
+            x * src_scale, y * src_scale, (x + width) * src_scale, (y + height) * src_scale,
+            x * dst_scale, y * dst_scale, (x + width) * dst_scale, (y + height) * dst_scale,
+            GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST
+        );
+    }
+
+    // * 24 bit color and stencil mask bit to 15 bit pixels
+    void pack_pixels(const uint8_t* rgb, const uint8_t* mask, uint32_t count, uint16_t* pixels) {
+        for (uint32_t i = 0; i < count; i++) {
+            pixels[i] = (rgb[i * 3] >> 3) | ((rgb[i * 3 + 1] >> 3) << 5) | ((rgb[i * 3 + 2] >> 3) << 10) | ((mask[i] & 0x1) << 15);
+        }
+    }
+
+    /*
+    * mask bits into stencil of native shadow
+    * rectangle is cleared, then covered by quad whose fragments replace stencil with 1 and are discarded where mask bit is clear
+    */
+    void write_mask_rect(ps1::vram_t* vram, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* mask) {
+        ps1::render::bind_texture(vram->mask_tbo);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, mask);
+
+        ps1::render::bind_framebuffer(vram->native_fbo);
+        ps1::render::set_viewport({ 0, 0, (int32_t)ps1::VRAM_WIDTH, (int32_t)ps1::VRAM_HEIGHT });
+        ps1::render::set_scissor({ (int32_t)x, (int32_t)y, (int32_t)width, (int32_t)height });
+        ps1::render::set_scissor_test(true);
+
+        glClearStencil(0);
+        glClear(GL_STENCIL_BUFFER_BIT);
+
+        float left = (float)x / (ps1::VRAM_WIDTH / 2) - 1.f;
+        float right = (float)(x + width) / (ps1::VRAM_WIDTH / 2) - 1.f;
+        float top = (float)y / (ps1::VRAM_HEIGHT / 2) - 1.f;
+        float bottom = (float)(y + height) / (ps1::VRAM_HEIGHT / 2) - 1.f;
+
+        ps1::rgb_t black(0.f, 0.f, 0.f);
+
+        ps1::triangle_t triangles[2] = {
+            { { { { left, top }, black }, { { right, top }, black }, { { left, bottom }, black } } },
+            { { { { right, top }, black }, { { right, bottom }, black }, { { left, bottom }, black } } },
+        };
+
+        ps1::render::set_stencil_test(true);
+        ps1::render::set_mask_mode({ true, false }); // * always passes and replaces with 1
+        ps1::render::set_blend_mode(ps1::render::blend_mode_t::opaque);
+        ps1::render::bind_vertex_array(vram->vao);
+        ps1::render::bind_array_buffer(vram->vbo);
+        ps1::render::use_shader(ps1::VRAM_MASK_SHADER);
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE); // * not cached, restored right after
+        glBufferData(GL_ARRAY_BUFFER, sizeof(triangles), triangles, GL_STATIC_DRAW);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        ps1::render::use_shader(ps1::VRAM_DRAW_SHADER);
+    }
+
+    // * upload into native shadow and upscale into render target
+    void upload_rect(ps1::vram_t* vram, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* rgb, const uint8_t* mask) {
+        ps1::render::bind_texture(vram->native_tbo); // * sampling parameters are set once in gen_texture
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+
+        // ! masked pixels are not preserved by uploads
+        write_mask_rect(vram, x, y, width, height, mask);
+
+        blit_rect(vram->native_fbo, 1, vram->fbo, vram->resolution_scale, x, y, width, height);
+    }
+
+    // * mark tiles covered by vertices as not yet downsampled
+    void mark_dirty(ps1::vram_t* vram, const ps1::vertex_t* vertices, uint32_t count) {
+        float min_x = vertices[0].pos.x, max_x = vertices[0].pos.x;
+        float min_y = vertices[0].pos.y, max_y = vertices[0].pos.y;
+
+        for (uint32_t i = 1; i < count; i++) {
+            min_x = std::min(min_x, vertices[i].pos.x);
+            max_x = std::max(max_x, vertices[i].pos.x);
+            min_y = std::min(min_y, vertices[i].pos.y);
+            max_y = std::max(max_y, vertices[i].pos.y);
+        }
+
+        // * from normalized device coordinates to vram coordinates, clipped by drawing area
+        int32_t left = std::max((int32_t)((min_x + 1.f) * (ps1::VRAM_WIDTH / 2)), (int32_t)vram->draw_area.left);
+        int32_t right = std::min((int32_t)((max_x + 1.f) * (ps1::VRAM_WIDTH / 2)), (int32_t)vram->draw_area.right);
+        int32_t top = std::max((int32_t)((min_y + 1.f) * (ps1::VRAM_HEIGHT / 2)), (int32_t)vram->draw_area.top);
+        int32_t bottom = std::min((int32_t)((max_y + 1.f) * (ps1::VRAM_HEIGHT / 2)), (int32_t)vram->draw_area.bottom);
+
+        if (left > right || top > bottom) return;
+
+        uint32_t first_column = left / tile_size;
+        uint32_t last_column = std::min((uint32_t)right / tile_size, tile_columns - 1);
+        uint32_t columns_mask = (~0u >> (31 - (last_column - first_column))) << first_column;
+
+        for (uint32_t row = top / tile_size; row <= std::min((uint32_t)bottom / tile_size, tile_rows - 1); row++) {
+            vram->dirty_tiles[row] |= columns_mask;
+        }
+    }
+
+    // * binds vram as render target. state cache skips everything that is already set
+    void bind_render_target(ps1::vram_t* vram) {
+        ps1::draw_area_t& area = vram->draw_area;
+        int32_t scale = vram->resolution_scale;
+
+        int32_t width = std::max((int32_t)area.right - (int32_t)area.left + 1, 0);
+        int32_t height = std::max((int32_t)area.bottom - (int32_t)area.top + 1, 0);
+
+        ps1::render::bind_framebuffer(vram->fbo);
+        ps1::render::set_viewport({ 0, 0, (int32_t)ps1::VRAM_WIDTH * scale, (int32_t)ps1::VRAM_HEIGHT * scale });
+        ps1::render::set_scissor({ (int32_t)area.left * scale, (int32_t)area.top * scale, width * scale, height * scale });
+        ps1::render::set_scissor_test(true);
+        ps1::render::set_stencil_test(true);
+        ps1::render::set_mask_mode({ vram->set_mask, vram->test_mask });
+        ps1::render::set_blend_mode(ps1::render::blend_mode_t::opaque);
+        ps1::render::bind_vertex_array(vram->vao);
+        ps1::render::bind_array_buffer(vram->vbo);
+    }
 }
 
 void ps1::vram_init(vram_t* vram) {
     {
-        gen_texture(&vram->fbo, &vram->tbo, &vram->rbo, vram_width, vram_height);
+        vram->resolution_scale = 1;
+
+        gen_texture(&vram->fbo, &vram->tbo, &vram->rbo, VRAM_WIDTH, VRAM_HEIGHT);
+        gen_texture(&vram->native_fbo, &vram->native_tbo, &vram->native_rbo, VRAM_WIDTH, VRAM_HEIGHT);
+
+        for (auto& mask : vram->dirty_tiles) {
+            mask = 0;
+        }
+
+        // * stream and readback buffers are tightly packed rgb
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+        glStencilMask(0x1);
+
+        vram->set_mask = false;
+        vram->test_mask = false;
+
+        vram->draw_call_cnt = 0;
+        vram->flush_cnt = 0;
     }
 
     {
+        // * staging for mask bits written into stencil, only read with texel fetch
+        glGenTextures(1, &vram->mask_tbo);
+        render::bind_texture(vram->mask_tbo);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, VRAM_WIDTH, VRAM_HEIGHT, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    }
+
+    {
+        glGenVertexArrays(1, &vram->vao);
+        render::bind_vertex_array(vram->vao);
+
         glGenBuffers(1, &vram->vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, vram->vbo);
+        render::bind_array_buffer(vram->vbo);
 
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vertex_t), 0);
@@ -67,25 +234,255 @@ void ps1::vram_init(vram_t* vram) {
     }
 
     tsb_init(&vram->texture_stream_buffer);
+    tsb_init(&vram->backup_texture_stream_buffer);
+
+    vram->backup_scale = 0;
+
+    vram->readback_pbo = 0;
+    vram->readback_fence = nullptr;
+
+    vram->draw_area = { 0, 0, VRAM_WIDTH - 1, VRAM_HEIGHT - 1 };
 }
 
 void ps1::vram_exit(vram_t* vram) {
     del_texture(&vram->fbo, &vram->tbo, &vram->rbo);
+    del_texture(&vram->native_fbo, &vram->native_tbo, &vram->native_rbo);
+    glDeleteTextures(1, &vram->mask_tbo);
+
+    if (vram->backup_scale) {
+        del_texture(&vram->backup_fbo, &vram->backup_tbo, &vram->backup_rbo);
+        del_texture(&vram->backup_native_fbo, &vram->backup_native_tbo, &vram->backup_native_rbo);
+    }
 
     glDeleteBuffers(1, &vram->vbo);
+    glDeleteVertexArrays(1, &vram->vao);
+
+    if (vram->readback_fence) glDeleteSync((GLsync)vram->readback_fence);
+    if (vram->readback_pbo) glDeleteBuffers(1, &vram->readback_pbo);
+
+    render::invalidate_state(); // * deleted objects might still be shadowed as bound
 
     tsb_exit(&vram->texture_stream_buffer);
+    tsb_exit(&vram->backup_texture_stream_buffer);
+}
+
+void ps1::vram_set_resolution_scale(vram_t* vram, uint32_t scale) {
+    scale = std::min(std::max(scale, 1u), max_resolution_scale);
+
+    if (scale == vram->resolution_scale) return;
+
+    uint32_t fbo, tbo, rbo;
+    gen_texture(&fbo, &tbo, &rbo, VRAM_WIDTH * scale, VRAM_HEIGHT * scale);
+
+    // * carry over current content, native shadow and dirty tiles stay valid
+    blit_rect(vram->fbo, vram->resolution_scale, fbo, scale, 0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+
+    del_texture(&vram->fbo, &vram->tbo, &vram->rbo);
+    render::invalidate_state();
+
+    vram->fbo = fbo;
+    vram->tbo = tbo;
+    vram->rbo = rbo;
+    vram->resolution_scale = scale;
+
+    logger::push("internal resolution set to " + std::to_string(scale) + "x", logger::type_t::info, "vram");
+}
+
+void ps1::vram_set_mask_mode(vram_t* vram, bool set_mask, bool test_mask) {
+    vram->set_mask = set_mask;
+    vram->test_mask = test_mask;
+}
+
+void ps1::vram_set_draw_area(vram_t* vram, uint32_t left, uint32_t top, uint32_t right, uint32_t bottom) {
+    vram->draw_area = { left, top, right, bottom };
+}
+
+void ps1::vram_sync_region(vram_t* vram, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    if (width == 0 || height == 0) return;
+
+    uint32_t first_column = std::min(x / tile_size, tile_columns - 1);
+    uint32_t last_column = std::min((x + width - 1) / tile_size, tile_columns - 1);
+    uint32_t columns_mask = (~0u >> (31 - (last_column - first_column))) << first_column;
+
+    uint32_t first_row = std::min(y / tile_size, tile_rows - 1);
+    uint32_t last_row = std::min((y + height - 1) / tile_size, tile_rows - 1);
+
+    for (uint32_t row = first_row; row <= last_row; row++) {
+        uint32_t dirty = vram->dirty_tiles[row] & columns_mask;
+
+        // * blit each run of adjacent dirty tiles at once
+        while (dirty) {
+            uint32_t run_start = std::countr_zero(dirty);
+            uint32_t run_length = std::countr_one(dirty >> run_start);
+
+            blit_rect(vram->fbo, vram->resolution_scale, vram->native_fbo, 1, run_start * tile_size, row * tile_size, run_length * tile_size, tile_size);
+
+            dirty &= ~((~0u >> (32 - run_length)) << run_start);
+        }
+
+        vram->dirty_tiles[row] &= ~columns_mask;
+    }
+}
+
+void ps1::vram_read_region(vram_t* vram, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint16_t* pixels) {
+    vram_sync_region(vram, x, y, width, height);
+
+    dyn_arr_t<uint8_t> rgb(width * height * 3);
+
+    render::bind_read_framebuffer(vram->native_fbo);
+    glReadPixels(x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+    vram->flush_cnt++;
+
+    dyn_arr_t<uint8_t> mask(width * height);
+
+    glReadPixels(x, y, width, height, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, mask.data());
+
+    pack_pixels(rgb.data(), mask.data(), width * height, pixels);
+}
+
+void ps1::vram_begin_readback(vram_t* vram) {
+    constexpr uint32_t texel_cnt = VRAM_WIDTH * VRAM_HEIGHT;
+
+    ASSERT(!vram->readback_fence, "vram readback is already in flight");
+
+    // * upscaled detail is dropped, state keeps native pixels only
+    vram_sync_region(vram, 0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+
+    // * pack buffer binding is not part of state cache, it is unbound right after use
+    if (!vram->readback_pbo) {
+        glGenBuffers(1, &vram->readback_pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, vram->readback_pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, texel_cnt * 4, nullptr, GL_STREAM_READ);
+    } else {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, vram->readback_pbo);
+    }
+
+    render::bind_read_framebuffer(vram->native_fbo);
+    glReadPixels(0, 0, VRAM_WIDTH, VRAM_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+    glReadPixels(0, 0, VRAM_WIDTH, VRAM_HEIGHT, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, (void*)(uintptr_t)(texel_cnt * 3));
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    vram->readback_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush(); // * otherwise copy may sit in command queue until next frame is submitted
+}
+
+bool ps1::vram_is_readback_ready(vram_t* vram) {
+    ASSERT(vram->readback_fence, "no vram readback in flight");
+
+    GLenum result = glClientWaitSync((GLsync)vram->readback_fence, 0, 0);
+
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+bool ps1::vram_end_readback(vram_t* vram, uint16_t* pixels) {
+    constexpr uint32_t texel_cnt = VRAM_WIDTH * VRAM_HEIGHT;
+
+    ASSERT(vram->readback_fence, "no vram readback in flight");
+
+    glClientWaitSync((GLsync)vram->readback_fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync((GLsync)vram->readback_fence);
+    vram->readback_fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, vram->readback_pbo);
+
+    const uint8_t* data = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, texel_cnt * 4, GL_MAP_READ_BIT);
+
+    if (data) {
+        pack_pixels(data, data + texel_cnt * 3, texel_cnt, pixels);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        logger::push("failed to map vram readback buffer", logger::type_t::error, "vram");
+
+        memset(pixels, 0, texel_cnt * sizeof(uint16_t));
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return true;
+}
+
+void ps1::vram_write_all(vram_t* vram, const uint16_t* pixels) {
+    constexpr uint32_t texel_cnt = VRAM_WIDTH * VRAM_HEIGHT;
+
+    // * texture stream buffer might hold upload in progress, separate buffers are used
+    dyn_arr_t<uint8_t> rgb(texel_cnt * 3);
+    dyn_arr_t<uint8_t> mask(texel_cnt);
+
+    for (uint32_t i = 0; i < texel_cnt; i++) {
+        uint16_t pixel = pixels[i];
+
+        rgb[i * 3] = float(pixel & 0x1f) / 31.f * 255.f;
+        rgb[i * 3 + 1] = float((pixel >> 5) & 0x1f) / 31.f * 255.f;
+        rgb[i * 3 + 2] = float((pixel >> 10) & 0x1f) / 31.f * 255.f;
+        mask[i] = pixel >> 15;
+    }
+
+    upload_rect(vram, 0, 0, VRAM_WIDTH, VRAM_HEIGHT, rgb.data(), mask.data());
+
+    // * render target was overwritten from shadow, nothing left to downsample
+    for (auto& tiles : vram->dirty_tiles) {
+        tiles = 0;
+    }
+}
+
+void ps1::vram_backup(vram_t* vram) {
+    uint32_t scale = vram->resolution_scale;
+
+    if (vram->backup_scale != scale) {
+        if (vram->backup_scale) {
+            del_texture(&vram->backup_fbo, &vram->backup_tbo, &vram->backup_rbo);
+        } else {
+            gen_texture(&vram->backup_native_fbo, &vram->backup_native_tbo, &vram->backup_native_rbo, VRAM_WIDTH, VRAM_HEIGHT);
+        }
+
+        gen_texture(&vram->backup_fbo, &vram->backup_tbo, &vram->backup_rbo, VRAM_WIDTH * scale, VRAM_HEIGHT * scale);
+        render::invalidate_state();
+
+        vram->backup_scale = scale;
+    }
+
+    blit_rect(vram->fbo, scale, vram->backup_fbo, scale, 0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+    blit_rect(vram->native_fbo, 1, vram->backup_native_fbo, 1, 0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+
+    memcpy(vram->backup_dirty_tiles, vram->dirty_tiles, sizeof(vram->dirty_tiles));
+
+    // * only part of upload received so far is copied, usually nothing is in flight
+    texture_stream_buffer_t& tsb = vram->texture_stream_buffer;
+    texture_stream_buffer_t& backup_tsb = vram->backup_texture_stream_buffer;
+
+    memcpy(backup_tsb.buffer, tsb.buffer, tsb.index);
+    memcpy(backup_tsb.mask_buffer, tsb.mask_buffer, tsb.index / 3);
+
+    backup_tsb.index = tsb.index;
+    backup_tsb.texels_left = tsb.texels_left;
+    backup_tsb.xpos = tsb.xpos;
+    backup_tsb.ypos = tsb.ypos;
+    backup_tsb.width = tsb.width;
+    backup_tsb.height = tsb.height;
+}
+
+void ps1::vram_restore(vram_t* vram) {
+    ASSERT(vram->backup_scale == vram->resolution_scale, "vram backup does not match resolution scale");
+
+    std::swap(vram->fbo, vram->backup_fbo);
+    std::swap(vram->tbo, vram->backup_tbo);
+    std::swap(vram->rbo, vram->backup_rbo);
+    std::swap(vram->native_fbo, vram->backup_native_fbo);
+    std::swap(vram->native_tbo, vram->backup_native_tbo);
+    std::swap(vram->native_rbo, vram->backup_native_rbo);
+    std::swap(vram->dirty_tiles, vram->backup_dirty_tiles);
+    std::swap(vram->texture_stream_buffer, vram->backup_texture_stream_buffer);
 }
 
 void ps1::vram_draw_triangle(vram_t* vram, triangle_t triangle) {
-    glBindFramebuffer(GL_FRAMEBUFFER, vram->fbo);
-    glViewport(0, 0, vram_width, vram_height);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, vram->vbo);
+    bind_render_target(vram);
+
     glBufferData(GL_ARRAY_BUFFER, sizeof(triangle_t), &triangle, GL_STATIC_DRAW);
     glDrawArrays(GL_TRIANGLES, 0, 3);
+    vram->draw_call_cnt++;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    mark_dirty(vram, triangle.vertices, 3);
 }
 
 void ps1::vram_draw_quad(vram_t* vram, quad_t quad) {
@@ -94,14 +491,13 @@ void ps1::vram_draw_quad(vram_t* vram, quad_t quad) {
         { quad.vertices[1], quad.vertices[2], quad.vertices[3] }
     };
 
-    glBindFramebuffer(GL_FRAMEBUFFER, vram->fbo);
-    glViewport(0, 0, vram_width, vram_height);
+    bind_render_target(vram);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vram->vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(triangle_t) * 2, triangles, GL_STATIC_DRAW);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    vram->draw_call_cnt++;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    mark_dirty(vram, quad.vertices, 4);
 }
 
 void ps1::vram_set_texture_stream_specs(vram_t* vram, uint32_t xpos, uint32_t ypos, uint32_t width, uint32_t height) {
@@ -124,6 +520,11 @@ void ps1::vram_send_texture_stream_data(vram_t* vram, uint32_t data) {
     stream_rgb_t* rgb_0 = (stream_rgb_t*)(((uint16_t*)&data) + 1);
     stream_rgb_t* rgb_1 = (stream_rgb_t*)((uint16_t*)&data);
 
+    uint32_t texel = vram->texture_stream_buffer.index / 3;
+
+    vram->texture_stream_buffer.mask_buffer[texel] = rgb_1->mask | vram->set_mask;
+    vram->texture_stream_buffer.mask_buffer[texel + 1] = rgb_0->mask | vram->set_mask;
+
     uint8_t r1 = float(rgb_1->r) / 31.f * 255.f;
     uint8_t g1 = float(rgb_1->g) / 31.f * 255.f;
     uint8_t b1 = float(rgb_1->b) / 31.f * 255.f;
@@ -143,12 +544,9 @@ void ps1::vram_send_texture_stream_data(vram_t* vram, uint32_t data) {
     vram->texture_stream_buffer.texels_left -= 2;
 
     if (vram->texture_stream_buffer.texels_left == 0) {
-        glBindTexture(GL_TEXTURE_2D, vram->tbo);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, vram->texture_stream_buffer.xpos, vram->texture_stream_buffer.ypos, vram->texture_stream_buffer.width, vram->texture_stream_buffer.height, GL_RGB, GL_UNSIGNED_BYTE, vram->texture_stream_buffer.buffer);
+        texture_stream_buffer_t& tsb = vram->texture_stream_buffer;
+
+        upload_rect(vram, tsb.xpos, tsb.ypos, tsb.width, tsb.height, tsb.buffer, tsb.mask_buffer);
 
         logger::push("rendered texture stream", logger::type_t::message, "vram");
 
@@ -3,8 +3,16 @@
 #include "defs.h"
 
 namespace ps1 {
+    constexpr uint32_t VRAM_WIDTH = 1024;
+    constexpr uint32_t VRAM_HEIGHT = 512;
+
+    // * shader programs used on vram, loaded by application through render::make_shader
+    constexpr uint32_t VRAM_DRAW_SHADER = 0;
+    constexpr uint32_t VRAM_MASK_SHADER = 1; // * discards fragments whose mask bit is clear
+
     struct texture_stream_buffer_t {
         uint8_t* buffer;
+        uint8_t* mask_buffer; // * one mask bit per texel
         uint32_t index;
         uint32_t texels_left;
         uint32_t xpos;
@@ -13,14 +21,61 @@ namespace ps1 {
         uint32_t height;
     };
 
+    // * inclusive rectangle in vram coordinates
+    struct draw_area_t {
+        uint32_t left;
+        uint32_t top;
+        uint32_t right;
+        uint32_t bottom;
+    };
+
     struct vram_t {
-        uint32_t fbo; // * frame buffer object
+        uint32_t fbo; // * frame buffer object. rendered at internal resolution
         uint32_t tbo; // * texture buffer object. used for rendering final result
         uint32_t rbo; // * render buffer object
 
+        /*
+        * native resolution shadow of fbo. used for cpu readback
+        * polygons are only rendered into fbo, dirty regions are downsampled into shadow on demand
+        */
+        uint32_t native_fbo;
+        uint32_t native_tbo;
+        uint32_t native_rbo;
+        uint32_t mask_tbo; // * one byte per pixel, uploaded mask bits on their way into native stencil
+
+        uint32_t resolution_scale; // * internal resolution multiplier, 1x-8x
+        uint32_t dirty_tiles[16]; // * 32x32 pixel tiles not yet downsampled into native shadow. one bit per tile column
+
+        uint32_t vao; // * vertex array object. holds vertex layout of vbo
         uint32_t vbo; // * vertex buffer object. used for drawing triangles
 
         texture_stream_buffer_t texture_stream_buffer; // * used for streaming texture data from cpu to gpu
+
+        /*
+        * copy of fbo and native shadow with their stencil, taken by vram_backup
+        * vram_restore swaps it with live objects, so afterwards it holds whatever was drawn in between
+        */
+        uint32_t backup_fbo;
+        uint32_t backup_tbo;
+        uint32_t backup_rbo;
+        uint32_t backup_native_fbo;
+        uint32_t backup_native_tbo;
+        uint32_t backup_native_rbo;
+        uint32_t backup_scale; // * resolution scale of backup_fbo, 0 until first backup
+        uint32_t backup_dirty_tiles[16];
+        texture_stream_buffer_t backup_texture_stream_buffer;
+
+        // * pixel pack buffer holding rgb then stencil of whole native shadow, filled asynchronously by gpu
+        uint32_t readback_pbo;
+        void* readback_fence; // * GLsync, kept opaque so header does not need gl. null when no readback is in flight
+
+        draw_area_t draw_area; // * applied as scissor rectangle
+
+        bool set_mask; // * drawn pixels get mask bit set
+        bool test_mask; // * pixels with mask bit set are not overwritten
+
+        uint32_t draw_call_cnt; // * reset by gpu every frame
+        uint32_t flush_cnt; // * reset by gpu every frame
     };
 
     struct pos_t {
@@ -68,6 +123,38 @@ namespace ps1 {
     void vram_init(vram_t*);
     void vram_exit(vram_t*);
 
+    void vram_set_resolution_scale(vram_t*, uint32_t);
+
+    void vram_set_draw_area(vram_t*, uint32_t, uint32_t, uint32_t, uint32_t);
+    void vram_set_mask_mode(vram_t*, bool, bool);
+
+    // * downsample dirty tiles of region into native shadow
+    void vram_sync_region(vram_t*, uint32_t, uint32_t, uint32_t, uint32_t);
+
+    // * read region as 15 bit pixels
+    void vram_read_region(vram_t*, uint32_t, uint32_t, uint32_t, uint32_t, uint16_t*);
+
+    /*
+    * whole vram readback for save states
+    * begin queues copy of native shadow into pixel buffer and returns at once
+    * end maps buffer as 15 bit pixels, stalling only if gpu has not caught up yet.
+    * it returns false without touching pixels if backend keeps no pixels to read
+    */
+    void vram_begin_readback(vram_t*);
+    bool vram_is_readback_ready(vram_t*);
+    bool vram_end_readback(vram_t*, uint16_t*);
+
+    // * overwrite whole vram with 15 bit pixels
+    void vram_write_all(vram_t*, const uint16_t*);
+
+    /*
+    * vram snapshot for run ahead, kept on gpu
+    * backup only queues blits, restore swaps objects back without any copy
+    * dirty tiles and texture upload in flight are carried along
+    */
+    void vram_backup(vram_t*);
+    void vram_restore(vram_t*);
+
     void vram_draw_triangle(vram_t*, triangle_t);
     void vram_draw_quad(vram_t*, quad_t);
 
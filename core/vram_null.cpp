@@ -0,0 +1,69 @@
+#include "vram.h"
+
+/*
+* null vram backend used by headless build
+* gpu command state is still tracked by gpu, nothing is rasterized or stored
+*/
+
+void ps1::vram_init(vram_t* vram) {
+    vram->resolution_scale = 1;
+
+    for (auto& mask : vram->dirty_tiles) {
+        mask = 0;
+    }
+
+    vram->draw_area = { 0, 0, 0, 0 };
+    vram->set_mask = false;
+    vram->test_mask = false;
+
+    vram->draw_call_cnt = 0;
+    vram->flush_cnt = 0;
+
+    vram->readback_pbo = 0;
+    vram->readback_fence = nullptr;
+}
+
+void ps1::vram_exit(vram_t* vram) {}
+
+void ps1::vram_set_resolution_scale(vram_t* vram, uint32_t scale) {}
+
+void ps1::vram_set_draw_area(vram_t* vram, uint32_t left, uint32_t top, uint32_t right, uint32_t bottom) {
+    vram->draw_area = { left, top, right, bottom };
+}
+
+void ps1::vram_set_mask_mode(vram_t* vram, bool set_mask, bool test_mask) {
+    vram->set_mask = set_mask;
+    vram->test_mask = test_mask;
+}
+
+void ps1::vram_sync_region(vram_t* vram, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {}
+
+void ps1::vram_read_region(vram_t* vram, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint16_t* pixels) {
+    for (uint32_t i = 0; i < width * height; i++) {
+        pixels[i] = 0;
+    }
+}
+
+void ps1::vram_begin_readback(vram_t* vram) {}
+
+bool ps1::vram_is_readback_ready(vram_t* vram) {
+    return true;
+}
+
+bool ps1::vram_end_readback(vram_t* vram, uint16_t* pixels) {
+    return false;
+}
+
+void ps1::vram_write_all(vram_t* vram, const uint16_t* pixels) {}
+
+void ps1::vram_backup(vram_t* vram) {}
+
+void ps1::vram_restore(vram_t* vram) {}
+
+void ps1::vram_draw_triangle(vram_t* vram, triangle_t triangle) {}
+
+void ps1::vram_draw_quad(vram_t* vram, quad_t quad) {}
+
+void ps1::vram_set_texture_stream_specs(vram_t* vram, uint32_t xpos, uint32_t ypos, uint32_t width, uint32_t height) {}
+
+void ps1::vram_send_texture_stream_data(vram_t* vram, uint32_t data) {}
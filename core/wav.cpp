@@ -0,0 +1,54 @@
+#include "wav.h"
+#include "audio.h"
+
+namespace {
+    constexpr uint32_t fourcc(const char* code) {
+        return code[0] | (code[1] << 8) | (code[2] << 16) | (code[3] << 24);
+    }
+
+    constexpr uint32_t header_size = 44;
+    constexpr uint32_t frame_size = ps1::AUDIO_CHANNEL_CNT * sizeof(int16_t);
+
+    void write_header(ps1::serializer_t* serializer, uint32_t data_size) {
+        ps1::serializer_write32(serializer, fourcc("RIFF"));
+        ps1::serializer_write32(serializer, header_size - 8 + data_size);
+        ps1::serializer_write32(serializer, fourcc("WAVE"));
+
+        ps1::serializer_write32(serializer, fourcc("fmt "));
+        ps1::serializer_write32(serializer, 16);
+        ps1::serializer_write32(serializer, 1 | (ps1::AUDIO_CHANNEL_CNT << 16)); // * pcm, channel count
+        ps1::serializer_write32(serializer, ps1::AUDIO_SAMPLE_RATE);
+        ps1::serializer_write32(serializer, ps1::AUDIO_SAMPLE_RATE * frame_size); // * bytes per second
+        ps1::serializer_write32(serializer, frame_size | (16 << 16)); // * block align, bits per sample
+
+        ps1::serializer_write32(serializer, fourcc("data"));
+        ps1::serializer_write32(serializer, data_size);
+    }
+}
+
+bool ps1::wav_open(wav_t* wav, const str_t& path) {
+    wav->frame_cnt = 0;
+
+    if (!serializer_open_file(&wav->serializer, path, serializer_mode_t::write)) return false;
+
+    write_header(&wav->serializer, 0);
+
+    return true;
+}
+
+void ps1::wav_write(wav_t* wav, const int16_t* frames, uint32_t cnt) {
+    serializer_write(&wav->serializer, frames, (size_t)cnt * frame_size);
+
+    wav->frame_cnt += cnt;
+}
+
+bool ps1::wav_close(wav_t* wav) {
+    // * stream is rewound to patch sizes that were unknown while writing
+    if (wav->serializer.file && fseek(wav->serializer.file, 0, SEEK_SET) == 0) {
+        write_header(&wav->serializer, wav->frame_cnt * frame_size);
+    } else {
+        wav->serializer.failed = true;
+    }
+
+    return serializer_close(&wav->serializer);
+}
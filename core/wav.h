@@ -0,0 +1,18 @@
+#pragma once
+
+#include "defs.h"
+#include "serializer.h"
+
+namespace ps1 {
+    // * 16 bit stereo pcm file at emulated output rate, sizes in header are filled in on close
+    struct wav_t {
+        serializer_t serializer;
+        uint32_t frame_cnt;
+    };
+
+    bool wav_open(wav_t*, const str_t&);
+    void wav_write(wav_t*, const int16_t*, uint32_t);
+
+    // * false if anything failed to be written
+    bool wav_close(wav_t*);
+}
@@ -0,0 +1,227 @@
+#include "defs.h"
+
+#include "ps1.h"
+#include "wav.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+    struct headless_args_t {
+        str_t bios_path = "../bios/SCPH1001.bin";
+        uint64_t max_instr = 100000000; // * 0 means no limit
+        double max_seconds = 0; // * 0 means no limit
+        bool dump_gpu_stats = false;
+        str_t boot_cache_dir; // * empty means bios is always run from reset
+        str_t exe_path; // * empty means bios shell is run
+        str_t disc_path; // * empty means drive is empty
+        str_t compress_in; // * non empty means image is converted and nothing is run
+        str_t compress_out;
+        bool hle = false;
+        ps1::mem_addr_t exit_pc = 0; // * 0 means run until other limit
+        str_t wav_path; // * empty means audio is not generated into ring
+    };
+
+    void print_usage() {
+        printf(
+            "usage: ps1_headless [options]\n"
+            "  --bios <path>             BIOS image (default ../bios/SCPH1001.bin)\n"
+            "  --instructions <count>    stop after given number of guest instructions, 0 for no limit (default 100000000)\n"
+            "  --seconds <seconds>       stop after given wall-clock time, 0 for no limit (default 0)\n"
+            "  --gpu-stats               print gpu stats of last frame\n"
+            "  --boot-cache <dir>        restore post bios snapshot from dir, capture it there on first boot\n"
+            "  --exe <path>              load ps-x exe in place of bios shell\n"
+            "  --disc <path>             insert .cue, .cdz or raw .bin disc image\n"
+            "  --compress-disc <in> <out> write disc image as .cdz and exit\n"
+            "  --hle                     service hot bios kernel calls natively\n"
+            "  --exit-pc <hex address>   stop once guest reaches address\n"
+            "  --wav <path>              write spu output as 44.1 kHz stereo wav\n"
+        );
+    }
+
+    bool parse_args(int argc, char** argv, headless_args_t* args) {
+        for (int i = 1; i < argc; i++) {
+            const char* arg = argv[i];
+            bool has_value = i + 1 < argc;
+
+            if (strcmp(arg, "--bios") == 0 && has_value) {
+                args->bios_path = argv[++i];
+            } else if (strcmp(arg, "--instructions") == 0 && has_value) {
+                args->max_instr = strtoull(argv[++i], nullptr, 10);
+            } else if (strcmp(arg, "--seconds") == 0 && has_value) {
+                args->max_seconds = strtod(argv[++i], nullptr);
+            } else if (strcmp(arg, "--gpu-stats") == 0) {
+                args->dump_gpu_stats = true;
+            } else if (strcmp(arg, "--boot-cache") == 0 && has_value) {
+                args->boot_cache_dir = argv[++i];
+            } else if (strcmp(arg, "--exe") == 0 && has_value) {
+                args->exe_path = argv[++i];
+            } else if (strcmp(arg, "--disc") == 0 && has_value) {
+                args->disc_path = argv[++i];
+            } else if (strcmp(arg, "--compress-disc") == 0 && i + 2 < argc) {
+                args->compress_in = argv[++i];
+                args->compress_out = argv[++i];
+            } else if (strcmp(arg, "--hle") == 0) {
+                args->hle = true;
+            } else if (strcmp(arg, "--exit-pc") == 0 && has_value) {
+                args->exit_pc = strtoul(argv[++i], nullptr, 16);
+            } else if (strcmp(arg, "--wav") == 0 && has_value) {
+                args->wav_path = argv[++i];
+            } else {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    headless_args_t args;
+
+    if (!parse_args(argc, argv, &args)) {
+        print_usage();
+
+        return 1;
+    }
+
+    if (!args.compress_in.empty()) {
+        return ps1::disc_compress(args.compress_in, args.compress_out) ? 0 : 1;
+    }
+
+    ps1::ps1_t console;
+    ps1::ps1_init(&console, args.bios_path);
+    ps1::ps1_set_hle(&console, args.hle);
+
+    if (!args.disc_path.empty() && !ps1::ps1_insert_disc(&console, args.disc_path)) {
+        printf("failed to open %s\n", args.disc_path.c_str());
+
+        ps1::ps1_exit(&console);
+
+        return 1;
+    }
+
+    if (!args.boot_cache_dir.empty()) {
+        ps1::ps1_boot_from_cache(&console, args.boot_cache_dir);
+    }
+
+    if (!args.exe_path.empty() && !ps1::ps1_sideload_exe(&console, args.exe_path)) {
+        printf("failed to read %s\n", args.exe_path.c_str());
+
+        ps1::ps1_exit(&console);
+
+        return 1;
+    }
+
+    bool exit_hit = false;
+
+    if (args.exit_pc) {
+        ps1::cpu_add_hook(&console.cpu, args.exit_pc, [&exit_hit](ps1::cpu_t* cpu) {
+            exit_hit = true;
+            ps1::cpu_set_state(cpu, ps1::cpu_state_t::sleeping);
+
+            return true;
+        });
+    }
+
+    // * nothing drains audio ring without wav sink
+    ps1::wav_t wav;
+    bool write_wav = !args.wav_path.empty();
+
+    if (write_wav && !ps1::wav_open(&wav, args.wav_path)) {
+        printf("failed to create %s\n", args.wav_path.c_str());
+
+        ps1::ps1_exit(&console);
+
+        return 1;
+    }
+
+    ps1::spu_set_output_enabled(&console.spu, write_wav);
+
+    int16_t audio_frames[ps1::AUDIO_SAMPLE_RATE / 10 * ps1::AUDIO_CHANNEL_CNT];
+
+    auto drain_audio = [&]() {
+        while (uint32_t cnt = ps1::audio_ring_pop(&console.audio, audio_frames, ps1::AUDIO_SAMPLE_RATE / 10)) {
+            ps1::wav_write(&wav, audio_frames, cnt);
+        }
+    };
+
+    ps1::cpu_set_state(&console.cpu, ps1::cpu_state_t::running);
+
+    uint64_t instr_cnt = 0; // * cpu counter is 32 bit and wraps on long runs
+    uint32_t frame_cnt = 0;
+    double frame_budget = 0;
+
+    auto start_time = std::chrono::steady_clock::now();
+    double elapsed = 0;
+
+    // * frames are cut at vblank cycle count, same as paced build but without waiting
+    while (console.cpu.state == ps1::cpu_state_t::running) {
+        frame_budget += ps1::gpu_cycles_per_frame(&console.gpu);
+
+        uint64_t frame_start = console.cpu.cycle_cnt;
+
+        while (console.cpu.cycle_cnt - frame_start < frame_budget && console.cpu.state == ps1::cpu_state_t::running) {
+            if (args.max_instr && instr_cnt >= args.max_instr) break;
+
+            ps1::cpu_tick(&console.cpu);
+            instr_cnt++;
+        }
+
+        // * rest of frame budget carries over to next frame
+        ps1::ps1_poll_shell_entry(&console);
+
+        frame_budget -= console.cpu.cycle_cnt - frame_start;
+        frame_cnt++;
+
+        ps1::gpu_end_frame(&console.gpu);
+
+        if (write_wav) {
+            drain_audio();
+        }
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+        if (args.max_instr && instr_cnt >= args.max_instr) break;
+        if (args.max_seconds > 0 && elapsed >= args.max_seconds) break;
+    }
+
+    printf("elapsed: %.3f s\n", elapsed);
+    printf("instructions: %llu\n", (unsigned long long)instr_cnt);
+    printf("frames: %u\n", frame_cnt);
+    printf("mips: %.2f\n", elapsed > 0 ? instr_cnt / elapsed / 1e6 : 0.0);
+    printf("pc: 0x%08X\n", console.cpu.pc);
+
+    if (args.exit_pc) {
+        printf("exit pc: %s\n", exit_hit ? "reached" : "not reached");
+    }
+
+    if (args.hle) {
+        printf("hle calls: %llu\n", (unsigned long long)console.hle.call_cnt);
+    }
+
+    if (console.disc.compressed) {
+        printf("disc hunks: %llu hits, %llu misses\n", (unsigned long long)console.disc.hit_cnt, (unsigned long long)console.disc.miss_cnt);
+    }
+
+    if (args.dump_gpu_stats) {
+        ps1::gpu_dump_stats(&console.gpu, stdout);
+    }
+
+    if (write_wav) {
+        // * push frames of last partial batch
+        ps1::spu_sync(&console.spu);
+        ps1::spu_set_output_enabled(&console.spu, false);
+        drain_audio();
+
+        printf("audio frames: %u\n", wav.frame_cnt);
+
+        if (!ps1::wav_close(&wav)) {
+            printf("failed to write %s\n", args.wav_path.c_str());
+        }
+    }
+
+    ps1::ps1_exit(&console);
+
+    return 0;
+}
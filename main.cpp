@@ -8,30 +8,44 @@
 
 int main() {
     ps1::render::init();
-    ps1::render::make_shader("../core/shaders/vertex.glsl", "../core/shaders/fragment.glsl", 0);
-    ps1::render::use_shader(0);
+    ps1::render::make_shader("../core/shaders/vertex.glsl", "../core/shaders/fragment.glsl", ps1::VRAM_DRAW_SHADER);
+    ps1::render::make_shader("../core/shaders/vertex.glsl", "../core/shaders/mask_fragment.glsl", ps1::VRAM_MASK_SHADER);
+    ps1::render::use_shader(ps1::VRAM_DRAW_SHADER);
 
     ps1::ps1_t console;
-    ps1::ps1_init(&console, "../bios/SCPH1001.bin");
 
     ps1::emulation_settings_t settings;
-    settings.instr_per_frame = 30000;
+    settings.uncapped = false;
+    settings.speed = 1.f;
+    settings.audio_sync = false;
+    settings.skip_frames = 0;
+    settings.skip_period = 1;
+    settings.run_ahead = 0;
+    settings.resolution_scale = 1;
+    settings.rewind = false;
+    settings.rewind_interval = 10;
+    settings.boot_cache = false;
+    settings.hle = false;
+
+    ps1::emulation_t emulation;
+    ps1::emulation_start(&emulation, &console, "../bios/SCPH1001.bin", settings);
 
     while (!ps1::render::should_close()) {
         ps1::render::begin_frame();
 
-        if (console.cpu.state == ps1::cpu_state_t::running) {
-            for (uint32_t i = 0; i < settings.instr_per_frame; i++) {
-                ps1::cpu_tick(&console.cpu);
-            }
-        }
+        ps1::emulation_snapshot_t* snapshot = ps1::emulation_acquire(&emulation);
 
-        ps1::debugger::display(&console, &settings);
+        ps1::debugger::display(&emulation, snapshot);
 
         ps1::render::end_frame();
+
+        // * let go of snapshot before blocking on vsync
+        ps1::emulation_release(&emulation);
+
+        ps1::render::present();
     }
 
-    ps1::ps1_exit(&console);
+    ps1::emulation_stop(&emulation);
 
     ps1::render::exit();
     